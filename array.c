@@ -9,6 +9,14 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <linux/futex.h>
 #include "array.h"
 
 
@@ -18,8 +26,17 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 #define NAME_REGEX "^[a-zA-Z0-9]+$"
 
+// responses //////////////////////////////////////////////////////////////////////////////////////
+// response to init, set, get and destroy
+struct op_resp_msg {
+    int result;
+    int value;      // value for get
+    int request_id; // copied from the request
+};
+
+#define OP_RESP_MSG_SIZE sizeof(struct op_resp_msg)
+
 // init ///////////////////////////////////////////////////////////////////////////////////////////
-#define INIT_VECTOR_QUEUE_NAME "/init"
 #define INIT_RESP_QUEUE_PREFIX "initvec"
 #define INIT_VECTOR_QUEUE_MAX_MESSAGES 10
 #define MAX_VECTOR_NAME_LEN 40
@@ -28,54 +45,429 @@
 struct init_msg {
     char name[MAX_VECTOR_NAME_LEN];
     int size;
+    int durability;
+    int request_id;
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
 };
 
 #define INIT_MSG_SIZE sizeof(struct init_msg)
 
 // set ////////////////////////////////////////////////////////////////////////////////////////////
-#define SET_QUEUE_NAME "/set"
 #define SET_RESP_QUEUE_PREFIX "setval"
 
 struct set_msg {
     char name[MAX_VECTOR_NAME_LEN];
     int pos;
     int value;
+    int request_id;
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
 };
 
 #define SET_MSG_SIZE sizeof(struct set_msg)
 
 // get ////////////////////////////////////////////////////////////////////////////////////////////
-#define GET_QUEUE_NAME "/get"
 #define GET_RESP_QUEUE_PREFIX "getval"
 
 struct get_msg {
     char name[MAX_VECTOR_NAME_LEN];
     int pos;
+    int request_id;
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
 };
 
 #define GET_MSG_SIZE sizeof(struct get_msg)
 
-struct get_resp_msg {
-    int value;
-    int error;
-};
-
-#define GET_RESP_MSG_SIZE sizeof(struct get_resp_msg)
 
 // destroy ////////////////////////////////////////////////////////////////////////////////////////
-#define DESTROY_QUEUE_NAME "/destroy"
 #define DESTROY_RESP_QUEUE_PREFIX "destr"
 
 struct destroy_msg {
     char name[MAX_VECTOR_NAME_LEN];
+    int request_id;
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
 };
 
 #define DESTROY_MSG_SIZE sizeof(struct destroy_msg)
 
+// batch //////////////////////////////////////////////////////////////////////////////////////////
+#define BATCH_RESP_QUEUE_PREFIX "batch"
+#define BATCH_OP_SET 0
+#define BATCH_OP_GET 1
+#define MAX_BATCH_LEN 512   // max number of elements in one message, longer batches are split
+
+struct batch_elem {
+    int pos;
+    int value;
+};
+
+struct batch_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+    int op;
+    int len;
+    struct batch_elem elems[MAX_BATCH_LEN];
+};
+
+#define BATCH_MSG_HEADER_SIZE offsetof(struct batch_msg, elems)
+
+struct batch_resp_msg {
+    int error;
+    int len;
+    int values[MAX_BATCH_LEN];
+};
+
+#define BATCH_RESP_MSG_SIZE sizeof(struct batch_resp_msg)
+
+// range //////////////////////////////////////////////////////////////////////////////////////////
+#define RANGE_RESP_QUEUE_PREFIX "range"
+#define RANGE_OP_SET 0
+#define RANGE_OP_GET 1
+#define MAX_RANGE_LEN 2000  // max number of elements in one message, longer ranges are split
+
+struct range_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+    int op;
+    int start;
+    int len;
+    int values[MAX_RANGE_LEN];
+};
+
+#define RANGE_MSG_HEADER_SIZE offsetof(struct range_msg, values)
+
+struct range_resp_msg {
+    int error;
+    int len;
+    int values[MAX_RANGE_LEN];
+};
+
+#define RANGE_RESP_MSG_SIZE sizeof(struct range_resp_msg)
+
+// atomic read-modify-write ///////////////////////////////////////////////////////////////////////
+#define RMW_RESP_QUEUE_PREFIX "rmw"
+#define RMW_OP_FETCH_ADD 0
+#define RMW_OP_CAS 1
+#define RMW_OP_EXCHANGE 2
+
+struct rmw_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    int op;
+    int pos;
+    int operand;
+    int expected;
+    int request_id;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+};
+
+#define RMW_MSG_SIZE sizeof(struct rmw_msg)
+
+// reductions /////////////////////////////////////////////////////////////////////////////////////
+#define REDUCE_RESP_QUEUE_PREFIX "reduce"
+#define REDUCE_OP_SUM 0
+#define REDUCE_OP_MIN 1
+#define REDUCE_OP_MAX 2
+#define REDUCE_OP_MEAN 3
+#define REDUCE_OP_COUNT_NONZERO 4
+
+struct reduce_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    int op;
+    int start;
+    int end;
+    int request_id;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+};
+
+#define REDUCE_MSG_SIZE sizeof(struct reduce_msg)
+
+struct reduce_resp_msg {
+    int error;
+    int request_id;
+    int64_t value;
+    double mean;
+};
+
+#define REDUCE_RESP_MSG_SIZE sizeof(struct reduce_resp_msg)
+
+// element-wise operations ////////////////////////////////////////////////////////////////////////
+#define ELEMENTWISE_RESP_QUEUE_PREFIX "elementwise"
+#define ELEMENTWISE_OP_ADD 0
+#define ELEMENTWISE_OP_SCALE 1
+#define ELEMENTWISE_OP_AXPY 2
+#define ELEMENTWISE_OP_MIN 3
+#define ELEMENTWISE_OP_MAX 4
+
+struct elementwise_msg {
+    char target[MAX_VECTOR_NAME_LEN];
+    char x[MAX_VECTOR_NAME_LEN];
+    char y[MAX_VECTOR_NAME_LEN];
+    int op;
+    int k;
+    int request_id;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+};
+
+#define ELEMENTWISE_MSG_SIZE sizeof(struct elementwise_msg)
+
+// distances //////////////////////////////////////////////////////////////////////////////////////
+#define DISTANCE_RESP_QUEUE_PREFIX "distance"
+
+struct distance_msg {
+    char a[MAX_VECTOR_NAME_LEN];
+    char b[MAX_VECTOR_NAME_LEN];
+    int metric;
+    int request_id;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+};
+
+#define DISTANCE_MSG_SIZE sizeof(struct distance_msg)
+
+struct distance_resp_msg {
+    int error;
+    int request_id;
+    double value;
+};
+
+#define DISTANCE_RESP_MSG_SIZE sizeof(struct distance_resp_msg)
+
+// nearest vectors ////////////////////////////////////////////////////////////////////////////////
+#define NEAREST_RESP_QUEUE_PREFIX "nearest"
+#define NEAREST_SUCCESS 0           // result of one message, find_nearest returns the count
+#define MAX_NEAREST_CANDIDATES 128  // max number of candidates in one message, more are split
+
+struct nearest_msg {
+    char query[MAX_VECTOR_NAME_LEN];
+    int metric;
+    int k;
+    int num_of_candidates;
+    int request_id;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+    char candidates[MAX_NEAREST_CANDIDATES][MAX_VECTOR_NAME_LEN];
+};
+
+#define NEAREST_MSG_HEADER_SIZE offsetof(struct nearest_msg, candidates)
+
+struct nearest_resp_msg {
+    int error;
+    int request_id;
+    int len;
+    int indexes[MAX_NEAREST_K];
+    double values[MAX_NEAREST_K];
+};
+
+#define NEAREST_RESP_MSG_SIZE sizeof(struct nearest_resp_msg)
+
+// bulk import and export ////////////////////////////////////////////////////////////////////////
+#define TRANSFER_RESP_QUEUE_PREFIX "transfer"
+#define TRANSFER_SHM_PREFIX "transfer"
+#define TRANSFER_SUCCESS 0          // result of the message, the functions return the count
+#define TRANSFER_OP_IMPORT 0
+#define TRANSFER_OP_EXPORT 1
+#define TRANSFER_FORMAT_SHM 2
+#define MAX_TRANSFER_PATH_LEN 1024
+
+struct transfer_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    int op;
+    int format;
+    int len;
+    int request_id;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+    char path[MAX_TRANSFER_PATH_LEN];
+};
+
+#define TRANSFER_MSG_SIZE sizeof(struct transfer_msg)
+
+// vector handles /////////////////////////////////////////////////////////////////////////////////
+#define HANDLE_OP_REGISTER 0
+#define HANDLE_OP_UNREGISTER 1
+#define HANDLE_OP_OPEN 2
+#define HANDLE_OP_CLOSE 3
+#define HANDLE_OP_SET 4
+#define HANDLE_OP_GET 5
+
+struct handle_msg {
+    int op;
+    int client_id;
+    int handle;
+    int pos;
+    int value;
+    int request_id;
+    char name[MAX_VECTOR_NAME_LEN];
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+};
+
+#define HANDLE_MSG_SIZE sizeof(struct handle_msg)
+#define HANDLE_MSG_HEADER_SIZE offsetof(struct handle_msg, name)   // set, get, close, unregister
+#define HANDLE_OPEN_MSG_SIZE offsetof(struct handle_msg, resp_queue_name)
+
+// shared memory transport ////////////////////////////////////////////////////////////////////////
+#define ATTACH_SUCCESS 0
+#define MAX_SHM_NAME_LEN 64
+#define SHM_RING_CAPACITY 64
+#define SHM_SPIN_ITERATIONS 4000    // polls of an empty ring before sleeping on the futex
+#define SHM_OP_INIT 0
+#define SHM_OP_SET 1
+#define SHM_OP_GET 2
+#define SHM_OP_DESTROY 3
+#define SHM_OP_DETACH 4
+
+struct attach_msg {
+    char shm_name[MAX_SHM_NAME_LEN];
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+};
+
+#define ATTACH_MSG_SIZE sizeof(struct attach_msg)
+
+struct shm_request {
+    int op;
+    int pos;
+    int value;
+    char name[MAX_VECTOR_NAME_LEN];
+};
+
+struct shm_response {
+    int result;
+    int value;
+};
+
+// must be the same as in the server
+struct shm_channel {
+    uint32_t req_tail __attribute__((aligned(64)));
+    uint32_t server_sleeping;
+    uint32_t resp_tail __attribute__((aligned(64)));
+    uint32_t client_sleeping;
+    struct shm_request requests[SHM_RING_CAPACITY] __attribute__((aligned(64)));
+    struct shm_response responses[SHM_RING_CAPACITY];
+};
+
+// asynchronous requests //////////////////////////////////////////////////////////////////////////
+#define ASYNC_RESP_QUEUE_PREFIX "dvasync"
+#define ASYNC_MAX_IN_FLIGHT 10  // depth of the async response queue, so the server never blocks
+                                // on sending a response
+#define ASYNC_MAX_REQUESTS 64   // max number of submitted requests which weren't collected yet
+#define ASYNC_STATE_FREE 0
+#define ASYNC_STATE_PENDING 1   // sent, response not received yet
+#define ASYNC_STATE_DONE 2      // response received, not collected yet
+#define ASYNC_OP_INIT 0
+#define ASYNC_OP_SET 1
+#define ASYNC_OP_GET 2
+#define ASYNC_OP_DESTROY 3
+
+/*
+    submitted request, kept at index request_id % ASYNC_MAX_REQUESTS of its session
+*/
+struct async_request {
+    int id;
+    int state;
+    int result;
+    int value;
+};
+
+// requests queue /////////////////////////////////////////////////////////////////////////////////
+#define REQUESTS_QUEUE_NAME "/requests"
+#define OP_INIT_VECTOR 0
+#define OP_SET 1
+#define OP_GET 2
+#define OP_DESTROY 3
+#define OP_BATCH 4
+#define OP_RANGE 5
+#define OP_ATTACH 6
+#define OP_HANDLE 7
+#define OP_RMW 8
+#define OP_REDUCE 9
+#define OP_ELEMENTWISE 10
+#define OP_DISTANCE 11
+#define OP_NEAREST 12
+#define OP_TRANSFER 13
+#define REQUEST_CLASS_READ 0        // get, get_batch, get_range, get_by_handle
+#define REQUEST_CLASS_WRITE 1       // set, set_by_handle, fetch_add, compare_and_swap, exchange
+#define REQUEST_CLASS_BULK 2        // everything else, e.g. init, destroy, set_batch, set_range
+#define NUM_OF_REQUEST_CLASSES 3
+#define MAX_REQUEST_PRIORITY 2      // priorities are 0..MAX_REQUEST_PRIORITY, higher goes first
+#define DEFAULT_READ_PRIORITY 2
+#define DEFAULT_WRITE_PRIORITY 1
+#define DEFAULT_BULK_PRIORITY 0
+
+// must be the same as in the server
+union request_body {
+    struct init_msg init;
+    struct set_msg set;
+    struct get_msg get;
+    struct destroy_msg destroy;
+    struct batch_msg batch;
+    struct range_msg range;
+    struct attach_msg attach;
+    struct handle_msg handle;
+    struct rmw_msg rmw;
+    struct reduce_msg reduce;
+    struct elementwise_msg elementwise;
+    struct distance_msg distance;
+    struct nearest_msg nearest;
+    struct transfer_msg transfer;
+};
+
+/*
+    every request is sent to the one server queue, opcode tells which member of body is used. 
+    Only the used part of body is sent
+*/
+struct request_msg {
+    int opcode;     // OP_...
+    union request_body body;
+};
+
+#define REQUEST_MSG_HEADER_SIZE offsetof(struct request_msg, body)
+
+// session ////////////////////////////////////////////////////////////////////////////////////////
+#define SESSION_RESP_QUEUE_PREFIX "dvresp"
+#define SESSION_SHM_PREFIX "dvshm"
+
+// buffer big enough for a response to any request
+union resp_msg {
+    int result;             // the same as op.result
+    struct op_resp_msg op;
+    struct batch_resp_msg batch;
+    struct range_resp_msg range;
+    struct reduce_resp_msg reduce;
+    struct distance_resp_msg distance;
+    struct nearest_resp_msg nearest;
+};
+
+#define RESP_MSG_MAX_SIZE sizeof(union resp_msg)
+
+/*
+    server queue opened once by connect_server and shared by all threads of the process
+*/
+struct connection {
+    int connected;
+    int use_shm;                // threads attach shared memory channels
+    unsigned int generation;    // increased on every connect, so sessions of an old connection
+                                // are recognized as stale
+    mqd_t q_requests;
+    int* open_handles;          // vector handles which weren't closed yet, closed on disconnect
+    int num_of_open_handles;
+    int open_handles_capacity;
+};
+
+/*
+    response queue of one thread, created on the first call the thread makes while connected
+*/
+struct session {
+    unsigned int generation;    // connection generation for which the queue was created, 0 --> none
+    mqd_t q_resp;
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+    struct shm_channel* p_channel;  // NULL --> the thread uses message queues
+    uint32_t req_tail;              // number of requests written into the channel
+    int has_async_queue;            // q_async_resp is created on the first submit
+    mqd_t q_async_resp;
+    char async_resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];
+    int next_request_id;
+    int num_in_flight;              // submitted requests whose response wasn't received yet
+    struct async_request requests[ASYNC_MAX_REQUESTS];
+    int client_id;                  // id given by the server for handle requests, -1 --> none
+    struct session* p_next;     // all sessions are listed so that disconnect can remove them
+};
+
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -91,8 +483,112 @@ int open_server_init_queue(mqd_t* p_queue);
     creates and opens a queue with unique name for getting a response from the server
 */
 int open_resp_queue(char* prefix, char* que_name, mqd_t* p_queue, size_t msg_size);
-int create_vector_on_server(char* name, int size, char* resp_que_name, mqd_t* p_q_server, 
-    mqd_t* p_q_resp);
+int create_vector_on_server(char* name, int size, int durability, char* resp_que_name, 
+    mqd_t* p_q_server, mqd_t* p_q_resp);
+/*
+    returns the session of the calling thread if the process is connected, creating the thread's
+    response queue when needed. NULL if not connected or the queue couldn't be created
+*/
+struct session* get_session();
+/*
+    creates a response queue of the calling thread, named after the prefix, pid and thread id.
+    que_name must have MAX_RESP_QUEUE_NAME_LEN characters. 1 -> success, 0 -> fail
+*/
+int open_session_queue(char* prefix, char* que_name, long max_msgs, long msg_size, 
+    mqd_t* p_queue);
+/*
+    returns the session of the calling thread like get_session and creates the queue for 
+    responses to asynchronous requests if needed. NULL -> fail
+*/
+struct session* get_async_session();
+/*
+    sends an asynchronous request, the response goes to the async queue of the session.
+    1 -> success, 0 -> fail
+*/
+int send_async_request(struct session* p_session, int op, char* name, int pos, int value, 
+    int request_id);
+/*
+    receives one response from the async queue of the session and marks its request done. 
+    If wait is 0 returns immediately when there is no response. 
+    1 -> received, 0 -> no response, -1 -> fail
+*/
+int receive_async_response(struct session* p_session, int wait);
+/*
+    common part of all submit functions. Returns the request id or ASYNC_FAIL
+*/
+int submit_request(int op, char* name, int pos, int value);
+/*
+    returns the session of the calling thread like get_session and registers its response queue
+    for handle requests if needed. NULL -> fail
+*/
+struct session* get_handle_session();
+/*
+    sends a handle request and waits for its response. name is sent only for open. Returns the
+    result of the request, the value of get is stored in p_value
+*/
+int call_handle_op(struct session* p_session, int op, int handle, int pos, int value, 
+    char* name, int* p_value);
+/*
+    adds the handle to or removes it from the open handles of the connection. Connection mutex
+    must not be locked. 1 -> success, 0 -> fail
+*/
+int track_open_handle(int handle);
+void untrack_open_handle(int handle);
+/*
+    opens a server queue for writing. 1 -> success, 0 -> fail
+*/
+int open_server_queue(char* name, mqd_t* p_queue);
+/*
+    sends body_size bytes of p_body as a request with the given opcode. The message priority 
+    depends on whether the request reads, writes or creates, removes or moves many elements, 
+    see set_request_priorities. The same as mq_send: 0 -> success, -1 -> fail
+*/
+int send_request(mqd_t q_server, int opcode, void* p_body, size_t body_size);
+/*
+    REQUEST_CLASS_READ, REQUEST_CLASS_WRITE or REQUEST_CLASS_BULK of a request. p_request must
+    point to a whole union, only the member of the opcode is read
+*/
+int get_request_class(int opcode, union request_body* p_request);
+/*
+    opens the server request queue, use_shm tells whether threads attach shared memory channels
+*/
+int connect_with_transport(int use_shm);
+/*
+    creates a shared memory channel for the session and asks the server to serve it. 
+    Connection mutex must be locked. 1 -> success, 0 -> fail
+*/
+int attach_shm_channel(struct session* p_session);
+/*
+    tells the server to stop serving the channel of the session and unmaps it
+*/
+void detach_shm_channel(struct session* p_session);
+/*
+    sends one request through the shared memory channel of the session and waits for its 
+    response. Returns the result of the request, the value of get is stored in p_value
+*/
+int call_over_shm(struct session* p_session, int op, char* name, int pos, int value, 
+    int* p_value);
+/*
+    waits until the tail of a ring differs from head, spins for a while and then sleeps on the 
+    tail futex
+*/
+void wait_for_shm_ring(uint32_t* p_tail, uint32_t* p_sleeping, uint32_t head);
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// global variables
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+struct connection connection;
+pthread_mutex_t mutex_connection = PTHREAD_MUTEX_INITIALIZER;   // guards connection and sessions
+struct session* sessions = NULL;        // all sessions created for the current connection
+__thread struct session* p_thread_session = NULL;
+// message priority of every request class, changed with set_request_priorities
+int request_priorities[NUM_OF_REQUEST_CLASSES] = { 
+    DEFAULT_READ_PRIORITY, DEFAULT_WRITE_PRIORITY, DEFAULT_BULK_PRIORITY };
 
 
 
@@ -103,15 +599,36 @@ int create_vector_on_server(char* name, int size, char* resp_que_name, mqd_t* p_
 
 
 int init(char* name, int size)
+{
+    return init_with_durability(name, size, DURABILITY_DEFAULT);
+}
+
+
+
+int init_with_durability(char* name, int size, int durability)
 {
     int result = NEW_VECTOR_CREATED;
+    struct session* p_session;
 
-    if (is_init_data_valid(name, size))
+    if (!is_init_data_valid(name, size) || durability < DURABILITY_DEFAULT || 
+        durability > DURABILITY_STRICT)
+    {
+        result = VECTOR_CREATION_ERROR;
+    }
+    else if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        if (p_session->p_channel != NULL)
+            result = call_over_shm(p_session, SHM_OP_INIT, name, size, durability, NULL);
+        else
+            result = create_vector_on_server(name, size, durability, p_session->resp_queue_name, 
+                &connection.q_requests, &p_session->q_resp);
+    }
+    else
     {
         // open queue to send init vector message to server
         mqd_t q_server_init;
 
-        if ((q_server_init = mq_open(INIT_VECTOR_QUEUE_NAME, O_WRONLY)) == -1)
+        if ((q_server_init = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
         {
             result = VECTOR_CREATION_ERROR;
         }
@@ -120,9 +637,11 @@ int init(char* name, int size)
             // queue for response from server
             mqd_t q_resp;
             char resp_que_name[MAX_RESP_QUEUE_NAME_LEN];
-            if (open_resp_queue(INIT_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, sizeof(int)) == 1)
+            if (open_resp_queue(INIT_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, 
+                OP_RESP_MSG_SIZE) == 1)
             {
-                result = create_vector_on_server(name, size, resp_que_name, &q_server_init, &q_resp);
+                result = create_vector_on_server(name, size, durability, resp_que_name, 
+                    &q_server_init, &q_resp);
 
                 // close and unlink response queue
                 if (mq_close (q_resp) == -1)
@@ -138,8 +657,6 @@ int init(char* name, int size)
                 result = VECTOR_CREATION_ERROR;
         }
     }
-    else 
-        result = VECTOR_CREATION_ERROR;
     
     return result;
 }
@@ -187,25 +704,31 @@ int is_name_valid(char* name)
 
 
 
-int create_vector_on_server(char* name, int size, char* resp_que_name, mqd_t* p_q_server, 
-    mqd_t* p_q_resp)
+int create_vector_on_server(char* name, int size, int durability, char* resp_que_name, 
+    mqd_t* p_q_server, mqd_t* p_q_resp)
 {
     int result = NEW_VECTOR_CREATED;
 
     // create message
     struct init_msg msg;
     msg.size = size;
+    msg.durability = durability;
+    msg.request_id = 0;
     strcpy(msg.name, name);
     strcpy(msg.resp_queue_name, resp_que_name);
 
     // send message
-    if (mq_send(*p_q_server, (char*) &msg, INIT_MSG_SIZE, 0) == -1)
+    if (send_request(*p_q_server, OP_INIT_VECTOR, &msg, INIT_MSG_SIZE) == -1)
         result = VECTOR_CREATION_ERROR;
     else // message send successfully
     {
+        union resp_msg response;
+
         // wait for response
-        if (mq_receive(*p_q_resp, (char*) &result, sizeof(int), NULL) == -1)
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
             result = VECTOR_CREATION_ERROR;
+        else
+            result = response.result;
     }
 
     return result;
@@ -228,17 +751,22 @@ int set_on_server(char* name, int pos, int val, char* resp_que_name, mqd_t* p_q_
     struct set_msg msg;
     msg.pos = pos;
     msg.value = val;
+    msg.request_id = 0;
     strcpy(msg.name, name);
     strcpy(msg.resp_queue_name, resp_que_name);
 
     // send message
-    if (mq_send(*p_q_server, (char*) &msg, SET_MSG_SIZE, 0) == -1)
+    if (send_request(*p_q_server, OP_SET, &msg, SET_MSG_SIZE) == -1)
         result = SET_FAIL;
     else // message send successfully
     {
+        union resp_msg response;
+
         // wait for response
-        if (mq_receive(*p_q_resp, (char*) &result, sizeof(int), NULL) == -1)
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
             result = SET_FAIL;
+        else
+            result = response.result;
     }
 
     return result;
@@ -251,15 +779,25 @@ int set(char* name, int pos, int val)
     int result = SET_SUCCESS;
     // open queue to send set message to server
     mqd_t q_server_set;
+    struct session* p_session;
 
-    if ((q_server_set = mq_open(SET_QUEUE_NAME, O_WRONLY)) == -1)
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        if (p_session->p_channel != NULL)
+            result = call_over_shm(p_session, SHM_OP_SET, name, pos, val, NULL);
+        else
+            result = set_on_server(name, pos, val, p_session->resp_queue_name, 
+                &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_set = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
         result = SET_FAIL;
     else
     {
         // queue for response from server
         mqd_t q_resp;
         char resp_que_name[MAX_RESP_QUEUE_NAME_LEN];
-        if (open_resp_queue(SET_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, sizeof(int)) == 1)
+        if (open_resp_queue(SET_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, 
+            OP_RESP_MSG_SIZE) == 1)
         {
             result = set_on_server(name, pos, val, resp_que_name, &q_server_set, &q_resp);
 
@@ -296,23 +834,24 @@ int get_from_server(char* name, int pos, int* p_val, char* resp_que_name, mqd_t*
     // create message
     struct get_msg msg;
     msg.pos = pos;
+    msg.request_id = 0;
     strcpy(msg.name, name);
     strcpy(msg.resp_queue_name, resp_que_name);
 
     // send message
-    if (mq_send(*p_q_server, (char*) &msg, GET_MSG_SIZE, 0) == -1)
+    if (send_request(*p_q_server, OP_GET, &msg, GET_MSG_SIZE) == -1)
         result = GET_FAIL;
     else // message send successfully
     {
-        struct get_resp_msg response;
+        union resp_msg response;
 
         // wait for response
-        if (mq_receive(*p_q_resp, (char*) &response, GET_RESP_MSG_SIZE, NULL) == -1)
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
             result = SET_FAIL;
         else
         {
-            result = response.error;
-            *p_val = response.value;
+            result = response.op.result;
+            *p_val = response.op.value;
         }
         
     }
@@ -326,15 +865,25 @@ int get(char* name, int pos, int* value)
     int result = GET_SUCCESS;
     // open queue to send get message to server
     mqd_t q_server_get;
+    struct session* p_session;
 
-    if ((q_server_get = mq_open(GET_QUEUE_NAME, O_WRONLY)) == -1)
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        if (p_session->p_channel != NULL)
+            result = call_over_shm(p_session, SHM_OP_GET, name, pos, 0, value);
+        else
+            result = get_from_server(name, pos, value, p_session->resp_queue_name, 
+                &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_get = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
         result = GET_FAIL;
     else
     {
         // queue for response from server
         mqd_t q_resp;
         char resp_que_name[MAX_RESP_QUEUE_NAME_LEN];
-        if (open_resp_queue(GET_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, GET_RESP_MSG_SIZE) == 1)
+        if (open_resp_queue(GET_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, 
+            OP_RESP_MSG_SIZE) == 1)
         {
             result = get_from_server(name, pos, value, resp_que_name, &q_server_get, &q_resp);
 
@@ -369,17 +918,22 @@ int destroy_on_server(char* name, char* resp_que_name, mqd_t* p_q_server, mqd_t*
 
     // create message
     struct destroy_msg msg;
+    msg.request_id = 0;
     strcpy(msg.name, name);
     strcpy(msg.resp_queue_name, resp_que_name);
     
     // send message
-    if (mq_send(*p_q_server, (char*) &msg, DESTROY_MSG_SIZE, 0) == -1)
+    if (send_request(*p_q_server, OP_DESTROY, &msg, DESTROY_MSG_SIZE) == -1)
         result = GET_FAIL;
     else // message send successfully
     {
+        union resp_msg response;
+
         // wait for response
-        if (mq_receive(*p_q_resp, (char*) &result, sizeof(int), NULL) == -1)
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
             result = SET_FAIL;
+        else
+            result = response.result;
     }
 
     return result;
@@ -392,15 +946,25 @@ int destroy(char* vec_name)
     int result = DESTROY_SUCCESS;
     // open queue to send destroy message to server
     mqd_t q_server_destroy;
+    struct session* p_session;
 
-    if ((q_server_destroy = mq_open(DESTROY_QUEUE_NAME, O_WRONLY)) == -1)
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        if (p_session->p_channel != NULL)
+            result = call_over_shm(p_session, SHM_OP_DESTROY, vec_name, 0, 0, NULL);
+        else
+            result = destroy_on_server(vec_name, p_session->resp_queue_name, 
+                &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_destroy = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
         result = DESTROY_FAIL;
     else
     {
         // queue for response from server
         mqd_t q_resp;
         char resp_que_name[MAX_RESP_QUEUE_NAME_LEN];
-        if (open_resp_queue(DESTROY_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, sizeof(int)) == 1)
+        if (open_resp_queue(DESTROY_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, 
+            OP_RESP_MSG_SIZE) == 1)
         {
             result = destroy_on_server(vec_name, resp_que_name, &q_server_destroy, &q_resp);
 
@@ -423,6 +987,1882 @@ int destroy(char* vec_name)
 
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// batch
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int batch_on_server(char* name, int op, int len, int* positions, int* values, 
+    char* resp_que_name, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = BATCH_SUCCESS;
+
+    // create message
+    struct batch_msg msg;
+    msg.op = op;
+    msg.len = len;
+    strcpy(msg.name, name);
+    strcpy(msg.resp_queue_name, resp_que_name);
+
+    for (int i = 0; i < len; i++)
+    {
+        msg.elems[i].pos = positions[i];
+        msg.elems[i].value = op == BATCH_OP_SET ? values[i] : 0;
+    }
+
+    // send message, only the used part of elems
+    size_t msg_size = BATCH_MSG_HEADER_SIZE + len * sizeof(struct batch_elem);
+    if (send_request(*p_q_server, OP_BATCH, &msg, msg_size) == -1)
+        result = BATCH_FAIL;
+    else // message send successfully
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
+            result = BATCH_FAIL;
+        else if (response.batch.error != BATCH_SUCCESS)
+            result = BATCH_FAIL;
+        else if (op == BATCH_OP_GET)
+        {
+            if (response.batch.len == len)
+                memcpy(values, response.batch.values, len * sizeof(int));
+            else
+                result = BATCH_FAIL;
+        }
+    }
+
+    return result;
+}
+
+
+
+/*
+    sends the batch in chunks of at most MAX_BATCH_LEN elements, stops on the first failed chunk
+*/
+int batch_in_chunks(char* name, int op, int len, int* positions, int* values, 
+    char* resp_que_name, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = BATCH_SUCCESS;
+
+    for (int done = 0; done < len && result == BATCH_SUCCESS; done += MAX_BATCH_LEN)
+    {
+        int chunk_len = len - done < MAX_BATCH_LEN ? len - done : MAX_BATCH_LEN;
+
+        result = batch_on_server(name, op, chunk_len, positions + done, values + done, 
+            resp_que_name, p_q_server, p_q_resp);
+    }
+
+    return result;
+}
+
+
+
+int run_batch(char* name, int op, int len, int* positions, int* values)
+{
+    int result = BATCH_SUCCESS;
+    mqd_t q_server_batch;
+    struct session* p_session;
+
+    if (len < 0 || !is_name_valid(name))
+        result = BATCH_FAIL;
+    else if (len == 0) // nothing to do
+        result = BATCH_SUCCESS;
+    else if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        result = batch_in_chunks(name, op, len, positions, values, p_session->resp_queue_name, 
+            &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_batch = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = BATCH_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        char resp_que_name[MAX_RESP_QUEUE_NAME_LEN];
+        if (open_resp_queue(BATCH_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, 
+            BATCH_RESP_MSG_SIZE) == 1)
+        {
+            result = batch_in_chunks(name, op, len, positions, values, resp_que_name, 
+                &q_server_batch, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = BATCH_FAIL;
+
+            if (mq_unlink(resp_que_name) == -1)
+                result = BATCH_FAIL;
+        }
+        else // couldn't open response queue
+            result = BATCH_FAIL;
+
+        if (mq_close(q_server_batch) == -1) 
+            result = BATCH_FAIL;
+    }
+
+    return result;
+}
+
+
+
+int set_batch(char* name, int len, int* positions, int* values)
+{
+    return run_batch(name, BATCH_OP_SET, len, positions, values);
+}
+
+
+
+int get_batch(char* name, int len, int* positions, int* values)
+{
+    return run_batch(name, BATCH_OP_GET, len, positions, values);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// range
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int range_on_server(char* name, int op, int start, int len, int* buf, char* resp_que_name, 
+    mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = RANGE_SUCCESS;
+
+    // create message
+    struct range_msg msg;
+    msg.op = op;
+    msg.start = start;
+    msg.len = len;
+    strcpy(msg.name, name);
+    strcpy(msg.resp_queue_name, resp_que_name);
+
+    // send message, values only for set
+    size_t msg_size = RANGE_MSG_HEADER_SIZE;
+    if (op == RANGE_OP_SET)
+    {
+        memcpy(msg.values, buf, len * sizeof(int));
+        msg_size += len * sizeof(int);
+    }
+
+    if (send_request(*p_q_server, OP_RANGE, &msg, msg_size) == -1)
+        result = RANGE_FAIL;
+    else // message send successfully
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
+            result = RANGE_FAIL;
+        else if (response.range.error != RANGE_SUCCESS)
+            result = RANGE_FAIL;
+        else if (op == RANGE_OP_GET)
+        {
+            if (response.range.len == len)
+                memcpy(buf, response.range.values, len * sizeof(int));
+            else
+                result = RANGE_FAIL;
+        }
+    }
+
+    return result;
+}
+
+
+
+/*
+    sends the range in chunks of at most MAX_RANGE_LEN elements, stops on the first failed chunk
+*/
+int range_in_chunks(char* name, int op, int start, int count, int* buf, char* resp_que_name, 
+    mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = RANGE_SUCCESS;
+
+    for (int done = 0; done < count && result == RANGE_SUCCESS; done += MAX_RANGE_LEN)
+    {
+        int chunk_len = count - done < MAX_RANGE_LEN ? count - done : MAX_RANGE_LEN;
+
+        result = range_on_server(name, op, start + done, chunk_len, buf + done, resp_que_name, 
+            p_q_server, p_q_resp);
+    }
+
+    return result;
+}
+
+
+
+int run_range(char* name, int op, int start, int count, int* buf)
+{
+    int result = RANGE_SUCCESS;
+    mqd_t q_server_range;
+    struct session* p_session;
+
+    if (start < 0 || count < 0 || !is_name_valid(name))
+        result = RANGE_FAIL;
+    else if (count == 0) // nothing to do
+        result = RANGE_SUCCESS;
+    else if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        result = range_in_chunks(name, op, start, count, buf, p_session->resp_queue_name, 
+            &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_range = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = RANGE_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        char resp_que_name[MAX_RESP_QUEUE_NAME_LEN];
+        if (open_resp_queue(RANGE_RESP_QUEUE_PREFIX, resp_que_name, &q_resp, 
+            RANGE_RESP_MSG_SIZE) == 1)
+        {
+            result = range_in_chunks(name, op, start, count, buf, resp_que_name, 
+                &q_server_range, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = RANGE_FAIL;
+
+            if (mq_unlink(resp_que_name) == -1)
+                result = RANGE_FAIL;
+        }
+        else // couldn't open response queue
+            result = RANGE_FAIL;
+
+        if (mq_close(q_server_range) == -1) 
+            result = RANGE_FAIL;
+    }
+
+    return result;
+}
+
+
+
+int set_range(char* name, int start, int count, int* buf)
+{
+    return run_range(name, RANGE_OP_SET, start, count, buf);
+}
+
+
+
+int get_range(char* name, int start, int count, int* buf)
+{
+    return run_range(name, RANGE_OP_GET, start, count, buf);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// atomic read-modify-write
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int rmw_on_server(struct rmw_msg* p_msg, int* p_old_value, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = RMW_FAIL;
+
+    if (send_request(*p_q_server, OP_RMW, p_msg, RMW_MSG_SIZE) == 0)
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1)
+        {
+            result = response.op.result;
+
+            if (result == RMW_SUCCESS && p_old_value != NULL)
+                *p_old_value = response.op.value;
+        }
+    }
+
+    return result;
+}
+
+
+
+int run_rmw(char* name, int op, int pos, int operand, int expected, int* p_old_value)
+{
+    if (!is_name_valid(name))
+        return RMW_FAIL;
+
+    int result = RMW_SUCCESS;
+    mqd_t q_server_rmw;
+    struct session* p_session;
+
+    struct rmw_msg msg;
+    msg.op = op;
+    msg.pos = pos;
+    msg.operand = operand;
+    msg.expected = expected;
+    msg.request_id = 0;
+    strcpy(msg.name, name);
+
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+        result = rmw_on_server(&msg, p_old_value, &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_rmw = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = RMW_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        if (open_resp_queue(RMW_RESP_QUEUE_PREFIX, msg.resp_queue_name, &q_resp, 
+            OP_RESP_MSG_SIZE) == 1)
+        {
+            result = rmw_on_server(&msg, p_old_value, &q_server_rmw, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = RMW_FAIL;
+
+            if (mq_unlink(msg.resp_queue_name) == -1)
+                result = RMW_FAIL;
+        }
+        else // couldn't open response queue
+            result = RMW_FAIL;
+
+        if (mq_close(q_server_rmw) == -1) 
+            result = RMW_FAIL;
+    }
+
+    return result;
+}
+
+
+
+int fetch_add(char* name, int pos, int delta, int* p_old_value)
+{
+    return run_rmw(name, RMW_OP_FETCH_ADD, pos, delta, 0, p_old_value);
+}
+
+
+
+int compare_and_swap(char* name, int pos, int expected, int desired, int* p_old_value)
+{
+    return run_rmw(name, RMW_OP_CAS, pos, desired, expected, p_old_value);
+}
+
+
+
+int exchange(char* name, int pos, int value, int* p_old_value)
+{
+    return run_rmw(name, RMW_OP_EXCHANGE, pos, value, 0, p_old_value);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// reductions
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int reduce_on_server(struct reduce_msg* p_msg, struct reduce_resp_msg* p_resp, mqd_t* p_q_server, 
+    mqd_t* p_q_resp)
+{
+    int result = REDUCE_FAIL;
+
+    if (send_request(*p_q_server, OP_REDUCE, p_msg, REDUCE_MSG_SIZE) == 0)
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1)
+        {
+            result = response.reduce.error;
+            *p_resp = response.reduce;
+        }
+    }
+
+    return result;
+}
+
+
+
+int run_reduce(char* name, int op, int start, int end, struct reduce_resp_msg* p_resp)
+{
+    if (start < 0 || (end < start && end != REDUCE_TO_END) || !is_name_valid(name))
+        return REDUCE_FAIL;
+
+    int result = REDUCE_SUCCESS;
+    mqd_t q_server_reduce;
+    struct session* p_session;
+
+    struct reduce_msg msg;
+    msg.op = op;
+    msg.start = start;
+    msg.end = end;
+    msg.request_id = 0;
+    strcpy(msg.name, name);
+
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+        result = reduce_on_server(&msg, p_resp, &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_reduce = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = REDUCE_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        if (open_resp_queue(REDUCE_RESP_QUEUE_PREFIX, msg.resp_queue_name, &q_resp, 
+            REDUCE_RESP_MSG_SIZE) == 1)
+        {
+            result = reduce_on_server(&msg, p_resp, &q_server_reduce, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = REDUCE_FAIL;
+
+            if (mq_unlink(msg.resp_queue_name) == -1)
+                result = REDUCE_FAIL;
+        }
+        else // couldn't open response queue
+            result = REDUCE_FAIL;
+
+        if (mq_close(q_server_reduce) == -1) 
+            result = REDUCE_FAIL;
+    }
+
+    return result;
+}
+
+
+
+int get_sum(char* name, int start, int end, long long* p_sum)
+{
+    struct reduce_resp_msg response;
+    int result = run_reduce(name, REDUCE_OP_SUM, start, end, &response);
+
+    if (result == REDUCE_SUCCESS)
+        *p_sum = response.value;
+
+    return result;
+}
+
+
+
+int get_min(char* name, int start, int end, int* p_min)
+{
+    struct reduce_resp_msg response;
+    int result = run_reduce(name, REDUCE_OP_MIN, start, end, &response);
+
+    if (result == REDUCE_SUCCESS)
+        *p_min = (int) response.value;
+
+    return result;
+}
+
+
+
+int get_max(char* name, int start, int end, int* p_max)
+{
+    struct reduce_resp_msg response;
+    int result = run_reduce(name, REDUCE_OP_MAX, start, end, &response);
+
+    if (result == REDUCE_SUCCESS)
+        *p_max = (int) response.value;
+
+    return result;
+}
+
+
+
+int get_mean(char* name, int start, int end, double* p_mean)
+{
+    struct reduce_resp_msg response;
+    int result = run_reduce(name, REDUCE_OP_MEAN, start, end, &response);
+
+    if (result == REDUCE_SUCCESS)
+        *p_mean = response.mean;
+
+    return result;
+}
+
+
+
+int count_nonzero(char* name, int start, int end, int* p_count)
+{
+    struct reduce_resp_msg response;
+    int result = run_reduce(name, REDUCE_OP_COUNT_NONZERO, start, end, &response);
+
+    if (result == REDUCE_SUCCESS)
+        *p_count = (int) response.value;
+
+    return result;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// element-wise operations
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int elementwise_on_server(struct elementwise_msg* p_msg, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = ELEMENTWISE_FAIL;
+
+    if (send_request(*p_q_server, OP_ELEMENTWISE, p_msg, ELEMENTWISE_MSG_SIZE) == 0)
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1)
+            result = response.op.result;
+    }
+
+    return result;
+}
+
+
+
+int run_elementwise(int op, char* target, char* x, char* y, int k)
+{
+    if (!is_name_valid(target) || !is_name_valid(x) || 
+        (op != ELEMENTWISE_OP_SCALE && !is_name_valid(y)))
+    {
+        return ELEMENTWISE_FAIL;
+    }
+
+    int result = ELEMENTWISE_SUCCESS;
+    mqd_t q_server_elementwise;
+    struct session* p_session;
+
+    struct elementwise_msg msg;
+    memset(&msg, 0, ELEMENTWISE_MSG_SIZE);
+    msg.op = op;
+    msg.k = k;
+    strcpy(msg.target, target);
+    strcpy(msg.x, x);
+    if (op != ELEMENTWISE_OP_SCALE)
+        strcpy(msg.y, y);
+
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+        result = elementwise_on_server(&msg, &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_elementwise = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = ELEMENTWISE_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        if (open_resp_queue(ELEMENTWISE_RESP_QUEUE_PREFIX, msg.resp_queue_name, &q_resp, 
+            OP_RESP_MSG_SIZE) == 1)
+        {
+            result = elementwise_on_server(&msg, &q_server_elementwise, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = ELEMENTWISE_FAIL;
+
+            if (mq_unlink(msg.resp_queue_name) == -1)
+                result = ELEMENTWISE_FAIL;
+        }
+        else // couldn't open response queue
+            result = ELEMENTWISE_FAIL;
+
+        if (mq_close(q_server_elementwise) == -1) 
+            result = ELEMENTWISE_FAIL;
+    }
+
+    return result;
+}
+
+
+
+int vector_add(char* target, char* a, char* b)
+{
+    return run_elementwise(ELEMENTWISE_OP_ADD, target, a, b, 0);
+}
+
+
+
+int vector_scale(char* target, char* a, int k)
+{
+    return run_elementwise(ELEMENTWISE_OP_SCALE, target, a, NULL, k);
+}
+
+
+
+int vector_axpy(char* target, int k, char* x, char* y)
+{
+    return run_elementwise(ELEMENTWISE_OP_AXPY, target, x, y, k);
+}
+
+
+
+int vector_min(char* target, char* a, char* b)
+{
+    return run_elementwise(ELEMENTWISE_OP_MIN, target, a, b, 0);
+}
+
+
+
+int vector_max(char* target, char* a, char* b)
+{
+    return run_elementwise(ELEMENTWISE_OP_MAX, target, a, b, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// distances
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int distance_on_server(struct distance_msg* p_msg, double* p_value, mqd_t* p_q_server, 
+    mqd_t* p_q_resp)
+{
+    int result = DISTANCE_FAIL;
+
+    if (send_request(*p_q_server, OP_DISTANCE, p_msg, DISTANCE_MSG_SIZE) == 0)
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1)
+        {
+            result = response.distance.error;
+
+            if (result == DISTANCE_SUCCESS)
+                *p_value = response.distance.value;
+        }
+    }
+
+    return result;
+}
+
+
+
+int get_distance(char* a, char* b, int metric, double* p_value)
+{
+    if (!is_name_valid(a) || !is_name_valid(b))
+        return DISTANCE_FAIL;
+
+    int result = DISTANCE_SUCCESS;
+    mqd_t q_server_distance;
+    struct session* p_session;
+
+    struct distance_msg msg;
+    msg.metric = metric;
+    msg.request_id = 0;
+    strcpy(msg.a, a);
+    strcpy(msg.b, b);
+
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+        result = distance_on_server(&msg, p_value, &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_distance = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = DISTANCE_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        if (open_resp_queue(DISTANCE_RESP_QUEUE_PREFIX, msg.resp_queue_name, &q_resp, 
+            DISTANCE_RESP_MSG_SIZE) == 1)
+        {
+            result = distance_on_server(&msg, p_value, &q_server_distance, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = DISTANCE_FAIL;
+
+            if (mq_unlink(msg.resp_queue_name) == -1)
+                result = DISTANCE_FAIL;
+        }
+        else // couldn't open response queue
+            result = DISTANCE_FAIL;
+
+        if (mq_close(q_server_distance) == -1) 
+            result = DISTANCE_FAIL;
+    }
+
+    return result;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// nearest vectors
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void insert_nearest(int metric, int k, int* indexes, double* values, int* p_len, int index, 
+    double value)
+{
+    // similarities are nearer when greater, distances when smaller
+    int greater_is_nearer = metric == METRIC_DOT || metric == METRIC_COSINE;
+    int pos = *p_len;
+
+    while (pos > 0 && (greater_is_nearer ? value > values[pos - 1] : value < values[pos - 1]))
+        pos--;
+
+    if (pos >= k) // not among the k nearest
+        return;
+
+    int last = *p_len < k ? *p_len : k - 1;
+    for (int i = last; i > pos; i--)
+    {
+        indexes[i] = indexes[i - 1];
+        values[i] = values[i - 1];
+    }
+
+    indexes[pos] = index;
+    values[pos] = value;
+
+    if (*p_len < k)
+        (*p_len)++;
+}
+
+
+
+int nearest_on_server(struct nearest_msg* p_msg, int* indexes, double* values, int* p_len, 
+    int first, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = NEAREST_FAIL;
+
+    // only the filled part of candidates is sent
+    size_t msg_size = NEAREST_MSG_HEADER_SIZE + 
+        (size_t) p_msg->num_of_candidates * MAX_VECTOR_NAME_LEN;
+
+    if (send_request(*p_q_server, OP_NEAREST, p_msg, msg_size) == 0)
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1)
+        {
+            result = response.nearest.error;
+
+            // merged with the nearest of previous chunks of candidates
+            for (int i = 0; i < response.nearest.len && result == NEAREST_SUCCESS; i++)
+            {
+                insert_nearest(p_msg->metric, p_msg->k, indexes, values, p_len, 
+                    first + response.nearest.indexes[i], response.nearest.values[i]);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+
+/*
+    sends the candidates in chunks of at most MAX_NEAREST_CANDIDATES, stops on the first failed
+    chunk
+*/
+int nearest_in_chunks(struct nearest_msg* p_msg, char** candidates, int num_of_candidates, 
+    int* indexes, double* values, int* p_len, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = NEAREST_SUCCESS;
+
+    for (int done = 0; done < num_of_candidates && result == NEAREST_SUCCESS; 
+        done += MAX_NEAREST_CANDIDATES)
+    {
+        p_msg->num_of_candidates = num_of_candidates - done < MAX_NEAREST_CANDIDATES ? 
+            num_of_candidates - done : MAX_NEAREST_CANDIDATES;
+
+        for (int i = 0; i < p_msg->num_of_candidates; i++)
+            strcpy(p_msg->candidates[i], candidates[done + i]);
+
+        result = nearest_on_server(p_msg, indexes, values, p_len, done, p_q_server, p_q_resp);
+    }
+
+    return result;
+}
+
+
+
+int find_nearest(char* query, char** candidates, int num_of_candidates, int metric, int k, 
+    int* indexes, double* values)
+{
+    if (!is_name_valid(query) || num_of_candidates < 0 || k < 1 || k > MAX_NEAREST_K)
+        return NEAREST_FAIL;
+
+    for (int i = 0; i < num_of_candidates; i++)
+    {
+        if (!is_name_valid(candidates[i]))
+            return NEAREST_FAIL;
+    }
+
+    int result = NEAREST_SUCCESS;
+    int len = 0;
+    mqd_t q_server_nearest;
+    struct session* p_session;
+
+    struct nearest_msg msg;
+    msg.metric = metric;
+    msg.k = k;
+    msg.request_id = 0;
+    strcpy(msg.query, query);
+
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+        result = nearest_in_chunks(&msg, candidates, num_of_candidates, indexes, values, &len, 
+            &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_nearest = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = NEAREST_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        if (open_resp_queue(NEAREST_RESP_QUEUE_PREFIX, msg.resp_queue_name, &q_resp, 
+            NEAREST_RESP_MSG_SIZE) == 1)
+        {
+            result = nearest_in_chunks(&msg, candidates, num_of_candidates, indexes, values, 
+                &len, &q_server_nearest, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = NEAREST_FAIL;
+
+            if (mq_unlink(msg.resp_queue_name) == -1)
+                result = NEAREST_FAIL;
+        }
+        else // couldn't open response queue
+            result = NEAREST_FAIL;
+
+        if (mq_close(q_server_nearest) == -1) 
+            result = NEAREST_FAIL;
+    }
+
+    return result == NEAREST_SUCCESS ? len : NEAREST_FAIL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// bulk import and export
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int transfer_on_server(struct transfer_msg* p_msg, mqd_t* p_q_server, mqd_t* p_q_resp)
+{
+    int result = TRANSFER_FAIL;
+
+    if (send_request(*p_q_server, OP_TRANSFER, p_msg, TRANSFER_MSG_SIZE) == 0)
+    {
+        union resp_msg response;
+
+        // wait for response
+        if (mq_receive(*p_q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1 &&
+            response.op.result == TRANSFER_SUCCESS)
+        {
+            result = response.op.value;
+        }
+    }
+
+    return result;
+}
+
+
+
+int run_transfer(struct transfer_msg* p_msg)
+{
+    int result = TRANSFER_FAIL;
+    mqd_t q_server_transfer;
+    struct session* p_session;
+
+    p_msg->request_id = 0;
+
+    if ((p_session = get_session()) != NULL) // connected, reuse the queues
+    {
+        strcpy(p_msg->resp_queue_name, p_session->resp_queue_name);
+        result = transfer_on_server(p_msg, &connection.q_requests, &p_session->q_resp);
+    }
+    else if ((q_server_transfer = mq_open(REQUESTS_QUEUE_NAME, O_WRONLY)) == -1)
+        result = TRANSFER_FAIL;
+    else
+    {
+        // queue for response from server
+        mqd_t q_resp;
+        if (open_resp_queue(TRANSFER_RESP_QUEUE_PREFIX, p_msg->resp_queue_name, &q_resp, 
+            OP_RESP_MSG_SIZE) == 1)
+        {
+            result = transfer_on_server(p_msg, &q_server_transfer, &q_resp);
+
+            // close and delete response queue
+            if (mq_close(q_resp) == -1)
+                result = TRANSFER_FAIL;
+
+            if (mq_unlink(p_msg->resp_queue_name) == -1)
+                result = TRANSFER_FAIL;
+        }
+        else // couldn't open response queue
+            result = TRANSFER_FAIL;
+
+        if (mq_close(q_server_transfer) == -1) 
+            result = TRANSFER_FAIL;
+    }
+
+    return result;
+}
+
+
+
+int transfer_file(char* name, char* file_name, int op, int format)
+{
+    if (!is_name_valid(name) || 
+        (format != TRANSFER_FORMAT_BINARY && format != TRANSFER_FORMAT_TEXT))
+    {
+        return TRANSFER_FAIL;
+    }
+
+    struct transfer_msg msg;
+    msg.op = op;
+    msg.format = format;
+    msg.len = 0;
+    strcpy(msg.name, name);
+
+    // the server has another working directory
+    char cwd[MAX_TRANSFER_PATH_LEN];
+    int path_len;
+
+    if (file_name[0] == '/')
+        path_len = snprintf(msg.path, MAX_TRANSFER_PATH_LEN, "%s", file_name);
+    else if (getcwd(cwd, MAX_TRANSFER_PATH_LEN) != NULL)
+        path_len = snprintf(msg.path, MAX_TRANSFER_PATH_LEN, "%s/%s", cwd, file_name);
+    else
+        return TRANSFER_FAIL;
+
+    if (path_len >= MAX_TRANSFER_PATH_LEN)
+        return TRANSFER_FAIL;
+
+    return run_transfer(&msg);
+}
+
+
+
+int transfer_buffer(char* name, int* buf, int len, int op)
+{
+    if (!is_name_valid(name) || len < 1)
+        return TRANSFER_FAIL;
+
+    struct transfer_msg msg;
+    msg.op = op;
+    msg.format = TRANSFER_FORMAT_SHM;
+    msg.len = len;
+    strcpy(msg.name, name);
+    snprintf(msg.path, MAX_TRANSFER_PATH_LEN, "/%s%d_%ld", TRANSFER_SHM_PREFIX, getpid(), 
+        (long) syscall(SYS_gettid));
+
+    int result = TRANSFER_FAIL;
+    size_t num_of_bytes = (size_t) len * sizeof(int);
+
+    // a buffer left by a crashed thread with the same id is replaced
+    shm_unlink(msg.path);
+
+    int fd;
+    if ((fd = shm_open(msg.path, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR)) == -1)
+        return TRANSFER_FAIL;
+
+    void* p_map = MAP_FAILED;
+    if (ftruncate(fd, (off_t) num_of_bytes) == 0)
+        p_map = mmap(NULL, num_of_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays valid
+
+    if (p_map != MAP_FAILED)
+    {
+        if (op == TRANSFER_OP_IMPORT)
+            memcpy(p_map, buf, num_of_bytes);
+
+        result = run_transfer(&msg);
+
+        if (op == TRANSFER_OP_EXPORT && result > 0)
+            memcpy(buf, p_map, (size_t) result * sizeof(int));
+
+        munmap(p_map, num_of_bytes);
+    }
+
+    shm_unlink(msg.path);
+
+    return result;
+}
+
+
+
+int import_vector(char* name, char* file_name, int format)
+{
+    return transfer_file(name, file_name, TRANSFER_OP_IMPORT, format);
+}
+
+
+
+int export_vector(char* name, char* file_name, int format)
+{
+    return transfer_file(name, file_name, TRANSFER_OP_EXPORT, format);
+}
+
+
+
+int import_vector_from_buffer(char* name, int* buf, int len)
+{
+    return transfer_buffer(name, buf, len, TRANSFER_OP_IMPORT);
+}
+
+
+
+int export_vector_to_buffer(char* name, int* buf, int len)
+{
+    return transfer_buffer(name, buf, len, TRANSFER_OP_EXPORT);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// vector handles
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+struct session* get_handle_session()
+{
+    struct session* p_session = get_session();
+
+    if (p_session != NULL && p_session->client_id < 0)
+    {
+        struct handle_msg msg;
+        msg.op = HANDLE_OP_REGISTER;
+        msg.request_id = 0;
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+
+        union resp_msg response;
+
+        if (send_request(connection.q_requests, OP_HANDLE, &msg, HANDLE_MSG_SIZE) == -1 ||
+            mq_receive(p_session->q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1 ||
+            response.op.result < 0)
+        {
+            return NULL;
+        }
+
+        p_session->client_id = response.op.result;
+    }
+
+    return p_session;
+}
+
+
+
+int call_handle_op(struct session* p_session, int op, int handle, int pos, int value, 
+    char* name, int* p_value)
+{
+    // create message
+    struct handle_msg msg;
+    msg.op = op;
+    msg.client_id = p_session->client_id;
+    msg.handle = handle;
+    msg.pos = pos;
+    msg.value = value;
+    msg.request_id = 0;
+
+    size_t msg_size = HANDLE_MSG_HEADER_SIZE;
+    if (name != NULL)
+    {
+        strcpy(msg.name, name);
+        msg_size = HANDLE_OPEN_MSG_SIZE;
+    }
+
+    union resp_msg response;
+
+    // send message and wait for response, all fail codes are -1
+    if (send_request(connection.q_requests, OP_HANDLE, &msg, msg_size) == -1 ||
+        mq_receive(p_session->q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) == -1)
+    {
+        return -1;
+    }
+
+    if (p_value != NULL)
+        *p_value = response.op.value;
+
+    return response.op.result;
+}
+
+
+
+int open_vector(char* name)
+{
+    struct session* p_session;
+
+    if (!is_name_valid(name) || strlen(name) >= MAX_VECTOR_NAME_LEN || 
+        (p_session = get_handle_session()) == NULL)
+    {
+        return HANDLE_FAIL;
+    }
+
+    int handle = call_handle_op(p_session, HANDLE_OP_OPEN, 0, 0, 0, name, NULL);
+
+    if (handle != HANDLE_FAIL && !track_open_handle(handle))
+    {
+        call_handle_op(p_session, HANDLE_OP_CLOSE, handle, 0, 0, NULL, NULL);
+        handle = HANDLE_FAIL;
+    }
+
+    return handle;
+}
+
+
+
+int close_vector(int handle)
+{
+    struct session* p_session;
+
+    if ((p_session = get_handle_session()) == NULL)
+        return HANDLE_FAIL;
+
+    int result = call_handle_op(p_session, HANDLE_OP_CLOSE, handle, 0, 0, NULL, NULL);
+
+    if (result == HANDLE_SUCCESS)
+        untrack_open_handle(handle);
+
+    return result;
+}
+
+
+
+int track_open_handle(int handle)
+{
+    int res = 1;
+
+    if (pthread_mutex_lock(&mutex_connection) != 0)
+        return 0;
+
+    if (connection.num_of_open_handles == connection.open_handles_capacity)
+    {
+        int new_capacity = connection.open_handles_capacity == 0 ? 16 : 
+            2 * connection.open_handles_capacity;
+        int* new_handles = (int*) realloc(connection.open_handles, new_capacity * sizeof(int));
+
+        if (new_handles != NULL)
+        {
+            connection.open_handles = new_handles;
+            connection.open_handles_capacity = new_capacity;
+        }
+        else
+            res = 0;
+    }
+
+    if (res)
+        connection.open_handles[connection.num_of_open_handles++] = handle;
+
+    pthread_mutex_unlock(&mutex_connection);
+
+    return res;
+}
+
+
+
+void untrack_open_handle(int handle)
+{
+    if (pthread_mutex_lock(&mutex_connection) != 0)
+        return;
+
+    for (int i = 0; i < connection.num_of_open_handles; i++)
+    {
+        if (connection.open_handles[i] == handle)
+        {
+            connection.open_handles[i] = 
+                connection.open_handles[--connection.num_of_open_handles];
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex_connection);
+}
+
+
+
+int set_by_handle(int handle, int pos, int val)
+{
+    struct session* p_session;
+
+    if ((p_session = get_handle_session()) == NULL)
+        return SET_FAIL;
+
+    return call_handle_op(p_session, HANDLE_OP_SET, handle, pos, val, NULL, NULL);
+}
+
+
+
+int get_by_handle(int handle, int pos, int* value)
+{
+    struct session* p_session;
+
+    if ((p_session = get_handle_session()) == NULL)
+        return GET_FAIL;
+
+    return call_handle_op(p_session, HANDLE_OP_GET, handle, pos, 0, NULL, value);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// asynchronous requests
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+struct session* get_async_session()
+{
+    struct session* p_session = get_session();
+
+    if (p_session != NULL && !p_session->has_async_queue)
+    {
+        if (!open_session_queue(ASYNC_RESP_QUEUE_PREFIX, p_session->async_resp_queue_name, 
+            ASYNC_MAX_IN_FLIGHT, OP_RESP_MSG_SIZE, &p_session->q_async_resp))
+        {
+            return NULL;
+        }
+
+        p_session->has_async_queue = 1;
+    }
+
+    return p_session;
+}
+
+
+
+int send_async_request(struct session* p_session, int op, char* name, int pos, int value, 
+    int request_id)
+{
+    int res = 0;
+
+    switch (op)
+    {
+        case ASYNC_OP_INIT:
+        {
+            struct init_msg msg;
+            msg.size = pos;
+            msg.durability = DURABILITY_DEFAULT;
+            msg.request_id = request_id;
+            strcpy(msg.name, name);
+            strcpy(msg.resp_queue_name, p_session->async_resp_queue_name);
+            res = send_request(connection.q_requests, OP_INIT_VECTOR, &msg, INIT_MSG_SIZE) == 0;
+            break;
+        }
+        case ASYNC_OP_SET:
+        {
+            struct set_msg msg;
+            msg.pos = pos;
+            msg.value = value;
+            msg.request_id = request_id;
+            strcpy(msg.name, name);
+            strcpy(msg.resp_queue_name, p_session->async_resp_queue_name);
+            res = send_request(connection.q_requests, OP_SET, &msg, SET_MSG_SIZE) == 0;
+            break;
+        }
+        case ASYNC_OP_GET:
+        {
+            struct get_msg msg;
+            msg.pos = pos;
+            msg.request_id = request_id;
+            strcpy(msg.name, name);
+            strcpy(msg.resp_queue_name, p_session->async_resp_queue_name);
+            res = send_request(connection.q_requests, OP_GET, &msg, GET_MSG_SIZE) == 0;
+            break;
+        }
+        case ASYNC_OP_DESTROY:
+        {
+            struct destroy_msg msg;
+            msg.request_id = request_id;
+            strcpy(msg.name, name);
+            strcpy(msg.resp_queue_name, p_session->async_resp_queue_name);
+            res = send_request(connection.q_requests, OP_DESTROY, &msg, DESTROY_MSG_SIZE) == 0;
+            break;
+        }
+    }
+
+    return res;
+}
+
+
+
+int receive_async_response(struct session* p_session, int wait)
+{
+    struct op_resp_msg response;
+    ssize_t received;
+
+    if (wait)
+        received = mq_receive(p_session->q_async_resp, (char*) &response, OP_RESP_MSG_SIZE, 
+            NULL);
+    else
+    {
+        // timeout already passed, returns at once if the queue is empty
+        struct timespec timeout = { 0, 0 };
+        received = mq_timedreceive(p_session->q_async_resp, (char*) &response, 
+            OP_RESP_MSG_SIZE, NULL, &timeout);
+
+        if (received == -1 && errno == ETIMEDOUT)
+            return 0;
+    }
+
+    if (received != (ssize_t) OP_RESP_MSG_SIZE || response.request_id < 0)
+        return -1;
+
+    struct async_request* p_request = 
+        &p_session->requests[response.request_id % ASYNC_MAX_REQUESTS];
+
+    if (p_request->id == response.request_id && p_request->state == ASYNC_STATE_PENDING)
+    {
+        p_request->state = ASYNC_STATE_DONE;
+        p_request->result = response.result;
+        p_request->value = response.value;
+        p_session->num_in_flight--;
+    }
+
+    return 1;
+}
+
+
+
+int submit_request(int op, char* name, int pos, int value)
+{
+    struct session* p_session;
+
+    if (strlen(name) >= MAX_VECTOR_NAME_LEN || (p_session = get_async_session()) == NULL)
+        return ASYNC_FAIL;
+
+    int request_id = p_session->next_request_id;
+    struct async_request* p_request = &p_session->requests[request_id % ASYNC_MAX_REQUESTS];
+
+    // result of the request submitted ASYNC_MAX_REQUESTS requests ago wasn't collected
+    if (p_request->state != ASYNC_STATE_FREE)
+        return ASYNC_FAIL;
+
+    // make room in the response queue
+    while (p_session->num_in_flight >= ASYNC_MAX_IN_FLIGHT)
+    {
+        if (receive_async_response(p_session, 1) == -1)
+            return ASYNC_FAIL;
+    }
+
+    if (!send_async_request(p_session, op, name, pos, value, request_id))
+        return ASYNC_FAIL;
+
+    p_request->id = request_id;
+    p_request->state = ASYNC_STATE_PENDING;
+    p_session->num_in_flight++;
+    p_session->next_request_id = (request_id + 1) & INT_MAX;
+
+    return request_id;
+}
+
+
+
+int submit_init(char* name, int size)
+{
+    if (!is_init_data_valid(name, size))
+        return ASYNC_FAIL;
+
+    return submit_request(ASYNC_OP_INIT, name, size, 0);
+}
+
+
+
+int submit_set(char* name, int pos, int val)
+{
+    return submit_request(ASYNC_OP_SET, name, pos, val);
+}
+
+
+
+int submit_get(char* name, int pos)
+{
+    return submit_request(ASYNC_OP_GET, name, pos, 0);
+}
+
+
+
+int submit_destroy(char* vec_name)
+{
+    return submit_request(ASYNC_OP_DESTROY, vec_name, 0, 0);
+}
+
+
+
+/*
+    receives responses until the request is done or, if wait is 0, until there are no more 
+    responses. Collects the request if it's done. REQUEST_DONE, REQUEST_PENDING or ASYNC_FAIL
+*/
+int complete_request(int request_id, int* p_result, int* p_value, int wait)
+{
+    struct session* p_session = get_session();
+
+    if (p_session == NULL || !p_session->has_async_queue || request_id < 0)
+        return ASYNC_FAIL;
+
+    struct async_request* p_request = &p_session->requests[request_id % ASYNC_MAX_REQUESTS];
+
+    if (p_request->id != request_id || p_request->state == ASYNC_STATE_FREE)
+        return ASYNC_FAIL;
+
+    while (p_request->state == ASYNC_STATE_PENDING)
+    {
+        int received = receive_async_response(p_session, wait);
+
+        if (received == -1)
+            return ASYNC_FAIL;
+        if (received == 0) // nothing more arrived
+            return REQUEST_PENDING;
+    }
+
+    *p_result = p_request->result;
+    if (p_value != NULL)
+        *p_value = p_request->value;
+    p_request->state = ASYNC_STATE_FREE;
+
+    return REQUEST_DONE;
+}
+
+
+
+int poll_request(int request_id, int* p_result, int* p_value)
+{
+    return complete_request(request_id, p_result, p_value, 0);
+}
+
+
+
+int wait_request(int request_id, int* p_result, int* p_value)
+{
+    return complete_request(request_id, p_result, p_value, 1);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// connect / disconnect
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int open_server_queue(char* name, mqd_t* p_queue)
+{
+    if ((*p_queue = mq_open(name, O_WRONLY)) == -1)
+        return 0;
+
+    return 1;
+}
+
+
+
+int send_request(mqd_t q_server, int opcode, void* p_body, size_t body_size)
+{
+    struct request_msg msg;
+    msg.opcode = opcode;
+    memcpy(&msg.body, p_body, body_size);
+
+    // classified by the copy, the body of the caller may be smaller than the union
+    unsigned int priority = __atomic_load_n(
+        &request_priorities[get_request_class(opcode, &msg.body)], __ATOMIC_RELAXED);
+
+    return mq_send(q_server, (char*) &msg, REQUEST_MSG_HEADER_SIZE + body_size, priority);
+}
+
+
+
+int get_request_class(int opcode, union request_body* p_request)
+{
+    int request_class = REQUEST_CLASS_BULK;
+
+    switch (opcode)
+    {
+        case OP_GET:
+            request_class = REQUEST_CLASS_READ;
+            break;
+        case OP_SET:
+        case OP_RMW:
+            request_class = REQUEST_CLASS_WRITE;
+            break;
+        case OP_BATCH:
+            if (p_request->batch.op == BATCH_OP_GET)
+                request_class = REQUEST_CLASS_READ;
+            break;
+        case OP_RANGE:
+            if (p_request->range.op == RANGE_OP_GET)
+                request_class = REQUEST_CLASS_READ;
+            break;
+        case OP_HANDLE:
+            if (p_request->handle.op == HANDLE_OP_GET)
+                request_class = REQUEST_CLASS_READ;
+            else if (p_request->handle.op == HANDLE_OP_SET)
+                request_class = REQUEST_CLASS_WRITE;
+            break;
+    }
+
+    return request_class;
+}
+
+
+
+int set_request_priorities(int read_priority, int write_priority, int bulk_priority)
+{
+    int priorities[NUM_OF_REQUEST_CLASSES] = { read_priority, write_priority, bulk_priority };
+
+    for (int i = 0; i < NUM_OF_REQUEST_CLASSES; i++)
+    {
+        if (priorities[i] < 0 || priorities[i] > MAX_REQUEST_PRIORITY)
+            return PRIORITIES_FAIL;
+    }
+
+    for (int i = 0; i < NUM_OF_REQUEST_CLASSES; i++)
+        __atomic_store_n(&request_priorities[i], priorities[i], __ATOMIC_RELAXED);
+
+    return PRIORITIES_SUCCESS;
+}
+
+
+
+int connect_server()
+{
+    return connect_with_transport(0);
+}
+
+
+
+int connect_server_shm()
+{
+    return connect_with_transport(1);
+}
+
+
+
+int connect_with_transport(int use_shm)
+{
+    int result = CONNECT_SUCCESS;
+
+    if (pthread_mutex_lock(&mutex_connection) != 0)
+        return CONNECT_FAIL;
+
+    if (!connection.connected)
+    {
+        if (open_server_queue(REQUESTS_QUEUE_NAME, &connection.q_requests))
+        {
+            connection.use_shm = use_shm;
+            connection.generation++;
+            // 0 means "no session" in struct session
+            if (connection.generation == 0)
+                connection.generation++;
+
+            __atomic_store_n(&connection.connected, 1, __ATOMIC_RELEASE);
+        }
+        else
+            result = CONNECT_FAIL;
+    }
+
+    pthread_mutex_unlock(&mutex_connection);
+
+    return result;
+}
+
+
+
+int disconnect_server()
+{
+    int result = DISCONNECT_SUCCESS;
+
+    if (pthread_mutex_lock(&mutex_connection) != 0)
+        return DISCONNECT_FAIL;
+
+    if (connection.connected)
+    {
+        __atomic_store_n(&connection.connected, 0, __ATOMIC_RELEASE);
+
+        // handles which weren't closed, client id -1 --> no response
+        for (int i = 0; i < connection.num_of_open_handles; i++)
+        {
+            struct handle_msg msg;
+            msg.op = HANDLE_OP_CLOSE;
+            msg.client_id = -1;
+            msg.handle = connection.open_handles[i];
+            if (send_request(connection.q_requests, OP_HANDLE, &msg, HANDLE_MSG_HEADER_SIZE) == -1)
+                result = DISCONNECT_FAIL;
+        }
+        connection.num_of_open_handles = 0;
+
+        // the server closes its descriptors of registered response queues
+        for (struct session* p_session = sessions; p_session != NULL; 
+            p_session = p_session->p_next)
+        {
+            if (p_session->client_id >= 0)
+            {
+                struct handle_msg msg;
+                msg.op = HANDLE_OP_UNREGISTER;
+                msg.client_id = p_session->client_id;
+                if (send_request(connection.q_requests, OP_HANDLE, &msg, 
+                    HANDLE_MSG_HEADER_SIZE) == -1)
+                {
+                    result = DISCONNECT_FAIL;
+                }
+                p_session->client_id = -1;
+            }
+        }
+
+
+        if (mq_close(connection.q_requests) == -1)
+            result = DISCONNECT_FAIL;
+
+        // sessions of all threads become stale, their queues are removed here
+        while (sessions != NULL)
+        {
+            struct session* p_session = sessions;
+            sessions = p_session->p_next;
+
+            if (p_session->p_channel != NULL)
+                detach_shm_channel(p_session);
+
+            if (p_session->has_async_queue && (mq_close(p_session->q_async_resp) == -1 || 
+                mq_unlink(p_session->async_resp_queue_name) == -1))
+            {
+                result = DISCONNECT_FAIL;
+            }
+            p_session->has_async_queue = 0;
+
+            if (mq_close(p_session->q_resp) == -1 || mq_unlink(p_session->resp_queue_name) == -1)
+                result = DISCONNECT_FAIL;
+
+            p_session->generation = 0;
+        }
+    }
+    else
+        result = DISCONNECT_FAIL;
+
+    pthread_mutex_unlock(&mutex_connection);
+
+    return result;
+}
+
+
+
+struct session* get_session()
+{
+    if (!__atomic_load_n(&connection.connected, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    if (p_thread_session != NULL && 
+        __atomic_load_n(&p_thread_session->generation, __ATOMIC_ACQUIRE) == 
+        connection.generation)
+    {
+        return p_thread_session;
+    }
+
+    struct session* res = NULL;
+
+    if (pthread_mutex_lock(&mutex_connection) != 0)
+        return NULL;
+
+    if (connection.connected)
+    {
+        if (p_thread_session == NULL)
+            p_thread_session = (struct session*) calloc(1, sizeof(struct session));
+
+        mqd_t q_resp;
+
+        if (p_thread_session != NULL && open_session_queue(SESSION_RESP_QUEUE_PREFIX, 
+            p_thread_session->resp_queue_name, 1, RESP_MSG_MAX_SIZE, &q_resp))
+        {
+            p_thread_session->q_resp = q_resp;
+            p_thread_session->p_channel = NULL;
+            p_thread_session->has_async_queue = 0;
+            p_thread_session->num_in_flight = 0;
+            memset(p_thread_session->requests, 0, sizeof(p_thread_session->requests));
+            p_thread_session->client_id = -1;
+
+            // on failure the thread uses message queues
+            if (connection.use_shm)
+                attach_shm_channel(p_thread_session);
+
+            p_thread_session->p_next = sessions;
+            sessions = p_thread_session;
+            __atomic_store_n(&p_thread_session->generation, connection.generation, 
+                __ATOMIC_RELEASE);
+            res = p_thread_session;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex_connection);
+
+    return res;
+}
+
+
+
+int open_session_queue(char* prefix, char* que_name, long max_msgs, long msg_size, 
+    mqd_t* p_queue)
+{
+    struct mq_attr attr;
+    attr.mq_flags = 0;
+    attr.mq_maxmsg = max_msgs;
+    attr.mq_msgsize = msg_size;
+    attr.mq_curmsgs = 0;
+
+    // pid and thread id together are unique in the whole system
+    snprintf(que_name, MAX_RESP_QUEUE_NAME_LEN, "/%s%d_%ld", prefix, getpid(), 
+        (long) syscall(SYS_gettid));
+
+    int flags = O_CREAT | O_EXCL | O_RDONLY;
+    *p_queue = mq_open(que_name, flags, S_IRUSR | S_IWUSR, &attr);
+
+    // left by a process which had the same pid and didn't disconnect
+    if (*p_queue == -1 && errno == EEXIST && mq_unlink(que_name) == 0)
+        *p_queue = mq_open(que_name, flags, S_IRUSR | S_IWUSR, &attr);
+
+    return *p_queue != -1;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// shared memory transport
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int attach_shm_channel(struct session* p_session)
+{
+    char shm_name[MAX_SHM_NAME_LEN];
+    snprintf(shm_name, MAX_SHM_NAME_LEN, "/%s%d_%ld", SESSION_SHM_PREFIX, getpid(), 
+        (long) syscall(SYS_gettid));
+
+    int fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+
+    // left by a process which had the same pid and didn't disconnect
+    if (fd == -1 && errno == EEXIST && shm_unlink(shm_name) == 0)
+        fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+
+    if (fd == -1)
+        return 0;
+
+    int result = 0;
+    void* p_map = MAP_FAILED;
+
+    if (ftruncate(fd, sizeof(struct shm_channel)) == 0)
+    {
+        // new shared memory is zero filled, so both rings are empty
+        p_map = mmap(NULL, sizeof(struct shm_channel), PROT_READ | PROT_WRITE, MAP_SHARED, 
+            fd, 0);
+    }
+
+    if (p_map != MAP_FAILED)
+    {
+        struct attach_msg msg;
+        strcpy(msg.shm_name, shm_name);
+        strcpy(msg.resp_queue_name, p_session->resp_queue_name);
+
+        union resp_msg response;
+
+        if (send_request(connection.q_requests, OP_ATTACH, &msg, ATTACH_MSG_SIZE) == 0 &&
+            mq_receive(p_session->q_resp, (char*) &response, RESP_MSG_MAX_SIZE, NULL) != -1 &&
+            response.result == ATTACH_SUCCESS)
+        {
+            p_session->p_channel = (struct shm_channel*) p_map;
+            p_session->req_tail = 0;
+            result = 1;
+        }
+        else
+            munmap(p_map, sizeof(struct shm_channel));
+    }
+
+    // both sides have it mapped now, the name is not needed anymore
+    close(fd);
+    shm_unlink(shm_name);
+
+    return result;
+}
+
+
+
+void detach_shm_channel(struct session* p_session)
+{
+    struct shm_channel* p_channel = p_session->p_channel;
+
+    // the server has its own mapping, it doesn't need ours to read the detach request
+    struct shm_request* p_request = &p_channel->requests[p_session->req_tail % SHM_RING_CAPACITY];
+    p_request->op = SHM_OP_DETACH;
+    p_session->req_tail++;
+
+    __atomic_store_n(&p_channel->req_tail, p_session->req_tail, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&p_channel->server_sleeping, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &p_channel->req_tail, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+    munmap(p_channel, sizeof(struct shm_channel));
+    p_session->p_channel = NULL;
+}
+
+
+
+int call_over_shm(struct session* p_session, int op, char* name, int pos, int value, 
+    int* p_value)
+{
+    // all fail codes of init, set, get and destroy are -1
+    if (strlen(name) >= MAX_VECTOR_NAME_LEN)
+        return -1;
+
+    struct shm_channel* p_channel = p_session->p_channel;
+    uint32_t idx = p_session->req_tail;
+
+    struct shm_request* p_request = &p_channel->requests[idx % SHM_RING_CAPACITY];
+    p_request->op = op;
+    p_request->pos = pos;
+    p_request->value = value;
+    strcpy(p_request->name, name);
+
+    // publish the request
+    p_session->req_tail = idx + 1;
+    __atomic_store_n(&p_channel->req_tail, idx + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&p_channel->server_sleeping, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &p_channel->req_tail, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+    // response to the request idx is written at the same index
+    wait_for_shm_ring(&p_channel->resp_tail, &p_channel->client_sleeping, idx);
+
+    struct shm_response* p_response = &p_channel->responses[idx % SHM_RING_CAPACITY];
+    if (p_value != NULL)
+        *p_value = p_response->value;
+
+    return p_response->result;
+}
+
+
+
+void wait_for_shm_ring(uint32_t* p_tail, uint32_t* p_sleeping, uint32_t head)
+{
+    for (int i = 0; i < SHM_SPIN_ITERATIONS; i++)
+    {
+        if (__atomic_load_n(p_tail, __ATOMIC_ACQUIRE) != head)
+            return;
+    }
+
+    while (__atomic_load_n(p_tail, __ATOMIC_ACQUIRE) == head)
+    {
+        // the producer checks the flag after bumping the tail, so either it sees the flag or 
+        // the tail is already changed and futex wait returns immediately
+        __atomic_store_n(p_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(p_tail, __ATOMIC_SEQ_CST) == head)
+            syscall(SYS_futex, p_tail, FUTEX_WAIT, head, NULL, NULL, 0);
+        __atomic_store_n(p_sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // general
 ///////////////////////////////////////////////////////////////////////////////////////////////////
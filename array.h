@@ -5,6 +5,11 @@
 #define NEW_VECTOR_CREATED 1
 #define VECTOR_ALREADY_EXISTS 0
 #define VECTOR_CREATION_ERROR -1
+// durability of a vector, kept with the vector
+#define DURABILITY_DEFAULT 0    // the durability set on the server (option -d)
+#define DURABILITY_NONE 1       // changes are never synced, for data which can be recomputed
+#define DURABILITY_PERIODIC 2   // changes are logged and the log is synced in the background
+#define DURABILITY_STRICT 3     // a change is in the synced log before the call returns
 // set
 #define SET_SUCCESS 0
 #define SET_FAIL -1
@@ -14,9 +19,214 @@
 // destroy
 #define DESTROY_SUCCESS 1
 #define DESTROY_FAIL -1
+// batch
+#define BATCH_SUCCESS 0
+#define BATCH_FAIL -1
+// range
+#define RANGE_SUCCESS 0
+#define RANGE_FAIL -1
+// atomic read-modify-write
+#define RMW_SUCCESS 0
+#define RMW_FAIL -1
+// reductions
+#define REDUCE_SUCCESS 0
+#define REDUCE_FAIL -1
+#define REDUCE_TO_END -1    // end of a range which covers the rest of the vector
+// element-wise operations
+#define ELEMENTWISE_SUCCESS 0
+#define ELEMENTWISE_FAIL -1
+// distances and nearest vectors
+#define DISTANCE_SUCCESS 0
+#define DISTANCE_FAIL -1
+#define NEAREST_FAIL -1
+#define METRIC_DOT 0        // dot product, greater is nearer
+#define METRIC_L1 1         // sum of absolute differences
+#define METRIC_L2 2         // euclidean distance
+#define METRIC_COSINE 3     // cosine similarity, greater is nearer. Undefined for zero vectors
+#define MAX_NEAREST_K 64
+// bulk import and export
+#define TRANSFER_FAIL -1
+#define TRANSFER_FORMAT_BINARY 0    // little-endian int32 elements, no header
+#define TRANSFER_FORMAT_TEXT 1      // one decimal element per line
+// vector handles
+#define HANDLE_SUCCESS 0
+#define HANDLE_FAIL -1
+// connect / disconnect
+#define CONNECT_SUCCESS 0
+#define CONNECT_FAIL -1
+#define DISCONNECT_SUCCESS 0
+#define DISCONNECT_FAIL -1
+// request priorities
+#define PRIORITIES_SUCCESS 0
+#define PRIORITIES_FAIL -1
+// asynchronous requests
+#define ASYNC_FAIL -1
+#define REQUEST_PENDING 0
+#define REQUEST_DONE 1
 
 
 int init(char* name, int size);
+/*
+    like init, but the vector gets its own durability instead of the server default. Strict 
+    vectors pay for a log sync on every change, though concurrent changes share one sync. If 
+    the vector already exists its durability is not changed
+*/
+int init_with_durability(char* name, int size, int durability);
 int set(char* name, int pos, int val);
 int get(char* name, int pos, int* value);
-int destroy(char* vec_name);
\ No newline at end of file
+int destroy(char* vec_name);
+/*
+    sets values[i] at positions[i] for all len elements of the vector. Elements are sent to the
+    server in chunks and each chunk is applied at once, but the whole batch is not atomic: if a
+    chunk fails the previous ones stay applied
+*/
+int set_batch(char* name, int len, int* positions, int* values);
+/*
+    gets the values at positions[i] into values[i] for all len elements of the vector, in chunks
+    like set_batch
+*/
+int get_batch(char* name, int len, int* positions, int* values);
+/*
+    sets count consecutive elements starting at start to the values from buf. Like batches, 
+    long ranges are sent in chunks and the whole range is not atomic
+*/
+int set_range(char* name, int start, int count, int* buf);
+/*
+    gets count consecutive elements starting at start into buf
+*/
+int get_range(char* name, int start, int count, int* buf);
+/*
+    read-modify-write operations done by the server in one step, so concurrent clients can't 
+    change the element in between and no retry loop is needed. p_old_value (may be NULL) gets 
+    the value of the element before the operation. RMW_SUCCESS or RMW_FAIL. fetch_add wraps 
+    around on overflow. compare_and_swap sets desired only if the element is equal to expected,
+    which is the case when *p_old_value == expected
+*/
+int fetch_add(char* name, int pos, int delta, int* p_old_value);
+int compare_and_swap(char* name, int pos, int expected, int desired, int* p_old_value);
+int exchange(char* name, int pos, int value, int* p_old_value);
+/*
+    reductions computed by the server over the elements [start, end) of a vector, the whole 
+    vector is 0, REDUCE_TO_END. Only the result is sent back. REDUCE_SUCCESS or REDUCE_FAIL, also
+    when min, max or mean is requested over an empty range. The sum doesn't overflow
+*/
+int get_sum(char* name, int start, int end, long long* p_sum);
+int get_min(char* name, int start, int end, int* p_min);
+int get_max(char* name, int start, int end, int* p_max);
+int get_mean(char* name, int start, int end, double* p_mean);
+int count_nonzero(char* name, int start, int end, int* p_count);
+/*
+    element-wise operations computed by the server on whole vectors, in parallel threads for 
+    long vectors. The result is written into target, which must already exist and may be one of 
+    the sources, e.g. a *= k is vector_scale(a, a, k) and y = k * x + y is 
+    vector_axpy(y, k, x, y). All vectors must have the same size. Results wrap around on 
+    overflow. While the target is computed other calls on it wait. ELEMENTWISE_SUCCESS or 
+    ELEMENTWISE_FAIL
+*/
+int vector_add(char* target, char* a, char* b);
+int vector_scale(char* target, char* a, int k);
+int vector_axpy(char* target, int k, char* x, char* y);
+int vector_min(char* target, char* a, char* b);
+int vector_max(char* target, char* a, char* b);
+/*
+    computes the metric between two vectors of the same size on the server. Values are summed 
+    as doubles. DISTANCE_SUCCESS or DISTANCE_FAIL
+*/
+int get_distance(char* a, char* b, int metric, double* p_value);
+/*
+    finds up to k (at most MAX_NEAREST_K) of the candidates nearest to the query by the metric. 
+    The server compares candidates in parallel threads, many candidates are sent in chunks. 
+    indexes gets positions of the nearest candidates in the candidates array and values their 
+    distances or similarities, nearest first. Candidates which don't exist, have another size 
+    than the query or can't be compared (cosine of a zero vector) are skipped. Returns the 
+    number of found candidates or NEAREST_FAIL
+*/
+int find_nearest(char* query, char** candidates, int num_of_candidates, int metric, int k, 
+    int* indexes, double* values);
+/*
+    the server loads the whole vector from a file or stores it to a file, in large chunks. The 
+    file is opened by the server, so it must be on the server host, relative names are resolved
+    against the working directory of the caller. Import creates the vector with the size of the
+    file if it doesn't exist, otherwise the file must have exactly as many elements as the 
+    vector. Other calls on the vector wait until the import is done. Export overwrites the file.
+    Return the number of moved elements or TRANSFER_FAIL
+*/
+int import_vector(char* name, char* file_name, int format);
+int export_vector(char* name, char* file_name, int format);
+/*
+    the same with len elements of buf, passed through shared memory. For export len is the 
+    capacity of buf, which fails if the vector is longer
+*/
+int import_vector_from_buffer(char* name, int* buf, int len);
+int export_vector_to_buffer(char* name, int* buf, int len);
+
+/*
+    opens the server request queue once for the whole process. Until disconnect_server is called
+    every thread reuses it together with its own response queue, created on the first call made by
+    the thread, instead of opening and unlinking queues in every call. Without a connection 
+    every call sets up and tears down its own queues
+*/
+int connect_server();
+/*
+    like connect_server, but init, set, get and destroy of every thread go through a shared 
+    memory ring attached to the server instead of message queues. Only for clients running on 
+    the same host as the server. Other calls still use message queues. If the ring of a thread 
+    can't be attached the thread falls back to message queues
+*/
+int connect_server_shm();
+/*
+    closes the server queue and closes and unlinks response queues of all threads. Must not be 
+    called while other threads still make calls
+*/
+int disconnect_server();
+/*
+    all requests go to one server queue, where messages with a higher priority (0..2) are 
+    received first, so reads don't wait behind a backlog of bulk writes. Reads are get, get_batch,
+    get_range and get_by_handle, writes are set and set_by_handle and all other calls are bulk. 
+    Defaults are 2, 1 and 0. The server orders requests waiting for its workers by its own 
+    setting (server option -p). Applies to the whole process. PRIORITIES_SUCCESS or 
+    PRIORITIES_FAIL if a priority is out of range
+*/
+int set_request_priorities(int read_priority, int write_priority, int bulk_priority);
+
+/*
+    submit functions send a request without waiting for the response and return its id, or 
+    ASYNC_FAIL if it couldn't be sent. They work only while connected (connect_server or 
+    connect_server_shm, requests always go through message queues) and ids are valid only in the
+    thread which submitted them. Up to 10 requests of a thread are in flight, the next submit 
+    waits for one response. A submit also fails if the request submitted 64 requests earlier 
+    wasn't collected with poll_request or wait_request yet
+*/
+int submit_init(char* name, int size);
+int submit_set(char* name, int pos, int val);
+int submit_get(char* name, int pos);
+int submit_destroy(char* vec_name);
+/*
+    checks without waiting whether the request is done. If it is, p_result gets what the 
+    synchronous function would return, p_value (may be NULL) gets the value of get and the 
+    request id is freed. REQUEST_DONE, REQUEST_PENDING or ASYNC_FAIL
+*/
+int poll_request(int request_id, int* p_result, int* p_value);
+/*
+    waits until the request is done and collects it like poll_request. 
+    REQUEST_DONE or ASYNC_FAIL
+*/
+int wait_request(int request_id, int* p_result, int* p_value);
+
+/*
+    opens an existing vector and returns a handle to it, HANDLE_FAIL on failure. Handle requests 
+    carry only integers instead of the vector and response queue names, and the server maps the 
+    handle directly to the vector. They work only while connected, a handle may be used by any 
+    thread of the process until it's closed. disconnect_server closes all handles which are 
+    still opened. If the vector is destroyed, calls using its handle fail
+*/
+int open_vector(char* name);
+/*
+    closes a handle. HANDLE_SUCCESS or HANDLE_FAIL
+*/
+int close_vector(int handle);
+/*
+    the same as set and get, but the vector is given by a handle
+*/
+int set_by_handle(int handle, int pos, int val);
+int get_by_handle(int handle, int pos, int* value);
\ No newline at end of file
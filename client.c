@@ -1,6 +1,10 @@
 #include "array.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
 
 
 
@@ -67,7 +71,7 @@ int basic_test_init()
     }
 
     // clean up
-    if (remove("vectors/mypropervector.txt") != 0)
+    if (remove("vectors/mypropervector.vec") != 0)
     {
         printf("FAIL: BASIC TEST INIT clean up error\n");
         return 0;
@@ -152,7 +156,7 @@ int basic_test_set()
     }
 
     // clean up
-    if (remove("vectors/setvec.txt") != 0)
+    if (remove("vectors/setvec.vec") != 0)
     {
         printf("FAIL: BASIC TEST INIT clean up error\n");
         return 0;
@@ -242,7 +246,7 @@ int basic_test_get()
     }
 
     // clean up
-    if (remove("vectors/getvec.txt") != 0)
+    if (remove("vectors/getvec.vec") != 0)
     {
         printf("FAIL: BASIC TEST INIT clean up error\n");
         return 0;
@@ -351,6 +355,28 @@ void* get_test_thread(void* p_args)
 
 
 
+void* init_test_thread(void* p_args)
+{
+    int* p_result = (int*) p_args;
+
+    *p_result = init("concurrentinit", 1000);
+
+    pthread_exit(NULL);
+}
+
+
+
+void* destroy_test_thread(void* p_args)
+{
+    int* p_result = (int*) p_args;
+
+    *p_result = destroy("concurrentinit");
+
+    pthread_exit(NULL);
+}
+
+
+
 int multithreaded_test()
 {
     char vec_name[] = "multithreaded";
@@ -397,6 +423,74 @@ int multithreaded_test()
         return 0;
     } 
 
+    // of concurrent inits of a new vector only one creates it, the others find it
+    pthread_t t_init[4];
+    int init_results[4];
+    int num_of_created = 0;
+    int num_of_found = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (pthread_create(&t_init[i], &attr, init_test_thread, (void*) &init_results[i]) != 0)
+        {
+            printf("FAIL: MULTITHREADED TEST could not create init threads\n");
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (pthread_join(t_init[i], NULL) != 0)
+        {
+            printf("FAIL: MULTITHREADED TEST could not join init threads\n");
+            return 0;
+        }
+
+        if (init_results[i] == 1)
+            num_of_created++;
+        else if (init_results[i] == 0)
+            num_of_found++;
+    }
+
+    if (num_of_created != 1 || num_of_found != 3)
+    {
+        printf("FAIL: MULTITHREADED TEST wrong results of concurrent inits\n");
+        return 0;
+    }
+
+    // of concurrent destroys only one succeeds, the vector can be created again after them
+    int destroy_results[4];
+    int num_of_destroyed = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (pthread_create(&t_init[i], &attr, destroy_test_thread, 
+            (void*) &destroy_results[i]) != 0)
+        {
+            printf("FAIL: MULTITHREADED TEST could not create destroy threads\n");
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (pthread_join(t_init[i], NULL) != 0)
+        {
+            printf("FAIL: MULTITHREADED TEST could not join destroy threads\n");
+            return 0;
+        }
+
+        if (destroy_results[i] == 1)
+            num_of_destroyed++;
+    }
+
+    if (num_of_destroyed != 1 || init("concurrentinit", 1000) != 1 || 
+        destroy("concurrentinit") != 1)
+    {
+        printf("FAIL: MULTITHREADED TEST wrong results of concurrent destroys\n");
+        return 0;
+    }
+
     // destroy
     if (destroy(vec_name) != 1)
     {
@@ -416,17 +510,1224 @@ int multithreaded_test()
 
 
 
-// all tests //////////////////////////////////////////////////////////////////////////////////////
+// batch test ///////////////////////////////////////////////////////////////////////////////////
 
 
 
-int all_tests()
+int batch_test()
 {
-    int res = 1;
+    char vec_name[] = "batchvec";
+    if (init(vec_name, 20000) != 1)
+    {
+        printf("FAIL: BATCH TEST could not initialize the vector\n");
+        return 0;
+    }
+
+    // more elements than fit into one message
+    int positions[1200];
+    int values[1200];
+    for (int i = 0; i < 1200; i++)
+    {
+        positions[i] = i;
+        values[i] = i * 3;
+    }
+
+    if (set_batch(vec_name, 1200, positions, values) != 0)
+    {
+        printf("FAIL: BATCH TEST proper set batch\n");
+        return 0;
+    }
+
+    int read_values[1200];
+    if (get_batch(vec_name, 1200, positions, read_values) != 0)
+    {
+        printf("FAIL: BATCH TEST proper get batch\n");
+        return 0;
+    }
+
+    for (int i = 0; i < 1200; i++)
+    {
+        if (read_values[i] != i * 3)
+        {
+            printf("FAIL: BATCH TEST wrong value from get batch\n");
+            return 0;
+        }
+    }
+
+    // positions far from each other, in different stripes
+    int scattered_positions[] = { 19999, 0, 10000, 5 };
+    int scattered_values[] = { 1, 2, 3, 4 };
+    if (set_batch(vec_name, 4, scattered_positions, scattered_values) != 0)
+    {
+        printf("FAIL: BATCH TEST scattered set batch\n");
+        return 0;
+    }
+
+    int val = -1;
+    if (get(vec_name, 19999, &val) != 0 || val != 1 || get(vec_name, 5, &val) != 0 || val != 4)
+    {
+        printf("FAIL: BATCH TEST wrong value after scattered set batch\n");
+        return 0;
+    }
+
+    // one position out of range, nothing is set
+    int bad_positions[] = { 1, 20000 };
+    int bad_values[] = { -1, -1 };
+    if (set_batch(vec_name, 2, bad_positions, bad_values) != -1)
+    {
+        printf("FAIL: BATCH TEST -1 set batch with position out of range\n");
+        return 0;
+    }
+
+    if (get(vec_name, 1, &val) != 0 || val != 3)
+    {
+        printf("FAIL: BATCH TEST value changed by failed set batch\n");
+        return 0;
+    }
+
+    if (get_batch("nonexistingbatch", 2, positions, read_values) != -1)
+    {
+        printf("FAIL: BATCH TEST -1 get batch from non existing vector\n");
+        return 0;
+    }
+
+    if (destroy(vec_name) != 1)
+    {
+        printf("FAIL: BATCH TEST could not destroy\n");
+        return 0;
+    }
+
+    printf("SUCCESS: BATCH TEST passed\n");
+    return 1;
+}
+
+
+
+// range test ///////////////////////////////////////////////////////////////////////////////////
+
+
+
+int range_test()
+{
+    char vec_name[] = "rangevec";
+    if (init(vec_name, 5000) != 1)
+    {
+        printf("FAIL: RANGE TEST could not initialize the vector\n");
+        return 0;
+    }
+
+    // more elements than fit into one message
+    int values[4990];
+    for (int i = 0; i < 4990; i++)
+        values[i] = i + 7;
+
+    if (set_range(vec_name, 10, 4990, values) != 0)
+    {
+        printf("FAIL: RANGE TEST proper set range\n");
+        return 0;
+    }
+
+    int read_values[5000];
+    if (get_range(vec_name, 0, 5000, read_values) != 0)
+    {
+        printf("FAIL: RANGE TEST proper get range\n");
+        return 0;
+    }
+
+    for (int i = 0; i < 5000; i++)
+    {
+        if (read_values[i] != (i < 10 ? 0 : i - 3))
+        {
+            printf("FAIL: RANGE TEST wrong value from get range\n");
+            return 0;
+        }
+    }
+
+    int val = -1;
+    if (get(vec_name, 4999, &val) != 0 || val != 4996)
+    {
+        printf("FAIL: RANGE TEST wrong value after set range\n");
+        return 0;
+    }
+
+    // range exceeding the vector
+    if (get_range(vec_name, 4990, 11, read_values) != -1)
+    {
+        printf("FAIL: RANGE TEST -1 get range exceeding the vector\n");
+        return 0;
+    }
+
+    if (set_range(vec_name, -1, 2, values) != -1)
+    {
+        printf("FAIL: RANGE TEST -1 set range at position -1\n");
+        return 0;
+    }
+
+    if (destroy(vec_name) != 1)
+    {
+        printf("FAIL: RANGE TEST could not destroy\n");
+        return 0;
+    }
+
+    printf("SUCCESS: RANGE TEST passed\n");
+    return 1;
+}
+
+
+
+// session test ///////////////////////////////////////////////////////////////////////////////////
+
+
+
+int session_test()
+{
+    if (connect_server() != 0)
+    {
+        printf("FAIL: SESSION TEST could not connect\n");
+        return 0;
+    }
+
+    // the same tests, but queues are reused by every thread
     int basic_test_res = basic_test();
     int multi_test_res = multithreaded_test();
+    int batch_test_res = batch_test();
+    int range_test_res = range_test();
+
+    if (disconnect_server() != 0)
+    {
+        printf("FAIL: SESSION TEST could not disconnect\n");
+        return 0;
+    }
+
+    // after disconnect calls work without a session again
+    if (init("aftersession", 5) != 1 || destroy("aftersession") != 1)
+    {
+        printf("FAIL: SESSION TEST calls after disconnect\n");
+        return 0;
+    }
+
+    if (!basic_test_res || !multi_test_res || !batch_test_res || !range_test_res)
+        return 0;
+
+    printf("SUCCESS: SESSION TEST passed\n");
+    return 1;
+}
+
+
+
+// async test /////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int async_test()
+{
+    char vec_name[] = "asyncvec";
+    int result = -1;
+    int value = -1;
+
+    // requires a connection
+    if (submit_get(vec_name, 0) != -1)
+    {
+        printf("FAIL: ASYNC TEST -1 submit without connection\n");
+        return 0;
+    }
+
+    if (connect_server() != 0)
+    {
+        printf("FAIL: ASYNC TEST could not connect\n");
+        return 0;
+    }
+
+    int id = submit_init(vec_name, 50);
+    if (id < 0 || wait_request(id, &result, NULL) != 1 || result != 1)
+    {
+        printf("FAIL: ASYNC TEST could not initialize the vector\n");
+        return 0;
+    }
+
+    // more requests than can be in flight at once
+    int ids[50];
+    for (int i = 0; i < 50; i++)
+    {
+        if ((ids[i] = submit_set(vec_name, i, i * 2)) < 0)
+        {
+            printf("FAIL: ASYNC TEST could not submit set\n");
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < 50; i++)
+    {
+        if (wait_request(ids[i], &result, NULL) != 1 || result != 0)
+        {
+            printf("FAIL: ASYNC TEST set failed\n");
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < 50; i++)
+    {
+        if ((ids[i] = submit_get(vec_name, i)) < 0)
+        {
+            printf("FAIL: ASYNC TEST could not submit get\n");
+            return 0;
+        }
+    }
+
+    // collect in reverse order, polling
+    for (int i = 49; i >= 0; i--)
+    {
+        int poll_res;
+        while ((poll_res = poll_request(ids[i], &result, &value)) == 0)
+            ;
+
+        if (poll_res != 1 || result != 0 || value != i * 2)
+        {
+            printf("FAIL: ASYNC TEST wrong get result\n");
+            return 0;
+        }
+    }
+
+    // already collected
+    if (poll_request(ids[0], &result, &value) != -1)
+    {
+        printf("FAIL: ASYNC TEST -1 poll of collected request\n");
+        return 0;
+    }
+
+    id = submit_get(vec_name, 50);
+    if (id < 0 || wait_request(id, &result, &value) != 1 || result != -1)
+    {
+        printf("FAIL: ASYNC TEST -1 get out of range\n");
+        return 0;
+    }
+
+    id = submit_destroy(vec_name);
+    if (id < 0 || wait_request(id, &result, NULL) != 1 || result != 1)
+    {
+        printf("FAIL: ASYNC TEST could not destroy\n");
+        return 0;
+    }
+
+    if (disconnect_server() != 0)
+    {
+        printf("FAIL: ASYNC TEST could not disconnect\n");
+        return 0;
+    }
+
+    printf("SUCCESS: ASYNC TEST passed\n");
+    return 1;
+}
+
+
 
-    if (basic_test_res && multi_test_res)
+// handle test ////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int handle_test()
+{
+    char vec_name[] = "handlevec";
+    int val = -1;
+
+    // requires a connection
+    if (open_vector(vec_name) != -1)
+    {
+        printf("FAIL: HANDLE TEST -1 open without connection\n");
+        return 0;
+    }
+
+    if (connect_server() != 0 || init(vec_name, 100) != 1)
+    {
+        printf("FAIL: HANDLE TEST could not connect and initialize the vector\n");
+        return 0;
+    }
+
+    int handle = open_vector(vec_name);
+    if (handle < 0)
+    {
+        printf("FAIL: HANDLE TEST could not open the vector\n");
+        return 0;
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        if (set_by_handle(handle, i, i + 1) != 0)
+        {
+            printf("FAIL: HANDLE TEST proper set\n");
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        if (get_by_handle(handle, i, &val) != 0 || val != i + 1)
+        {
+            printf("FAIL: HANDLE TEST proper get\n");
+            return 0;
+        }
+    }
+
+    // the same vector by name
+    if (get(vec_name, 99, &val) != 0 || val != 100)
+    {
+        printf("FAIL: HANDLE TEST get by name\n");
+        return 0;
+    }
+
+    if (set_by_handle(handle, 100, 1) != -1 || get_by_handle(handle, -1, &val) != -1)
+    {
+        printf("FAIL: HANDLE TEST -1 position out of range\n");
+        return 0;
+    }
+
+    if (open_vector("nonexistinghandle") != -1)
+    {
+        printf("FAIL: HANDLE TEST -1 open non existing vector\n");
+        return 0;
+    }
+
+    // destroyed vector, handle stays valid but calls fail
+    if (destroy(vec_name) != 1 || init(vec_name, 100) != 1)
+    {
+        printf("FAIL: HANDLE TEST could not recreate the vector\n");
+        return 0;
+    }
+
+    if (get_by_handle(handle, 0, &val) != -1)
+    {
+        printf("FAIL: HANDLE TEST -1 get from destroyed vector\n");
+        return 0;
+    }
+
+    if (close_vector(handle) != 0 || close_vector(handle) != -1)
+    {
+        printf("FAIL: HANDLE TEST close\n");
+        return 0;
+    }
+
+    if (set_by_handle(handle, 0, 1) != -1)
+    {
+        printf("FAIL: HANDLE TEST -1 set with closed handle\n");
+        return 0;
+    }
+
+    // left opened, closed by disconnect
+    if (open_vector(vec_name) < 0)
+    {
+        printf("FAIL: HANDLE TEST could not open the vector again\n");
+        return 0;
+    }
+
+    if (disconnect_server() != 0 || destroy(vec_name) != 1)
+    {
+        printf("FAIL: HANDLE TEST could not disconnect and destroy\n");
+        return 0;
+    }
+
+    printf("SUCCESS: HANDLE TEST passed\n");
+    return 1;
+}
+
+
+
+// shared memory test /////////////////////////////////////////////////////////////////////////////
+
+
+
+int shm_test()
+{
+    if (connect_server_shm() != 0)
+    {
+        printf("FAIL: SHM TEST could not connect\n");
+        return 0;
+    }
+
+    // the same tests, but init, set, get and destroy go through shared memory rings
+    int basic_test_res = basic_test();
+    int multi_test_res = multithreaded_test();
+
+    if (disconnect_server() != 0)
+    {
+        printf("FAIL: SHM TEST could not disconnect\n");
+        return 0;
+    }
+
+    if (!basic_test_res || !multi_test_res)
+        return 0;
+
+    printf("SUCCESS: SHM TEST passed\n");
+    return 1;
+}
+
+
+
+// priority test //////////////////////////////////////////////////////////////////////////////////
+
+
+
+int priority_test()
+{
+    if (set_request_priorities(3, 1, 0) != PRIORITIES_FAIL || 
+        set_request_priorities(2, -1, 0) != PRIORITIES_FAIL)
+    {
+        printf("FAIL: PRIORITY TEST out of range priorities accepted\n");
+        return 0;
+    }
+
+    // bulk requests first, results must not change
+    if (set_request_priorities(0, 1, 2) != PRIORITIES_SUCCESS)
+    {
+        printf("FAIL: PRIORITY TEST could not set priorities\n");
+        return 0;
+    }
+
+    int basic_test_res = basic_test();
+    int batch_test_res = batch_test();
+
+    if (set_request_priorities(2, 1, 0) != PRIORITIES_SUCCESS)
+    {
+        printf("FAIL: PRIORITY TEST could not restore priorities\n");
+        return 0;
+    }
+
+    if (!basic_test_res || !batch_test_res)
+        return 0;
+
+    printf("SUCCESS: PRIORITY TEST passed\n");
+    return 1;
+}
+
+
+
+// durability test ////////////////////////////////////////////////////////////////////////////////
+
+
+
+int durability_test()
+{
+    if (init_with_durability("durvecbad", 10, DURABILITY_STRICT + 1) != VECTOR_CREATION_ERROR)
+    {
+        printf("FAIL: DURABILITY TEST unknown durability accepted\n");
+        return 0;
+    }
+
+    char* names[] = { "durvecnone", "durvecperiodic", "durvecstrict" };
+    int durabilities[] = { DURABILITY_NONE, DURABILITY_PERIODIC, DURABILITY_STRICT };
+    int values[100];
+    int res = 1;
+
+    for (int i = 0; i < 100; i++)
+        values[i] = i * 7;
+
+    for (int v = 0; v < 3 && res; v++)
+    {
+        if (init_with_durability(names[v], 100, durabilities[v]) != NEW_VECTOR_CREATED)
+        {
+            printf("FAIL: DURABILITY TEST could not create %s\n", names[v]);
+            res = 0;
+        }
+        // the same vector again, with another durability
+        else if (init_with_durability(names[v], 100, DURABILITY_DEFAULT) != VECTOR_ALREADY_EXISTS)
+        {
+            printf("FAIL: DURABILITY TEST %s created again\n", names[v]);
+            res = 0;
+        }
+        else if (set_range(names[v], 0, 100, values) != RANGE_SUCCESS || 
+            set(names[v], 99, -5) != SET_SUCCESS)
+        {
+            printf("FAIL: DURABILITY TEST could not set values of %s\n", names[v]);
+            res = 0;
+        }
+        else
+        {
+            int got[100];
+            if (get_range(names[v], 0, 100, got) != RANGE_SUCCESS || got[50] != 350 || 
+                got[99] != -5)
+            {
+                printf("FAIL: DURABILITY TEST wrong values of %s\n", names[v]);
+                res = 0;
+            }
+        }
+
+        destroy(names[v]);
+    }
+
+    if (res)
+        printf("SUCCESS: DURABILITY TEST passed\n");
+
+    return res;
+}
+
+
+
+// read-modify-write test ////////////////////////////////////////////////////////////////////////
+
+
+
+void* fetch_add_test_thread(void* p_args)
+{
+    char* vec_name = (char*) p_args;
+
+    for (int i = 0; i < 500; i++)
+    {
+        if (fetch_add(vec_name, 0, 1, NULL) != RMW_SUCCESS)
+        {
+            printf("FAIL: FETCH ADD TEST THREAD could not add\n");
+            pthread_exit(NULL);
+        }
+    }
+
+    pthread_exit(NULL);
+}
+
+
+
+int rmw_test()
+{
+    char vec_name[] = "rmwvec";
+    if (init(vec_name, 10) != 1)
+    {
+        printf("FAIL: RMW TEST could not initialize the vector\n");
+        return 0;
+    }
+
+    int res = 1;
+    int old = -1;
+    int val = -1;
+
+    if (fetch_add(vec_name, 1, 5, &old) != RMW_SUCCESS || old != 0 ||
+        fetch_add(vec_name, 1, -7, &old) != RMW_SUCCESS || old != 5 ||
+        get(vec_name, 1, &val) != GET_SUCCESS || val != -2)
+    {
+        printf("FAIL: RMW TEST wrong fetch add\n");
+        res = 0;
+    }
+    // wraps around
+    else if (set(vec_name, 2, INT_MAX) != SET_SUCCESS || 
+        fetch_add(vec_name, 2, 1, &old) != RMW_SUCCESS || old != INT_MAX ||
+        get(vec_name, 2, &val) != GET_SUCCESS || val != INT_MIN)
+    {
+        printf("FAIL: RMW TEST fetch add does not wrap around\n");
+        res = 0;
+    }
+    // the second swap must see the first one
+    else if (compare_and_swap(vec_name, 3, 0, 11, &old) != RMW_SUCCESS || old != 0 ||
+        compare_and_swap(vec_name, 3, 0, 12, &old) != RMW_SUCCESS || old != 11 ||
+        get(vec_name, 3, &val) != GET_SUCCESS || val != 11)
+    {
+        printf("FAIL: RMW TEST wrong compare and swap\n");
+        res = 0;
+    }
+    else if (exchange(vec_name, 4, 8, &old) != RMW_SUCCESS || old != 0 ||
+        exchange(vec_name, 4, 9, &old) != RMW_SUCCESS || old != 8 ||
+        get(vec_name, 4, &val) != GET_SUCCESS || val != 9)
+    {
+        printf("FAIL: RMW TEST wrong exchange\n");
+        res = 0;
+    }
+    else if (fetch_add(vec_name, 10, 1, &old) != RMW_FAIL || 
+        exchange(vec_name, -1, 1, &old) != RMW_FAIL ||
+        compare_and_swap("rmwvecnone", 0, 0, 1, &old) != RMW_FAIL)
+    {
+        printf("FAIL: RMW TEST invalid request accepted\n");
+        res = 0;
+    }
+
+    // no increment may be lost
+    pthread_t threads[4];
+    int num_of_threads = 0;
+
+    for (int i = 0; i < 4 && res; i++)
+    {
+        if (pthread_create(&threads[i], NULL, fetch_add_test_thread, (void*) vec_name) != 0)
+        {
+            printf("FAIL: RMW TEST could not create threads\n");
+            res = 0;
+        }
+        else
+            num_of_threads++;
+    }
+
+    for (int i = 0; i < num_of_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    if (res && (get(vec_name, 0, &val) != GET_SUCCESS || val != 2000))
+    {
+        printf("FAIL: RMW TEST lost increments, counter is %d\n", val);
+        res = 0;
+    }
+
+    if (destroy(vec_name) != 1)
+    {
+        printf("FAIL: RMW TEST could not destroy\n");
+        res = 0;
+    }
+
+    if (res)
+        printf("SUCCESS: RMW TEST passed\n");
+
+    return res;
+}
+
+
+
+// reduce test ///////////////////////////////////////////////////////////////////////////////////
+
+
+
+int reduce_test()
+{
+    char vec_name[] = "reducevec";
+    int size = 5003;    // not a multiple of the simd width
+    if (init(vec_name, size) != 1)
+    {
+        printf("FAIL: REDUCE TEST could not initialize the vector\n");
+        return 0;
+    }
+
+    int values[5003];
+    long long expected_sum = 0;
+    int expected_nonzero = 0;
+
+    for (int i = 0; i < size; i++)
+    {
+        values[i] = i % 3 == 0 ? 0 : (i % 2 == 0 ? INT_MAX - i : -i);
+        expected_sum += values[i];
+        expected_nonzero += values[i] != 0;
+    }
+
+    values[4001] = INT_MIN;
+    expected_sum += INT_MIN + 4001;
+
+    int res = 1;
+    long long sum = 0;
+    int min = 0;
+    int max = 0;
+    int count = 0;
+    double mean = 0;
+
+    if (set_range(vec_name, 0, size, values) != RANGE_SUCCESS)
+    {
+        printf("FAIL: REDUCE TEST could not set the values\n");
+        res = 0;
+    }
+    else if (get_sum(vec_name, 0, REDUCE_TO_END, &sum) != REDUCE_SUCCESS || sum != expected_sum)
+    {
+        printf("FAIL: REDUCE TEST wrong sum\n");
+        res = 0;
+    }
+    else if (get_min(vec_name, 0, REDUCE_TO_END, &min) != REDUCE_SUCCESS || min != INT_MIN ||
+        get_max(vec_name, 0, REDUCE_TO_END, &max) != REDUCE_SUCCESS || max != INT_MAX - 2)
+    {
+        printf("FAIL: REDUCE TEST wrong min or max\n");
+        res = 0;
+    }
+    else if (count_nonzero(vec_name, 0, REDUCE_TO_END, &count) != REDUCE_SUCCESS || 
+        count != expected_nonzero)
+    {
+        printf("FAIL: REDUCE TEST wrong count of nonzero elements\n");
+        res = 0;
+    }
+    // [3, 6) is 0, INT_MAX - 4 and -5
+    else if (get_sum(vec_name, 3, 6, &sum) != REDUCE_SUCCESS || sum != INT_MAX - 9LL ||
+        get_min(vec_name, 3, 6, &min) != REDUCE_SUCCESS || min != -5 ||
+        count_nonzero(vec_name, 3, 6, &count) != REDUCE_SUCCESS || count != 2 ||
+        get_mean(vec_name, 3, 6, &mean) != REDUCE_SUCCESS || mean != (INT_MAX - 9.0) / 3)
+    {
+        printf("FAIL: REDUCE TEST wrong reduction of a range\n");
+        res = 0;
+    }
+    else if (get_sum(vec_name, 10, 10, &sum) != REDUCE_SUCCESS || sum != 0 ||
+        get_max(vec_name, 10, 10, &max) != REDUCE_FAIL || 
+        get_sum(vec_name, 0, size + 1, &sum) != REDUCE_FAIL ||
+        get_sum(vec_name, 5, 4, &sum) != REDUCE_FAIL ||
+        get_sum("reducevecnone", 0, REDUCE_TO_END, &sum) != REDUCE_FAIL)
+    {
+        printf("FAIL: REDUCE TEST invalid reduction accepted\n");
+        res = 0;
+    }
+
+    if (destroy(vec_name) != 1)
+    {
+        printf("FAIL: REDUCE TEST could not destroy\n");
+        res = 0;
+    }
+
+    if (res)
+        printf("SUCCESS: REDUCE TEST passed\n");
+
+    return res;
+}
+
+
+
+// element-wise test //////////////////////////////////////////////////////////////////////////////
+
+
+
+int elementwise_test()
+{
+    int size = 200003;  // split between threads on the server
+    char* names[] = { "elemwisea", "elemwiseb", "elemwisec" };
+    int* a = malloc(size * sizeof(int));
+    int* b = malloc(size * sizeof(int));
+    int* c = malloc(size * sizeof(int));
+    int res = a != NULL && b != NULL && c != NULL;
+
+    for (int v = 0; v < 3 && res; v++)
+    {
+        if (init(names[v], size) != 1)
+        {
+            printf("FAIL: ELEMENTWISE TEST could not initialize the vectors\n");
+            res = 0;
+        }
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        a[i] = i - 100000;
+        b[i] = i % 2 == 0 ? 3 * i : -i;
+    }
+
+    if (res && (set_range(names[0], 0, size, a) != RANGE_SUCCESS ||
+        set_range(names[1], 0, size, b) != RANGE_SUCCESS))
+    {
+        printf("FAIL: ELEMENTWISE TEST could not set the values\n");
+        res = 0;
+    }
+
+    // c = a + b
+    if (res && (vector_add(names[2], names[0], names[1]) != ELEMENTWISE_SUCCESS ||
+        get_range(names[2], 0, size, c) != RANGE_SUCCESS))
+    {
+        printf("FAIL: ELEMENTWISE TEST could not add\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        if (c[i] != a[i] + b[i])
+        {
+            printf("FAIL: ELEMENTWISE TEST wrong sum at %d\n", i);
+            res = 0;
+        }
+    }
+
+    // a *= -3, in place
+    if (res && (vector_scale(names[0], names[0], -3) != ELEMENTWISE_SUCCESS ||
+        get_range(names[0], 0, size, c) != RANGE_SUCCESS))
+    {
+        printf("FAIL: ELEMENTWISE TEST could not scale\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        a[i] *= -3;
+        if (c[i] != a[i])
+        {
+            printf("FAIL: ELEMENTWISE TEST wrong product at %d\n", i);
+            res = 0;
+        }
+    }
+
+    // b = 7 * a + b
+    if (res && (vector_axpy(names[1], 7, names[0], names[1]) != ELEMENTWISE_SUCCESS ||
+        get_range(names[1], 0, size, c) != RANGE_SUCCESS))
+    {
+        printf("FAIL: ELEMENTWISE TEST could not compute axpy\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        b[i] += 7 * a[i];
+        if (c[i] != b[i])
+        {
+            printf("FAIL: ELEMENTWISE TEST wrong axpy at %d\n", i);
+            res = 0;
+        }
+    }
+
+    if (res && (vector_min(names[2], names[0], names[1]) != ELEMENTWISE_SUCCESS ||
+        get_range(names[2], 0, size, c) != RANGE_SUCCESS))
+    {
+        printf("FAIL: ELEMENTWISE TEST could not compute min\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        if (c[i] != (a[i] < b[i] ? a[i] : b[i]))
+        {
+            printf("FAIL: ELEMENTWISE TEST wrong min at %d\n", i);
+            res = 0;
+        }
+    }
+
+    if (res && (vector_max(names[2], names[0], names[1]) != ELEMENTWISE_SUCCESS ||
+        get_range(names[2], 0, size, c) != RANGE_SUCCESS))
+    {
+        printf("FAIL: ELEMENTWISE TEST could not compute max\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        if (c[i] != (a[i] > b[i] ? a[i] : b[i]))
+        {
+            printf("FAIL: ELEMENTWISE TEST wrong max at %d\n", i);
+            res = 0;
+        }
+    }
+
+    // sizes differ, vector doesn't exist
+    if (res && (init("elemwiseshort", 10) != 1 ||
+        vector_add(names[2], names[0], "elemwiseshort") != ELEMENTWISE_FAIL ||
+        vector_scale("elemwisenone", names[0], 2) != ELEMENTWISE_FAIL))
+    {
+        printf("FAIL: ELEMENTWISE TEST invalid operation accepted\n");
+        res = 0;
+    }
+
+    destroy("elemwiseshort");
+    for (int v = 0; v < 3; v++)
+        destroy(names[v]);
+
+    free(a);
+    free(b);
+    free(c);
+
+    if (res)
+        printf("SUCCESS: ELEMENTWISE TEST passed\n");
+
+    return res;
+}
+
+
+
+// distance test //////////////////////////////////////////////////////////////////////////////////
+
+
+
+int distance_test()
+{
+    int size = 1001;
+    int a[1001];
+    int b[1001];
+    double dot = 0;
+    double l1 = 0;
+    double l2 = 0;
+    double norm_a = 0;
+    double norm_b = 0;
+
+    for (int i = 0; i < size; i++)
+    {
+        a[i] = i % 7 - 3;
+        b[i] = (i * 13) % 11 - 5;
+        dot += a[i] * b[i];
+        l1 += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        l2 += (double) (a[i] - b[i]) * (a[i] - b[i]);
+        norm_a += a[i] * a[i];
+        norm_b += b[i] * b[i];
+    }
+
+    int res = 1;
+    double value = 0;
+
+    if (init("distveca", size) != 1 || init("distvecb", size) != 1 || 
+        init("distveczero", size) != 1 ||
+        set_range("distveca", 0, size, a) != RANGE_SUCCESS || 
+        set_range("distvecb", 0, size, b) != RANGE_SUCCESS)
+    {
+        printf("FAIL: DISTANCE TEST could not initialize the vectors\n");
+        res = 0;
+    }
+    else if (get_distance("distveca", "distvecb", METRIC_DOT, &value) != DISTANCE_SUCCESS || 
+        value != dot)
+    {
+        printf("FAIL: DISTANCE TEST wrong dot product\n");
+        res = 0;
+    }
+    // squared, so the test doesn't need libm
+    else if (get_distance("distveca", "distvecb", METRIC_L1, &value) != DISTANCE_SUCCESS || 
+        value != l1 ||
+        get_distance("distveca", "distvecb", METRIC_L2, &value) != DISTANCE_SUCCESS || 
+        value * value - l2 > 1e-6 || value * value - l2 < -1e-6)
+    {
+        printf("FAIL: DISTANCE TEST wrong distance\n");
+        res = 0;
+    }
+    else if (get_distance("distveca", "distvecb", METRIC_COSINE, &value) != DISTANCE_SUCCESS || 
+        (value < 0) != (dot < 0) || 
+        value * value - dot * dot / (norm_a * norm_b) > 1e-9 || 
+        value * value - dot * dot / (norm_a * norm_b) < -1e-9 ||
+        get_distance("distveca", "distveca", METRIC_COSINE, &value) != DISTANCE_SUCCESS || 
+        value - 1 > 1e-9 || value - 1 < -1e-9)
+    {
+        printf("FAIL: DISTANCE TEST wrong cosine similarity\n");
+        res = 0;
+    }
+    else if (get_distance("distveca", "distveczero", METRIC_COSINE, &value) != DISTANCE_FAIL ||
+        get_distance("distveca", "distvecnone", METRIC_L1, &value) != DISTANCE_FAIL)
+    {
+        printf("FAIL: DISTANCE TEST invalid comparison accepted\n");
+        res = 0;
+    }
+
+    destroy("distveca");
+    destroy("distvecb");
+    destroy("distveczero");
+
+    if (res)
+        printf("SUCCESS: DISTANCE TEST passed\n");
+
+    return res;
+}
+
+
+
+int nearest_test()
+{
+    int size = 64;
+    int num_of_candidates = 150;    // more than fit into one message
+    char names[152][20];
+    char* candidates[152];
+    int values[64];
+    int res = 1;
+
+    for (int i = 0; i < size; i++)
+        values[i] = i;
+
+    if (init("nearestquery", size) != 1 || set_range("nearestquery", 0, size, values) != 0)
+        res = 0;
+
+    // every element of candidate i is greater than the query by a different offset
+    for (int c = 0; c < num_of_candidates && res; c++)
+    {
+        sprintf(names[c], "nearest%d", c);
+        candidates[c] = names[c];
+
+        for (int i = 0; i < size; i++)
+            values[i] = i + (c * 37) % 151;
+
+        if (init(names[c], size) != 1 || set_range(names[c], 0, size, values) != RANGE_SUCCESS)
+            res = 0;
+    }
+
+    // skipped: doesn't exist and has another size
+    strcpy(names[150], "nearestnone");
+    strcpy(names[151], "nearestshort");
+    candidates[150] = names[150];
+    candidates[151] = names[151];
+
+    if (!res || init("nearestshort", 10) != 1)
+    {
+        printf("FAIL: NEAREST TEST could not initialize the vectors\n");
+        res = 0;
+    }
+
+    int indexes[MAX_NEAREST_K];
+    double distances[MAX_NEAREST_K];
+    int found;
+
+    if (res && (found = find_nearest("nearestquery", candidates, 152, METRIC_L1, 5, indexes, 
+        distances)) != 5)
+    {
+        printf("FAIL: NEAREST TEST found %d candidates\n", found);
+        res = 0;
+    }
+
+    // offsets 0..4 are candidates c with c * 37 % 151 == offset
+    for (int n = 0; n < 5 && res; n++)
+    {
+        if ((indexes[n] * 37) % 151 != n || distances[n] != n * size)
+        {
+            printf("FAIL: NEAREST TEST wrong nearest candidate\n");
+            res = 0;
+        }
+    }
+
+    // the greatest dot product is the greatest offset
+    if (res && (find_nearest("nearestquery", candidates, 152, METRIC_DOT, 1, indexes, 
+        distances) != 1 || (indexes[0] * 37) % 151 != 150))
+    {
+        printf("FAIL: NEAREST TEST wrong dot product nearest\n");
+        res = 0;
+    }
+
+    if (res && (find_nearest("nearestnone", candidates, 152, METRIC_L1, 5, indexes, 
+        distances) != NEAREST_FAIL || 
+        find_nearest("nearestquery", candidates, 152, METRIC_L1, MAX_NEAREST_K + 1, indexes, 
+        distances) != NEAREST_FAIL))
+    {
+        printf("FAIL: NEAREST TEST invalid request accepted\n");
+        res = 0;
+    }
+
+    destroy("nearestquery");
+    destroy("nearestshort");
+    for (int c = 0; c < num_of_candidates; c++)
+        destroy(names[c]);
+
+    if (res)
+        printf("SUCCESS: NEAREST TEST passed\n");
+
+    return res;
+}
+
+
+
+// transfer test ////////////////////////////////////////////////////////////////////////////////
+
+
+
+int transfer_test()
+{
+    int size = 300001;  // more than one chunk
+    int* values = malloc(size * sizeof(int));
+    int* got = malloc(size * sizeof(int));
+    int res = values != NULL && got != NULL;
+
+    for (int i = 0; i < size && res; i++)
+        values[i] = i % 2 == 0 ? i * 7 : -i;
+
+    // elements are little-endian, like on this host
+    FILE* p_file = fopen("transfer.bin", "wb");
+    if (!res || p_file == NULL || fwrite(values, sizeof(int), size, p_file) != (size_t) size ||
+        fclose(p_file) != 0)
+    {
+        printf("FAIL: TRANSFER TEST could not write the file\n");
+        res = 0;
+    }
+    // created with the size of the file
+    else if (import_vector("transferbin", "transfer.bin", TRANSFER_FORMAT_BINARY) != size ||
+        get_range("transferbin", 0, size, got) != RANGE_SUCCESS)
+    {
+        printf("FAIL: TRANSFER TEST could not import a binary file\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        if (got[i] != values[i])
+        {
+            printf("FAIL: TRANSFER TEST wrong imported value at %d\n", i);
+            res = 0;
+        }
+    }
+
+    if (res && (export_vector("transferbin", "transfer.txt", TRANSFER_FORMAT_TEXT) != size ||
+        import_vector("transfertxt", "transfer.txt", TRANSFER_FORMAT_TEXT) != size ||
+        export_vector_to_buffer("transfertxt", got, size) != size))
+    {
+        printf("FAIL: TRANSFER TEST could not move the vector through a text file\n");
+        res = 0;
+    }
+
+    for (int i = 0; i < size && res; i++)
+    {
+        if (got[i] != values[i])
+        {
+            printf("FAIL: TRANSFER TEST wrong exported value at %d\n", i);
+            res = 0;
+        }
+    }
+
+    int small[3] = { 4, -5, 6 };
+    int small_got[3];
+
+    if (res && (import_vector_from_buffer("transfertxt", small, 3) != TRANSFER_FAIL ||
+        export_vector_to_buffer("transfertxt", got, size - 1) != TRANSFER_FAIL ||
+        import_vector_from_buffer("transfershm", small, 3) != 3 ||
+        export_vector_to_buffer("transfershm", small_got, 3) != 3 || small_got[1] != -5))
+    {
+        printf("FAIL: TRANSFER TEST wrong transfer through a buffer\n");
+        res = 0;
+    }
+
+    // empty lines and white space are skipped
+    p_file = fopen("transfer.txt", "w");
+    if (res && (p_file == NULL || fprintf(p_file, "7\r\n\n -8\n9") < 0 || fclose(p_file) != 0 ||
+        import_vector("transfershm", "transfer.txt", TRANSFER_FORMAT_TEXT) != 3 ||
+        get_range("transfershm", 0, 3, small_got) != RANGE_SUCCESS || small_got[0] != 7 || 
+        small_got[1] != -8 || small_got[2] != 9))
+    {
+        printf("FAIL: TRANSFER TEST could not import text\n");
+        res = 0;
+    }
+
+    p_file = fopen("transfer.txt", "w");
+    if (res && (p_file == NULL || fprintf(p_file, "1\n2\nthree\n") < 0 || fclose(p_file) != 0 ||
+        import_vector("transfershm", "transfer.txt", TRANSFER_FORMAT_TEXT) != TRANSFER_FAIL ||
+        import_vector("transfershm", "transfer.missing", TRANSFER_FORMAT_TEXT) != TRANSFER_FAIL ||
+        export_vector("transfernone", "transfer.txt", TRANSFER_FORMAT_TEXT) != TRANSFER_FAIL ||
+        get_range("transfershm", 0, 3, small_got) != RANGE_SUCCESS || small_got[0] != 7 || 
+        small_got[1] != -8 || small_got[2] != 9))
+    {
+        printf("FAIL: TRANSFER TEST invalid transfer accepted\n");
+        res = 0;
+    }
+
+    // a failed export leaves the file as it was, the files of the server are never touched
+    struct stat file_stat;
+    if (res && (stat("transfer.txt", &file_stat) != 0 || file_stat.st_size != 10 ||
+        export_vector("transfershm", "vectors/transfershm.vec", TRANSFER_FORMAT_BINARY) != 
+            TRANSFER_FAIL ||
+        export_vector("transfershm", "vectors/../vectors/exported.bin", TRANSFER_FORMAT_BINARY) != 
+            TRANSFER_FAIL ||
+        stat("vectors/exported.bin", &file_stat) == 0))
+    {
+        printf("FAIL: TRANSFER TEST export overwrote a file\n");
+        res = 0;
+    }
+
+    destroy("transferbin");
+    destroy("transfertxt");
+    destroy("transfershm");
+    remove("transfer.bin");
+    remove("transfer.txt");
+
+    free(values);
+    free(got);
+
+    if (res)
+        printf("SUCCESS: TRANSFER TEST passed\n");
+
+    return res;
+}
+
+
+
+// all tests //////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int all_tests()
+{
+    int res = 1;
+    int basic_test_res = basic_test();
+    int multi_test_res = multithreaded_test();
+    int batch_test_res = batch_test();
+    int range_test_res = range_test();
+    int session_test_res = session_test();
+    int shm_test_res = shm_test();
+    int async_test_res = async_test();
+    int handle_test_res = handle_test();
+    int priority_test_res = priority_test();
+    int durability_test_res = durability_test();
+    int rmw_test_res = rmw_test();
+    int reduce_test_res = reduce_test();
+    int elementwise_test_res = elementwise_test();
+    int distance_test_res = distance_test();
+    int nearest_test_res = nearest_test();
+    int transfer_test_res = transfer_test();
+
+    if (basic_test_res && multi_test_res && batch_test_res && range_test_res && 
+        session_test_res && shm_test_res && async_test_res && handle_test_res && 
+        priority_test_res && durability_test_res && rmw_test_res && reduce_test_res &&
+        elementwise_test_res && distance_test_res && nearest_test_res && transfer_test_res)
         printf("GLOBAL SUCCESS: ALL TESTS PASSED\n");
     else
     {
@@ -10,6 +10,26 @@
 #include "vec.h"
 #include <dirent.h>
 #include <sys/stat.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <endian.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <signal.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <math.h>
+#include <ctype.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
 
 
 
@@ -20,27 +40,86 @@
 #define INITIAL_COMMAND "c"
 #define EXIT_COMMAND "q"
 
+// server configuration ///////////////////////////////////////////////////////////////////////////
+#define STORAGE_MODE_FILE 0     // every get/set is a pread/pwrite on the vector file
+#define STORAGE_MODE_MMAP 1     // vector files are mapped into memory, get/set are loads/stores
+#define STORAGE_MODE_CACHE 2    // recently used vectors are copied into memory, sets are written 
+                                // back to the files by the flush thread
+#define DEFAULT_STORAGE_MODE STORAGE_MODE_FILE
+#define DEFAULT_MSYNC_INTERVAL_MS 1000  // 0 --> mappings and caches are synced only on eviction
+                                        // and server shutdown
+#define DEFAULT_CACHE_BUDGET_MB 256     // max memory used by cached vectors in cache mode
+#define DEFAULT_CHECKPOINT_INTERVAL_MS 1000  // how often logged vectors are checkpointed
+#define DEFAULT_DURABILITY DURABILITY_NONE  // of vectors created without their own durability
+#define DEFAULT_FLUSH_INTERVAL_MS 100   // periodic durability, see -f
+#define DEFAULT_FLUSH_OPS 1000
+#define DEFAULT_NUM_OF_WORKERS 8        // request worker threads started with the server
+#define DEFAULT_NUM_OF_LOCK_STRIPES 16  // max number of element range locks per vector
+#define MIN_LOCK_STRIPE_LEN 1024        // vectors are not split into smaller stripes than this
+#define DEFAULT_READ_PRIORITY 2         // worker queue priorities of request classes, see -p
+#define DEFAULT_WRITE_PRIORITY 1
+#define DEFAULT_BULK_PRIORITY 0
+#define REQUEST_CLASS_READ 0            // get, batch and range get, handle get
+#define REQUEST_CLASS_WRITE 1           // set, handle set, read-modify-write
+#define REQUEST_CLASS_BULK 2            // everything else, e.g. init, destroy, batch and range set
+#define NUM_OF_REQUEST_CLASSES 3
+#define NUM_OF_REQUEST_PRIORITIES 3     // priorities are 0..NUM_OF_REQUEST_PRIORITIES - 1
+
+/*
+    settings which can be changed with command line arguments, see print_usage
+*/
+struct server_config {
+    int storage_mode;           // STORAGE_MODE_FILE, STORAGE_MODE_MMAP or STORAGE_MODE_CACHE
+    int msync_interval_ms;      // how often mapped or cached vectors are flushed to disk
+    int num_of_workers;         // size of the request worker pool
+    int num_of_lock_stripes;    // max number of element range locks per vector
+    int request_priorities[NUM_OF_REQUEST_CLASSES]; // priority of every request class in the 
+                                                    // worker queue, higher is served first
+    int cache_budget_mb;        // max memory used by cached vectors in cache mode
+    int checkpoint_interval_ms; // how often vector files of logged vectors are checkpointed
+    int durability;             // DURABILITY_NONE, DURABILITY_PERIODIC or DURABILITY_STRICT, used
+                                // by vectors created with DURABILITY_DEFAULT
+    int flush_interval_ms;      // periodic durability: the log is written at least this often
+    int flush_ops;              // or when this many changes are waiting
+};
+
+// responses //////////////////////////////////////////////////////////////////////////////////////
+/*
+    message sent by this server to a client sending init_msg, set_msg, get_msg or destroy_msg.
+    request_id is copied from the request, so a client with many requests in flight can match 
+    responses which come back out of order
+*/
+struct op_resp_msg {
+    int result;     // NEW_VECTOR_CREATED..., SET_SUCCESS..., GET_SUCCESS... or DESTROY_SUCCESS...
+    int value;      // if get succeeded then contains value from requested position
+    int request_id;
+};
+
+#define OP_RESP_MSG_SIZE sizeof(struct op_resp_msg)
+
 // init vector ////////////////////////////////////////////////////////////////////////////////////
-#define INIT_VECTOR_QUEUE_NAME "/init"
 #define NEW_VECTOR_CREATED 1
 #define VECTOR_ALREADY_EXISTS 0
 #define VECTOR_CREATION_ERROR -1
-#define INIT_VECTOR_QUEUE_MAX_MESSAGES 10
 #define MAX_VECTOR_NAME_LEN 40
 #define MAX_RESP_QUEUE_NAME_LEN 64
+#define DURABILITY_DEFAULT 0    // the vector follows the server setting (-d)
+#define DURABILITY_NONE 1       // changes are not logged and vector files are never synced
+#define DURABILITY_PERIODIC 2   // changes are logged, the log is written in the background
+#define DURABILITY_STRICT 3     // the response is sent after the change is in the synced log
 
 // message sent to this server to create a new vector
 struct init_msg {
     char name[MAX_VECTOR_NAME_LEN];                 // new vector name
     int size;                                       // size of the vector
+    int durability;                                 // DURABILITY_*, kept in the vector file
+    int request_id;                                 // copied into the response
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
 };
 
 #define INIT_MSG_SIZE sizeof(struct init_msg)
 
 // set value in vector ////////////////////////////////////////////////////////////////////////////
-#define SET_QUEUE_NAME "/set"
-#define SET_QUEUE_MAX_MESSAGES 10
 #define SET_SUCCESS 0
 #define SET_FAIL -1
 
@@ -49,14 +128,13 @@ struct set_msg {
     char name[MAX_VECTOR_NAME_LEN];                 // name of the vector to be modified
     int pos;                                        // index of the element to be modified
     int value;                                      // value to be put on the specified position
+    int request_id;                                 // copied into the response
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
 };
 
 #define SET_MSG_SIZE sizeof(struct set_msg)
 
 // get value from vector //////////////////////////////////////////////////////////////////////////
-#define GET_QUEUE_NAME "/get"
-#define GET_QUEUE_MAX_MESSAGES 10
 #define GET_SUCCESS 0
 #define GET_FAIL -1
 
@@ -64,72 +142,756 @@ struct set_msg {
 struct get_msg {
     char name[MAX_VECTOR_NAME_LEN];                 // name of the vector
     int pos;                                        // index of the requested element
+    int request_id;                                 // copied into the response
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
 };
 
 #define GET_MSG_SIZE sizeof(struct get_msg)
 
-// message sent by this server to a client sending get_msg 
-struct get_resp_msg {
-    int value;  // if no error then contains value from requested position
-    int error;  // 0 --> success; -1 --> fail
-};
-
-#define GET_RESP_MSG_SIZE sizeof(struct get_resp_msg)
 
 // destroy vector /////////////////////////////////////////////////////////////////////////////////
-#define DESTROY_QUEUE_NAME "/destroy"
-#define DESTROY_QUEUE_MAX_MESSAGES 10
 #define DESTROY_SUCCESS 1
 #define DESTROY_FAIL -1
 
 // message sent to this server to destroy a particular vector
 struct destroy_msg {
     char name[MAX_VECTOR_NAME_LEN];                 // name of the vector to be destroyed
+    int request_id;                                 // copied into the response
     char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
 };
 
 #define DESTROY_MSG_SIZE sizeof(struct destroy_msg)
 
+// batch //////////////////////////////////////////////////////////////////////////////////////////
+#define BATCH_SUCCESS 0
+#define BATCH_FAIL -1
+#define BATCH_OP_SET 0
+#define BATCH_OP_GET 1
+#define MAX_BATCH_LEN 512           // max number of elements in one batch message
+#define MAX_BATCH_SPAN_LEN 8192     // in file mode batches whose positions fit into a span this 
+                                    // long are done with one pread (and one pwrite for set)
+
+// one element of a batch, value is ignored in a get batch
+struct batch_elem {
+    int pos;
+    int value;
+};
+
+// message sent to this server to set or get many elements of one vector at once
+struct batch_msg {
+    char name[MAX_VECTOR_NAME_LEN];                 // name of the vector
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+    int op;                                         // BATCH_OP_SET or BATCH_OP_GET
+    int len;                                        // number of elements in the batch
+    struct batch_elem elems[MAX_BATCH_LEN];         // only the first len are sent
+};
+
+#define BATCH_MSG_SIZE sizeof(struct batch_msg)
+
+// message sent by this server to a client sending batch_msg
+struct batch_resp_msg {
+    int error;                  // 0 --> success; -1 --> fail, nothing was set
+    int len;                    // number of values, 0 for a set batch
+    int values[MAX_BATCH_LEN];  // values read by a get batch, only the first len are sent
+};
+
+#define BATCH_RESP_MSG_HEADER_SIZE offsetof(struct batch_resp_msg, values)
+
+// range //////////////////////////////////////////////////////////////////////////////////////////
+#define RANGE_SUCCESS 0
+#define RANGE_FAIL -1
+#define RANGE_OP_SET 0
+#define RANGE_OP_GET 1
+#define MAX_RANGE_LEN 2000  // max number of elements in one range message, fits into 8 KB
+
+// message sent to this server to set or get consecutive elements of one vector
+struct range_msg {
+    char name[MAX_VECTOR_NAME_LEN];                 // name of the vector
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+    int op;                                         // RANGE_OP_SET or RANGE_OP_GET
+    int start;                                      // position of the first element
+    int len;                                        // number of elements
+    int values[MAX_RANGE_LEN];                      // values to set, only the first len are sent,
+                                                    // not sent for get
+};
+
+#define RANGE_MSG_SIZE sizeof(struct range_msg)
+
+// message sent by this server to a client sending range_msg
+struct range_resp_msg {
+    int error;                  // 0 --> success; -1 --> fail
+    int len;                    // number of values, 0 for set
+    int values[MAX_RANGE_LEN];  // values read by get, only the first len are sent
+};
+
+#define RANGE_RESP_MSG_HEADER_SIZE offsetof(struct range_resp_msg, values)
+
+// atomic read-modify-write ///////////////////////////////////////////////////////////////////////
+#define RMW_SUCCESS 0
+#define RMW_FAIL -1
+#define RMW_OP_FETCH_ADD 0      // adds operand
+#define RMW_OP_CAS 1            // sets operand if the element is equal to expected
+#define RMW_OP_EXCHANGE 2       // sets operand
+
+/*
+    message sent to this server to change an element depending on its current value in one 
+    step. The response value is the value of the element before the change
+*/
+struct rmw_msg {
+    char name[MAX_VECTOR_NAME_LEN];                 // name of the vector
+    int op;                                         // RMW_OP_*
+    int pos;                                        // index of the element
+    int operand;                                    // value added or set
+    int expected;                                   // compared with the element by cas
+    int request_id;                                 // copied into the response
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+};
+
+#define RMW_MSG_SIZE sizeof(struct rmw_msg)
+
+// reductions /////////////////////////////////////////////////////////////////////////////////////
+#define REDUCE_SUCCESS 0
+#define REDUCE_FAIL -1
+#define REDUCE_OP_SUM 0
+#define REDUCE_OP_MIN 1
+#define REDUCE_OP_MAX 2
+#define REDUCE_OP_MEAN 3
+#define REDUCE_OP_COUNT_NONZERO 4
+#define REDUCE_TO_END -1            // end of a range which covers the rest of the vector
+#define REDUCE_CHUNK_LEN 16384      // elements read at once when the vector is not in memory
+
+// message sent to this server to compute one value over the elements [start, end) of a vector
+struct reduce_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    int op;                                         // REDUCE_OP_*
+    int start;
+    int end;                                        // REDUCE_TO_END -> size of the vector
+    int request_id;                                 // copied into the response
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+};
+
+#define REDUCE_MSG_SIZE sizeof(struct reduce_msg)
+
+// message sent by this server to a client sending reduce_msg
+struct reduce_resp_msg {
+    int error;          // REDUCE_SUCCESS or REDUCE_FAIL
+    int request_id;
+    int64_t value;      // sum, min, max or number of nonzero elements
+    double mean;        // set only by REDUCE_OP_MEAN
+};
+
+#define REDUCE_RESP_MSG_SIZE sizeof(struct reduce_resp_msg)
+
+// partial results of a reduction, combined chunk by chunk
+struct reduce_acc {
+    int64_t sum;
+    int32_t min;
+    int32_t max;
+    int64_t num_of_nonzero;
+};
+
+// simd kernels ///////////////////////////////////////////////////////////////////////////////////
+#define SIMD_LEVEL_SCALAR 0
+#define SIMD_LEVEL_SSE41 1
+#define SIMD_LEVEL_AVX2 2
+
+// distances //////////////////////////////////////////////////////////////////////////////////////
+#define DISTANCE_SUCCESS 0
+#define DISTANCE_FAIL -1
+#define METRIC_DOT 0            // dot product, similarity
+#define METRIC_L1 1             // sum of absolute differences
+#define METRIC_L2 2             // euclidean distance
+#define METRIC_COSINE 3         // cosine similarity, fails for zero vectors
+#define DISTANCE_CHUNK_LEN 4096 // elements compared at once
+
+// message sent to this server to compare two vectors of the same size
+struct distance_msg {
+    char a[MAX_VECTOR_NAME_LEN];
+    char b[MAX_VECTOR_NAME_LEN];
+    int metric;                                     // METRIC_*
+    int request_id;                                 // copied into the response
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+};
+
+#define DISTANCE_MSG_SIZE sizeof(struct distance_msg)
+
+// message sent by this server to a client sending distance_msg
+struct distance_resp_msg {
+    int error;          // DISTANCE_SUCCESS or DISTANCE_FAIL
+    int request_id;
+    double value;
+};
+
+#define DISTANCE_RESP_MSG_SIZE sizeof(struct distance_resp_msg)
+
+// sums of a comparison, combined chunk by chunk
+struct distance_acc {
+    double dot;
+    double diff;        // sum of absolute or squared differences
+    double norm_a;      // squared norms, cosine only
+    double norm_b;
+};
+
+// nearest vectors ////////////////////////////////////////////////////////////////////////////////
+#define NEAREST_SUCCESS 0
+#define NEAREST_FAIL -1
+#define MAX_NEAREST_CANDIDATES 128  // vectors compared by one message, fits into 8 KB
+#define MAX_NEAREST_K 64
+
+/*
+    message sent to this server to find k candidates nearest to the query. Candidates which 
+    don't exist or have another size than the query are skipped
+*/
+struct nearest_msg {
+    char query[MAX_VECTOR_NAME_LEN];
+    int metric;                                     // METRIC_*
+    int k;
+    int num_of_candidates;
+    int request_id;                                 // copied into the response
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+    char candidates[MAX_NEAREST_CANDIDATES][MAX_VECTOR_NAME_LEN];
+};
+
+#define NEAREST_MSG_SIZE sizeof(struct nearest_msg)
+
+// message sent by this server to a client sending nearest_msg, nearest first
+struct nearest_resp_msg {
+    int error;                      // NEAREST_SUCCESS or NEAREST_FAIL
+    int request_id;
+    int len;                        // min(k, number of compared candidates)
+    int indexes[MAX_NEAREST_K];     // of the candidates in the message
+    double values[MAX_NEAREST_K];   // distance or similarity of every candidate
+};
+
+#define NEAREST_RESP_MSG_SIZE sizeof(struct nearest_resp_msg)
+
+// bulk import and export ////////////////////////////////////////////////////////////////////////
+#define TRANSFER_SUCCESS 0
+#define TRANSFER_FAIL -1
+#define TRANSFER_OP_IMPORT 0
+#define TRANSFER_OP_EXPORT 1
+#define TRANSFER_FORMAT_BINARY 0        // little-endian int32 elements, no header
+#define TRANSFER_FORMAT_TEXT 1          // one decimal element per line
+#define TRANSFER_FORMAT_SHM 2           // int32 elements in shared memory of the client
+#define MAX_TRANSFER_PATH_LEN 1024
+#define TRANSFER_CHUNK_LEN (256 * 1024)             // elements moved at once
+#define TRANSFER_TEXT_BUFFER_SIZE (1024 * 1024)     // bytes of text read or written at once
+#define TRANSFER_MAX_LINE_LEN 64
+
+/*
+    message sent to this server to load a whole vector from a file or shared memory, or to store
+    it there. The response value is the number of moved elements
+*/
+struct transfer_msg {
+    char name[MAX_VECTOR_NAME_LEN];
+    int op;                                         // TRANSFER_OP_*
+    int format;                                     // TRANSFER_FORMAT_*
+    int len;                                        // elements of the shared memory
+    int request_id;                                 // copied into the response
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+    char path[MAX_TRANSFER_PATH_LEN];               // file on this host or shm_open name
+};
+
+#define TRANSFER_MSG_SIZE sizeof(struct transfer_msg)
+
+// source or destination of an import or export
+struct transfer_stream {
+    int format;
+    int fd;                 // file, -1 for shared memory
+    int32_t* p_shm;         // mapped shared memory, NULL for files
+    int shm_len;
+    int num_of_elems;       // elements read or written so far
+    char* text;             // text format buffer
+    int text_len;           // bytes in the buffer
+    int text_pos;           // first byte not parsed yet
+    int text_eof;           // the whole file is in the buffer
+};
+
+// parallel tasks /////////////////////////////////////////////////////////////////////////////////
+#define PARALLEL_MAX_TASKS 16           // threads computing one request at once
+#define PARALLEL_MIN_TASK_LEN 65536     // elements, shorter work is not split
+
+/*
+    tasks of one run_parallel_tasks call. It's queued until all its tasks are claimed by the 
+    compute workers or the calling thread
+*/
+struct parallel_run {
+    void* (*function)(void*);
+    char* tasks;
+    size_t task_size;
+    int num_of_tasks;
+    int num_of_claimed;     // guarded by mutex_compute, like the rest of the counters
+    int num_of_done;
+    struct parallel_run* p_next;    // next run in the compute queue
+};
+
+// vector groups //////////////////////////////////////////////////////////////////////////////////
+#define MAX_GROUP_VECTORS 3
+
+/*
+    vectors used together by one request. They are locked in the order of their names, so two 
+    requests can't wait for each other
+*/
+struct vector_group {
+    struct vector_mutex* vectors[MAX_GROUP_VECTORS];   // distinct, ordered by name
+    int num_of_vectors;
+    int num_of_locked;      // vectors whose lock is taken, the first ones
+};
+
+// element-wise operations ////////////////////////////////////////////////////////////////////////
+#define ELEMENTWISE_SUCCESS 0
+#define ELEMENTWISE_FAIL -1
+#define ELEMENTWISE_OP_ADD 0        // target = x + y
+#define ELEMENTWISE_OP_SCALE 1      // target = k * x
+#define ELEMENTWISE_OP_AXPY 2       // target = k * x + y
+#define ELEMENTWISE_OP_MIN 3        // target = min(x, y)
+#define ELEMENTWISE_OP_MAX 4        // target = max(x, y)
+#define ELEMENTWISE_CHUNK_LEN WAL_MAX_RECORD_LEN    // elements computed at once by a task
+
+/*
+    message sent to this server to compute target from the vectors x and y, element by element.
+    All vectors must have the same size, the target may be one of the sources. Results wrap 
+    around on overflow
+*/
+struct elementwise_msg {
+    char target[MAX_VECTOR_NAME_LEN];
+    char x[MAX_VECTOR_NAME_LEN];
+    char y[MAX_VECTOR_NAME_LEN];                    // ignored by scale
+    int op;                                         // ELEMENTWISE_OP_*
+    int k;                                          // used by scale and axpy
+    int request_id;                                 // copied into the response
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+};
+
+#define ELEMENTWISE_MSG_SIZE sizeof(struct elementwise_msg)
+
+// candidates [first, last) of a nearest request compared by one thread, with their k nearest
+struct nearest_task {
+    struct nearest_msg* p_msg;
+    int32_t* query;     // copy of the query vector
+    int size;
+    int first;
+    int last;
+    int len;
+    int indexes[MAX_NEAREST_K];
+    double values[MAX_NEAREST_K];
+};
+
+// part of an element-wise operation computed by one thread
+struct elementwise_task {
+    struct vector_mutex* p_target;
+    struct vector_mutex* p_x;
+    struct vector_mutex* p_y;   // NULL for scale
+    int op;
+    int k;
+    int start;
+    int end;
+    int res;    // 1 -> success, 0 -> fail
+    uint64_t wal_pending_lsn;   // end of the last record appended by the task, committed by 
+                                // the request thread
+};
+
+// vector handles /////////////////////////////////////////////////////////////////////////////////
+#define HANDLE_SUCCESS 0
+#define HANDLE_FAIL -1
+#define MAX_VECTOR_HANDLES 4096     // vector handles opened at once by all clients
+#define MAX_HANDLE_CLIENTS 1024     // client threads registered at once
+#define HANDLE_OP_REGISTER 0        // result is the client id, sent to resp_queue_name
+#define HANDLE_OP_UNREGISTER 1      // no response
+#define HANDLE_OP_OPEN 2            // result is the vector handle
+#define HANDLE_OP_CLOSE 3
+#define HANDLE_OP_SET 4
+#define HANDLE_OP_GET 5
+
+/*
+    message sent to this server to use a vector through a handle. Instead of names a client 
+    registers its response queue once, opens a vector once and then sends only the fields up to 
+    name, which the server maps directly to the queue and the vector
+*/
+struct handle_msg {
+    int op;                                         // HANDLE_OP_*
+    int client_id;                                  // returned by register
+    int handle;                                     // returned by open
+    int pos;                                        // index of the element for set and get
+    int value;                                      // value for set
+    int request_id;                                 // copied into the response
+    char name[MAX_VECTOR_NAME_LEN];                 // only sent for open
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // only sent for register
+};
+
+#define HANDLE_MSG_SIZE sizeof(struct handle_msg)
+
+/*
+    entry of a table of registered clients or opened vector handles. An id given out for the 
+    entry is generation * table size + index, so ids of closed entries are recognized as stale
+    after the entry is reused
+*/
+struct handle_entry {
+    pthread_rwlock_t lock;              // shared while the entry is used, exclusive on close
+    int in_use;                         // changed under the table mutex and the exclusive lock
+    int generation;
+    struct vector_mutex* p_vec_mutex;   // pinned vector of a handle
+    mqd_t q_resp;                       // response queue of a client, opened once
+};
+
+struct handle_table {
+    pthread_mutex_t mutex;      // serializes adding and removing entries
+    struct handle_entry* entries;
+    int size;
+};
+
+// shared memory transport ////////////////////////////////////////////////////////////////////////
+#define ATTACH_SUCCESS 0
+#define ATTACH_FAIL -1
+#define MAX_SHM_NAME_LEN 64
+#define SHM_RING_CAPACITY 64        // power of 2, max number of requests in flight on a channel
+#define SHM_SPIN_ITERATIONS 4000    // polls of an empty ring before sleeping on the futex
+#define SHM_STOP_CHECK_INTERVAL_MS 100  // how often a sleeping channel thread checks for shutdown
+#define SHM_OP_INIT 0
+#define SHM_OP_SET 1
+#define SHM_OP_GET 2
+#define SHM_OP_DESTROY 3
+#define SHM_OP_DETACH 4             // last request of a channel, the server stops serving it
+
+// message sent to this server to start serving a shared memory channel created by a client
+struct attach_msg {
+    char shm_name[MAX_SHM_NAME_LEN];                // shm_open name of the channel
+    char resp_queue_name[MAX_RESP_QUEUE_NAME_LEN];  // queue to which a response will be sent
+};
+
+#define ATTACH_MSG_SIZE sizeof(struct attach_msg)
+
+// request written by a client into the request ring of its channel
+struct shm_request {
+    int op;                             // one of SHM_OP_*
+    int pos;                            // position for set and get, size for init
+    int value;                          // value for set, durability for init
+    char name[MAX_VECTOR_NAME_LEN];     // name of the vector
+};
+
+// response written by this server into the response ring, at the index of the request
+struct shm_response {
+    int result;     // the same as the response of the corresponding message queue request
+    int value;      // value for get
+};
+
+/*
+    shared memory of one client thread. Both rings are single producer single consumer: the 
+    client writes requests and bumps req_tail, the server writes the response of request i at
+    index i and bumps resp_tail. Tails are also futex words, a consumer which found its ring 
+    empty for SHM_SPIN_ITERATIONS polls sets its sleeping flag and waits on the tail, and the
+    producer wakes it only if the flag is set. Heads are private to the consumers
+*/
+struct shm_channel {
+    uint32_t req_tail __attribute__((aligned(64)));   // number of requests written
+    uint32_t server_sleeping;
+    uint32_t resp_tail __attribute__((aligned(64)));  // number of responses written
+    uint32_t client_sleeping;
+    struct shm_request requests[SHM_RING_CAPACITY] __attribute__((aligned(64)));
+    struct shm_response responses[SHM_RING_CAPACITY];
+};
+
+/*
+    channel attached to this server, served by its own thread
+*/
+struct shm_client {
+    struct shm_channel* p_channel;
+    pthread_t thread;
+    int stop;                       // set to 1 on shutdown
+    int finished;                   // set to 1 by the thread when it stops serving the channel
+    struct shm_client* p_next;      // guarded by mutex_shm_clients
+};
+
 // general errors errors //////////////////////////////////////////////////////////////////////////
-#define QUEUE_OPEN_ERROR 13
-#define QUEUE_INIT_SUCCESS 1
-#define REQUEST_THREAD_CREATE_SUCCESS 0
-#define REQUEST_THREAD_CREATE_FAIL -1
+#define REQUEST_DISPATCH_SUCCESS 0
+#define REQUEST_DISPATCH_FAIL -1
+
+// requests queue /////////////////////////////////////////////////////////////////////////////////
+#define REQUESTS_QUEUE_NAME "/requests"
+#define REQUESTS_QUEUE_MAX_MESSAGES 10
+#define OP_INIT_VECTOR 0
+#define OP_SET 1
+#define OP_GET 2
+#define OP_DESTROY 3
+#define OP_BATCH 4
+#define OP_RANGE 5
+#define OP_ATTACH 6
+#define OP_HANDLE 7
+#define OP_RMW 8
+#define OP_REDUCE 9
+#define OP_ELEMENTWISE 10
+#define OP_DISTANCE 11
+#define OP_NEAREST 12
+#define OP_TRANSFER 13
+#define NUM_OF_OPCODES 14
+
+/*
+    buffer big enough for the body of any request
+*/
+union request_body {
+    struct init_msg init;
+    struct set_msg set;
+    struct get_msg get;
+    struct destroy_msg destroy;
+    struct batch_msg batch;
+    struct range_msg range;
+    struct attach_msg attach;
+    struct handle_msg handle;
+    struct rmw_msg rmw;
+    struct reduce_msg reduce;
+    struct elementwise_msg elementwise;
+    struct distance_msg distance;
+    struct nearest_msg nearest;
+    struct transfer_msg transfer;
+};
+
+/*
+    message received from the requests queue. opcode tells which member of body was sent and 
+    which handler serves the request. Clients send only the used part of body, and set the 
+    message priority so that the queue gives reads before writes and bulk requests
+*/
+struct request_msg {
+    int opcode;     // OP_...
+    union request_body body;
+};
+
+#define REQUEST_MSG_SIZE sizeof(struct request_msg)
+#define REQUEST_MSG_HEADER_SIZE offsetof(struct request_msg, body)
+
+// event loop /////////////////////////////////////////////////////////////////////////////////////
+#define REQUESTS_EVENT_ID 0     // epoll id of the requests queue
+#define SHUTDOWN_EVENT_ID 1     // epoll id of the shutdown eventfd
+
+/*
+    handler executed by a worker for every request with one opcode, indexed by the opcode
+*/
+struct request_type {
+    void* (*handler)(void*);
+    char* description;      // used in error messages
+};
+
+// request workers ////////////////////////////////////////////////////////////////////////////////
+#define REQUEST_QUEUE_CAPACITY 64   // max number of requests waiting for a free worker
+
+/*
+    preallocated buffer for one in-flight request. The dispatcher receives a message straight 
+    into a free slot and the worker gives the slot back to the pool after the request is served,
+    so messages are never copied between threads
+*/
+struct request_slot {
+    struct request_msg msg;
+};
+
+/*
+    request waiting in the in-process request queue for a free worker. function depends on the 
+    opcode of the message, it's called with the body of the message in p_slot
+*/
+struct request_task {
+    void* (*function)(void*);
+    struct request_slot* p_slot;
+};
 
 // storage ////////////////////////////////////////////////////////////////////////////////////////
 #define VECTORS_FOLDER "vectors/"
-#define VECTOR_FILE_EXTENSION ".txt"
-#define TEMP_VECTOR_FILE_EXTENSION ".tmp"
+#define VECTOR_FILE_EXTENSION ".vec"
+#define VECTOR_FILE_MAGIC 0x43455644                // "DVEC" when read as little-endian bytes
+#define VECTOR_FILE_VERSION 1
+#define VECTOR_ELEM_SIZE ((int) sizeof(int32_t))   // every element is a little-endian int32
+#define CACHE_PAGE_LEN 1024                         // elements covered by one dirty flag
+
+/*
+    header at the beginning of every vector file. All fields are stored little-endian. The header
+    is followed by size elements, so element pos lives at 
+    VECTOR_FILE_HEADER_SIZE + pos * VECTOR_ELEM_SIZE and can be read or written with one 
+    pread/pwrite
+*/
+struct vector_file_header {
+    uint32_t magic;         // VECTOR_FILE_MAGIC, used to reject files in other formats
+    uint32_t version;       // VECTOR_FILE_VERSION
+    uint16_t elem_size;     // VECTOR_ELEM_SIZE
+    uint16_t durability;    // DURABILITY_*, DURABILITY_DEFAULT in files created before it was added
+    int32_t size;           // number of elements in the vector
+};
+
+#define VECTOR_FILE_HEADER_SIZE sizeof(struct vector_file_header)
 
 /*
     because this server is concurrent additional mechanisms must be applied to make sure, that
     different threads do not interrupt each other during data access, i.e. one thread could delete
-    a vector while other thread reads. In order to prevent it each vector has it's own mutex 
-    assigned. This struct contains all required information to make it working.
+    a vector while other thread reads. In order to prevent it each vector has it's own 
+    reader-writer lock assigned: operations on single elements (get, set) take it shared, and
+    operations on the whole vector (create, destroy) take it exclusive. Element index space is
+    additionally split into stripes with their own reader-writer locks, so gets run in parallel 
+    and sets to different regions of one big vector don't wait for each other. This struct 
+    contains all required information to make it working.
 */
 struct vector_mutex {
     char vector_name[MAX_VECTOR_NAME_LEN];
+    uint32_t name_hash; // hash of vector_name, selects the registry segment and the home slot
+    pthread_rwlock_t lock;
+    pthread_mutex_t open_mutex;     // serializes lazy opening of the file by shared lock holders
+    int num_of_waiting_threads;     // guarded by the registry segment mutex
+    int to_remove;                  // guarded by the registry segment mutex
+    int fd;     // descriptor of the opened vector file, -1 if not opened yet. Set once under
+                // open_mutex, reset only under the exclusive lock
+    int size;   // number of elements, read from the file header when the file is opened
+    void* p_map;        // whole vector file mapped into memory (mmap mode), NULL if not mapped
+    size_t map_len;     // length of the mapping in bytes
+    int32_t* p_data;    // first element inside the mapping or the cache, NULL if neither
+    uint8_t* dirty_pages;   // cache mode: one flag per CACHE_PAGE_LEN elements changed since the
+                            // last flush, NULL if the vector is not cached
+    int num_of_pages;
+    size_t cache_len;       // bytes of cached elements, counted in cache_used_bytes
+    uint64_t last_used_ms;  // cache mode: coarse time of the last access, for LRU eviction
+    uint64_t cache_scan_id; // id of the last eviction scan which tried to evict the vector
+    struct vector_mutex* p_cache_prev;  // list of cached vectors, guarded by mutex_cache
+    struct vector_mutex* p_cache_next;
+    pthread_rwlock_t* stripe_locks; // one lock per stripe of elements, taken after lock
+    int num_of_stripes;
+    int stripe_len;     // number of elements covered by one stripe lock
+    int durability;     // DURABILITY_* of the opened file, never DURABILITY_DEFAULT. 
+                        // DURABILITY_DEFAULT if the file was not opened yet
+    uint64_t wal_replay_from;   // startup only: number of the last log record which created or 
+                                // destroyed the vector, records up to it are not replayed
+    int manifest_slot;  // entry of the vector in the manifest, -1 if it has none. Changed only
+                        // under the exclusive lock
+};
+
+// manifest ///////////////////////////////////////////////////////////////////////////////////////
+#define MANIFEST_FILE_NAME VECTORS_FOLDER "manifest"
+#define MANIFEST_TMP_FILE_NAME VECTORS_FOLDER "manifest.tmp"   // manifest being rebuilt
+#define MANIFEST_MAGIC 0x464D5644       // "DVMF" when read as little-endian bytes
+#define MANIFEST_VERSION 1
+
+/*
+    the manifest lists all vectors, so that the server starts with one read of it instead of a
+    scan of the vectors folder. It's a header followed by fixed size entries, an entry is 
+    rewritten in place when a vector is created or destroyed and entries of destroyed vectors
+    are reused. All fields are stored little-endian
+*/
+struct manifest_header {
+    uint32_t magic;         // MANIFEST_MAGIC
+    uint32_t version;       // MANIFEST_VERSION
+    uint32_t entry_size;    // MANIFEST_ENTRY_SIZE
+    uint32_t reserved;
+};
+
+struct manifest_entry {
+    char name[MAX_VECTOR_NAME_LEN];     // empty --> the entry is free
+    int32_t size;           // number of elements, -1 if the header of the file couldn't be read
+    int32_t durability;     // DURABILITY_* from the vector file header
+};
+
+#define MANIFEST_HEADER_SIZE sizeof(struct manifest_header)
+#define MANIFEST_ENTRY_SIZE sizeof(struct manifest_entry)
+
+// write-ahead log ////////////////////////////////////////////////////////////////////////////////
+#define WAL_FILE_NAME VECTORS_FOLDER "wal.log"
+#define WAL_OLD_FILE_NAME VECTORS_FOLDER "wal.old.log"  // log being checkpointed
+#define WAL_BUFFER_SIZE (1024 * 1024)           // records appended while the log is written
+#define WAL_MAX_RECORD_LEN 4096                 // elements in one record, longer writes are split
+#define WAL_CHECKPOINT_SIZE (64 * 1024 * 1024)  // log length which starts a checkpoint early
+
+/*
+    every change of vector elements is appended to the log as a redo record before the response
+    is sent, and the vector files are made durable only by checkpoints. All fields are stored 
+    little-endian and the record is followed by len elements in the vector file byte order
+*/
+struct wal_record_header {
+    uint32_t checksum;  // FNV-1a of the rest of the record, detects a torn record at the end
+    int32_t pos;        // position of the first element
+    int32_t len;        // number of elements, 0 --> the vector was created or destroyed
+    char name[MAX_VECTOR_NAME_LEN];
+};
+
+#define WAL_RECORD_HEADER_SIZE sizeof(struct wal_record_header)
+
+// vector registry ////////////////////////////////////////////////////////////////////////////////
+#define REGISTRY_NUM_OF_SEGMENTS 64             // power of 2, every segment has its own lock
+#define REGISTRY_SEGMENT_INITIAL_CAPACITY 64    // power of 2
+#define REGISTRY_MAX_LOAD_PERCENT 70            // segment grows when more slots are used
+#define REGISTRY_TOMBSTONE ((struct vector_mutex*) 1)   // marks a slot of a removed entry
+
+/*
+    vector mutexes are kept in a hash table keyed by vector name. The table is split into 
+    segments, each one being a separate open addressing table (linear probing) with its own 
+    mutex, so lookups take O(1) and requests for different vectors rarely contend on the same 
+    lock. The segment mutex also guards num_of_waiting_threads and to_remove of its entries
+*/
+struct registry_segment {
     pthread_mutex_t mutex;
-    int num_of_waiting_threads;
-    int to_remove;
+    struct vector_mutex** slots;    // NULL --> empty slot, REGISTRY_TOMBSTONE --> removed entry
+    int capacity;                   // number of slots, power of 2
+    int num_of_used_slots;          // entries and tombstones
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // function declarations
 ///////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+    reads server settings from command line arguments into config. 1 -> success, 0 -> fail
+*/
+int parse_arguments(int argc, char** argv);
+/*
+    parses the -p argument "read,write,bulk" into config.request_priorities.
+    1 -> success, 0 -> fail
+*/
+int parse_request_priorities(char* arg);
+/*
+    parses the -f argument "ms,ops" into config.flush_interval_ms and config.flush_ops.
+    1 -> success, 0 -> fail
+*/
+int parse_flush_policy(char* arg);
+/*
+    prints available command line arguments
+*/
+void print_usage(char* program_name);
 /* 
     initializes server. 1 -> success, 0 -> fail
 */
 int init();
 /*
-    creates and opens queues to listen for requests. 1 -> success, 0 -> fail
+    creates and opens the queue to listen for requests. 1 -> success, 0 -> fail
 */
-int initialize_request_queues();
+int initialize_requests_queue();
 /*
-    creates mutex for every stored vector. 1 -> success, 0 -> fail
+    creates mutex for every stored vector, listed in the manifest. The vectors folder is scanned
+    and the manifest is rebuilt only if there is no valid manifest. 1 -> success, 0 -> fail
 */
 int initialize_vector_mutexes();
+/*
+    registers all vectors listed in the manifest, read with one read, and keeps the manifest 
+    opened for updates. 1 -> loaded, 0 -> there is no valid manifest
+*/
+int load_manifest();
+/*
+    writes a new manifest with all registered vectors, reading the header of every vector file,
+    and replaces the old one atomically. 1 -> success, 0 -> fail
+*/
+int create_manifest();
+/*
+    writes the manifest entry of the vector, taking a free entry if it has none yet. Entries of
+    durable vectors are synced. Must be called with the exclusive vector lock held. 
+    1 -> success, 0 -> fail
+*/
+int write_manifest_entry(struct vector_mutex* p_vec_mutex, int size, int durability);
+/*
+    frees the manifest entry of the vector, if it has one. Must be called with the exclusive 
+    vector lock held. 1 -> success, 0 -> fail
+*/
+int remove_manifest_entry(struct vector_mutex* p_vec_mutex);
+/*
+    writes one manifest entry, an empty name frees it. 1 -> success, 0 -> fail
+*/
+int write_manifest_slot(int slot, char* name, int size, int durability, int sync);
+/*
+    adds an entry to the list of free manifest entries. Must be called with mutex_manifest held
+*/
+void add_free_manifest_slot(int slot);
+/*
+    closes the manifest and frees the list of free entries
+*/
+void close_manifest();
 /*
     checks whether folder for storing vectors exists and if no then creates one
 */
@@ -139,10 +901,44 @@ int initialize_vectors_folder();
 */
 int destroy_vector_mutexes();
 /*
-    creates and adds a new vector mutex to the vector_mutexes list.
-    1 --> success, 0 --> fail
+    allocates the segments of the vector registry. 1 -> success, 0 -> fail
+*/
+int initialize_registry();
+/*
+    returns the registry segment responsible for vectors with the given name hash
+*/
+struct registry_segment* get_registry_segment(uint32_t name_hash);
+/*
+    FNV-1a hash of a vector name
+*/
+uint32_t hash_vector_name(char* name);
+/*
+    returns the slot in which probing for the given name hash starts
+*/
+int get_home_slot(struct registry_segment* p_segment, uint32_t name_hash);
+/*
+    returns the slot index of the entry for vector_name which is not marked to remove, -1 if 
+    there is no such entry. Segment mutex must be locked
+*/
+int find_registry_slot(struct registry_segment* p_segment, char* vector_name, uint32_t name_hash);
+/*
+    doubles the capacity of the segment and drops tombstones. Segment mutex must be locked.
+    1 -> success, 0 -> fail
+*/
+int grow_registry_segment(struct registry_segment* p_segment);
+/*
+    creates and adds a new vector mutex to the vector registry. Does nothing if there is already
+    a mutex for the vector which is not marked to remove. manifest_slot is the entry of the 
+    vector in the manifest, -1 if it has none yet. 1 --> success, 0 --> fail
+*/
+int add_vector_mutex(char* vec_name, int manifest_slot);
+/*
+    returns a vec.h vector with all vector mutexes which are not marked to remove. Every returned
+    mutex is counted as used by the calling thread, so it must be given back with
+    release_vector_mutex (or unlock_vector_mutex if it was locked). The vector must be freed
+    with vector_free. NULL -> fail
 */
-int add_vector_mutex(char* vec_name);
+struct vector_mutex** get_all_vector_mutexes();
 /*
     returns a pointer to the mutex for the vector with name equal to vector_name. Also increases
     the number of threads which are using the mutex. I keep track of it because on remove I must
@@ -150,123 +946,780 @@ int add_vector_mutex(char* vec_name);
 */
 struct vector_mutex* get_vector_mutex(char* vector_name);
 /*
-    calls pthread_mutex_unlock on the corresponding mutex and decreases the number of threads using
+    calls pthread_rwlock_unlock on the corresponding lock and decreases the number of threads using
     the mutex. Also if mutex is signed as to_remove and no more threads use it then it is removed.
 */
 int unlock_vector_mutex(struct vector_mutex* p_vec_mutex);
 /*
     notify that the thread is not using this mutex anymore, but was not locked so do not unlock
 */
-// int release_vector_mutex(struct vector_mutex* p_vec_mutex);
-/*
-    returns index of the mutex struct corresponding to the vector with name equal to vector_name
-    in the vector_mutexes list. Returns -1 if not found, index otherwise
-*/
-int get_vector_mutex_idx(char* vector_name);
+int release_vector_mutex(struct vector_mutex* p_vec_mutex);
 /*
     marks vector mutex to remove, so that no new threads can access it and it's removed when
     the last thread releases it
 */
 int mark_vector_mutex_to_remove(struct vector_mutex* p_vec_mutex);
 /*
-    generic method for starting threads for requests. thread_function depends on queue from
-    which server reads. Main thread waits till arguments are copied to new thread.
-    REQUEST_THREAD_CREATION_SUCCESS -> success, REQUEST_THREAD_CREATION_FAIL -> fail
+    starts config.num_of_workers threads which serve requests from the request queue.
+    1 -> success, 0 -> fail
+*/
+int start_request_workers();
+/*
+    lets the workers finish requests which are already in the request queue and waits for them
+*/
+void stop_request_workers();
+/*
+    body of a request worker thread. Takes tasks from the request queue and executes them
+*/
+void* request_worker(void*);
+/*
+    takes a free request slot from the pool, blocks if all slots are in use. There is one slot 
+    for every place in the request queue and every worker. NULL -> fail
+*/
+struct request_slot* acquire_request_slot();
+/*
+    gives back a slot which was acquired but not dispatched
+*/
+void release_request_slot(struct request_slot* p_slot);
+/*
+    generic method for handing requests over to the worker pool. function depends on the opcode
+    of the request. The slot belongs to the worker from now on, so the main thread can 
+    immediately receive the next message. Workers take requests with a higher priority first.
+    Blocks if the request queue is full.
+    REQUEST_DISPATCH_SUCCESS -> success, REQUEST_DISPATCH_FAIL -> fail
+*/
+int dispatch_request(void* (*function)(void*), struct request_slot* p_slot, int priority);
+/*
+    creates the epoll instance watching the requests queue and the shutdown eventfd.
+    1 -> success, 0 -> fail
+*/
+int initialize_event_loop();
+/*
+    closes the epoll instance and the shutdown eventfd
+*/
+void close_event_loop();
+/*
+    blocks until requests arrive and dispatches them to the workers, returns after shutdown
+    was requested
+*/
+void run_event_loop();
+/*
+    receives one message from the requests queue and dispatches it.
+    1 -> a message was received, 0 -> the queue is empty or couldn't be read
+*/
+int receive_request();
+/*
+    worker queue priority of a request, given by config.request_priorities for its class
 */
-int start_request_thread(void* (*thread_function)(void*), void* p_args);
+int get_request_priority(struct request_msg* p_msg);
 /*
-    set attributes and open a queue for vector initialization.
-    returns:
-    QUEUE_INIT_SUCCESS  if success
-    QUEUE_OPEN_ERROR    if error occurred during opening the queue
+    wakes up the event loop and makes it finish. Async signal safe
 */
-int initialize_init_vector_queue();
-int initialize_set_queue();
-int initialize_get_queue();
-int initialize_destroy_queue();
+void request_shutdown();
 /*
-    closes and unlinks all the queues which were created for listening for requests.
+    SIGINT and SIGTERM handler, requests shutdown
+*/
+void handle_shutdown_signal(int signal_number);
+/*
+    closes and unlinks the queue which was created for listening for requests.
     1 -> success, 0 -> fail
 */
 int close_queues();
 /*
-    creates a vector physically
+    sends the response to an init, set, get or destroy request
 */
-int create_vector(char* name, int size);
+void send_op_response(char* resp_queue_name, int result, int value, int request_id);
 /*
-    copy message during new request thread creation. Is thread safe in sense that 
-    it will notify the main thread that the message has been copied and the main thread 
-    can proceed
+    creates a vector physically
 */
-int copy_message(char* p_source, char* p_destination, int size);
+int create_vector(char* name, int size, int durability);
 /*
-    performs logic for new vector initialization. Serves requests from the "init queue".
-    Used as the function passed to request thread
+    performs logic for new vector initialization. Serves OP_INIT_VECTOR requests.
+    Executed by a request worker
 */
 void* init_vector(void* p_init_msg);
 /*
-    performs logic for setting a value in a vector. Serves requests from the "set queue".
-    Used as the function passed to request thread
+    performs logic for setting a value in a vector. Serves OP_SET requests.
+    Executed by a request worker
 */
 void* set(void* p_set_msg);
 /*
-    perfoms logic for getting a value form a vector. Servers requests from the "get queue".
-    Used as the function passed to request thread
+    perfoms logic for getting a value form a vector. Serves OP_GET requests.
+    Executed by a request worker
 */
 void* get(void* p_get_msg);
 /*
-    performs logic for destroying a vector. Serves requests from the "destroy queue".
-    Used as the function passed to request thread
+    removes a vector physically. DESTROY_SUCCESS -> success, DESTROY_FAIL -> fail
+*/
+int destroy_vector(char* name);
+/*
+    performs logic for destroying a vector. Serves OP_DESTROY requests.
+    Executed by a request worker
 */
 void* destroy(void* p_destroy_msg);
-/* 
-    starts a thread for reading user input. User input is readed in order to detect when
-    server should stop so that all the clean up can be done
+/*
+    performs logic for setting or getting many elements of a vector at once. Serves OP_BATCH 
+    requests. Executed by a request worker
 */
-int start_reading_user_input();
+void* batch(void* p_batch_msg);
 /*
-    read user input and store it in user_input global variable
+    performs logic for setting or getting consecutive elements of a vector. Serves OP_RANGE 
+    requests. Executed by a request worker
 */
-void *update_user_input(void*);
+void* range(void* p_range_msg);
 /*
-    create a file for a vector and initialize it with 0 values
+    applies a read-modify-write request to its vector, p_old_value gets the value of the element
+    before the change. RMW_SUCCESS or RMW_FAIL
 */
-int create_array_file(char* name, int size);
+int rmw_value_in_vector_file(struct rmw_msg* p_msg, int* p_old_value);
 /*
-    returns size of a vector which is saved in a vector file. Requeres opening a file
+    the same for a vector whose mutex is already obtained. The element is read and written under
+    one acquisition of its stripe lock, so concurrent changes of it are serialized
 */
-int get_vector_size(char* name);
-
-
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// global variables
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// general ////////////////////////////////////////////////////////////////////////////////////////
-char user_input[] = INITIAL_COMMAND;  // for main loop finish detection
-
-// request thread /////////////////////////////////////////////////////////////////////////////////
-pthread_mutex_t mutex_msg;  // mutex used for waiting unitil request thread copies a message
-int msg_not_copied = 1;     // flag used to check if a message has been copied by request thread
-pthread_cond_t cond_msg;    // condition used together with mutex_msg for waiting until request 
-                            // thread copies message
-pthread_attr_t request_thread_attr;
-
-pthread_mutex_t mutex_vec_mutex;    // mutex for acquiring and returning mutex for a particular
-                                    // vector file
+int rmw_value_in_vector(struct vector_mutex* p_vec_mutex, struct rmw_msg* p_msg, int* p_old_value);
+/*
+    performs logic for fetch-and-add, compare-and-swap and exchange. Serves OP_RMW requests. 
+    Executed by a request worker
+*/
+void* rmw(void* p_rmw_msg);
+/*
+    sets simd_level to the widest instruction set supported by this cpu
+*/
+void select_simd_level();
+/*
+    kernels over elements in host byte order, dispatched on simd_level. min_elems of no elements 
+    is INT32_MAX and max_elems INT32_MIN
+*/
+int64_t sum_elems(int32_t* elems, int len);
+int32_t min_elems(int32_t* elems, int len);
+int32_t max_elems(int32_t* elems, int len);
+int count_nonzero_elems(int32_t* elems, int len);
+/*
+    out = op(x, y, k) element by element, see ELEMENTWISE_OP_*. out may be x or y, y may be NULL
+    for scale
+*/
+void elementwise_elems(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len);
+void elementwise_elems_scalar(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len);
+/*
+    sums of x[i] * y[i], (x[i] - y[i])^2 and |x[i] - y[i]|, computed in doubles
+*/
+double dot_elems(int32_t* x, int32_t* y, int len);
+double sq_diff_elems(int32_t* x, int32_t* y, int len);
+double abs_diff_elems(int32_t* x, int32_t* y, int len);
+#ifdef SIMD_X86
+int64_t sum_elems_avx2(int32_t* elems, int len);
+int32_t min_elems_avx2(int32_t* elems, int len);
+int32_t max_elems_avx2(int32_t* elems, int len);
+int count_nonzero_elems_avx2(int32_t* elems, int len);
+int64_t sum_elems_sse41(int32_t* elems, int len);
+int32_t min_elems_sse41(int32_t* elems, int len);
+int32_t max_elems_sse41(int32_t* elems, int len);
+int count_nonzero_elems_sse41(int32_t* elems, int len);
+void elementwise_elems_avx2(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len);
+void elementwise_elems_sse41(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len);
+double dot_elems_avx2(int32_t* x, int32_t* y, int len);
+double sq_diff_elems_avx2(int32_t* x, int32_t* y, int len);
+double abs_diff_elems_avx2(int32_t* x, int32_t* y, int len);
+double dot_elems_sse41(int32_t* x, int32_t* y, int len);
+double sq_diff_elems_sse41(int32_t* x, int32_t* y, int len);
+double abs_diff_elems_sse41(int32_t* x, int32_t* y, int len);
+#endif
+/*
+    adds the result of op over len elements to the accumulator
+*/
+void reduce_elems(int op, int32_t* elems, int len, struct reduce_acc* p_acc);
+/*
+    reduces the elements [start, end) of an opened vector whose stripes are locked. In mmap and 
+    cache mode the kernels run directly on the stored elements, otherwise the range is read in 
+    chunks of REDUCE_CHUNK_LEN. 1 -> success, 0 -> fail
+*/
+int reduce_vector_range(struct vector_mutex* p_vec_mutex, int op, int start, int end, 
+    struct reduce_acc* p_acc);
+/*
+    computes the reduction requested by the message into the response. 
+    REDUCE_SUCCESS or REDUCE_FAIL, also if min, max or mean is requested over no elements
+*/
+int reduce_vector_file(struct reduce_msg* p_msg, struct reduce_resp_msg* p_resp);
+/*
+    performs logic for sum, min, max, mean and count of nonzero elements. Serves OP_REDUCE 
+    requests. Executed by a request worker
+*/
+void* reduce(void* p_reduce_msg);
+/*
+    number of threads which should share work on len elements
+*/
+int get_num_of_parallel_tasks(int len);
+/*
+    runs function for every task on the compute workers, the calling thread takes tasks too. 
+    Returns when all are done
+*/
+void run_parallel_tasks(void* (*function)(void*), void* tasks, size_t task_size, int num_of_tasks);
+/*
+    index of the next task of the run, -1 if all are claimed. A fully claimed run leaves the 
+    compute queue. mutex_compute must be held
+*/
+int claim_parallel_task(struct parallel_run* p_run);
+/*
+    starts the compute workers, one less than the cpus which may share a request, as the calling
+    thread of a run computes too. Their number is fixed, however many requests run in parallel.
+    1 -> success, 0 -> fail
+*/
+int start_compute_workers();
+/*
+    waits for the compute workers to finish the queued runs and stops them
+*/
+void stop_compute_workers();
+/*
+    body of a compute worker thread. Takes tasks of the queued runs
+*/
+void* compute_worker(void*);
+/*
+    obtains, locks shared and opens the vectors with the given names, a name may repeat. 
+    p_named_vectors[i] is set to the vector of names[i]. 1 -> success, 0 -> fail, then nothing 
+    stays acquired
+*/
+int acquire_vector_group(struct vector_group* p_group, char** names, int num_of_names, 
+    struct vector_mutex** p_named_vectors);
+/*
+    unlocks and releases vectors of the group. 1 -> success, 0 -> fail
+*/
+int release_vector_group(struct vector_group* p_group);
+/*
+    locks stripes of all elements of the group's vectors, exclusive for p_exclusive (may be NULL)
+    and shared for the others. 1 -> success, 0 -> fail
+*/
+int lock_vector_group_elems(struct vector_group* p_group, struct vector_mutex* p_exclusive);
+void unlock_vector_group_elems(struct vector_group* p_group);
+/*
+    computes the elements [start, end) of an element-wise operation, chunk by chunk
+*/
+void* run_elementwise_task(void* p_elementwise_task);
+/*
+    computes the target of the message from its sources, split between parallel tasks. 
+    ELEMENTWISE_SUCCESS or ELEMENTWISE_FAIL
+*/
+int apply_elementwise_to_vectors(struct elementwise_msg* p_msg);
+/*
+    performs logic for add, scale, axpy, min and max of whole vectors. Serves OP_ELEMENTWISE 
+    requests. Executed by a request worker
+*/
+void* elementwise(void* p_elementwise_msg);
+/*
+    len elements of a locked vector starting at pos, in host byte order. Points into the vector 
+    if it is in memory, otherwise they are read into buf. NULL -> fail
+*/
+int32_t* get_vector_chunk(struct vector_mutex* p_vec_mutex, int pos, int len, int32_t* buf);
+/*
+    adds sums of the metric over len elements to the accumulator
+*/
+void accumulate_distance(int metric, int32_t* a, int32_t* b, int len, struct distance_acc* p_acc);
+/*
+    computes the metric between a and the locked vector p_b of the same size. a is the locked 
+    vector p_a, or a_elems if it's not NULL. 1 -> success, 0 -> fail
+*/
+int compare_vectors(int metric, struct vector_mutex* p_a, int32_t* a_elems, 
+    struct vector_mutex* p_b, double* p_value);
+/*
+    computes the metric between the vectors of the message. DISTANCE_SUCCESS or DISTANCE_FAIL
+*/
+int compute_distance(struct distance_msg* p_msg, double* p_value);
+/*
+    performs logic for dot product, L1 and L2 distance and cosine similarity. Serves 
+    OP_DISTANCE requests. Executed by a request worker
+*/
+void* distance(void* p_distance_msg);
+/*
+    inserts the candidate into the list of at most k nearest candidates, sorted nearest first
+*/
+void insert_nearest(int metric, int k, int* indexes, double* values, int* p_len, int index, 
+    double value);
+/*
+    compares the query with the candidates [first, last) of a nearest task and keeps the k 
+    nearest of them
+*/
+void* run_nearest_task(void* p_nearest_task);
+/*
+    finds the candidates nearest to the query, comparing them in parallel tasks. 
+    NEAREST_SUCCESS or NEAREST_FAIL
+*/
+int find_nearest_vectors(struct nearest_msg* p_msg, struct nearest_resp_msg* p_resp);
+/*
+    performs logic for top-k nearest vectors. Serves OP_NEAREST requests. 
+    Executed by a request worker
+*/
+void* nearest(void* p_nearest_msg);
+/*
+    replaces the file path of the message with its canonical form. A file to export may not exist
+    yet, then its folder is resolved. Paths inside VECTORS_FOLDER are rejected, the server would
+    otherwise overwrite its own files. 1 -> success, 0 -> fail
+*/
+int resolve_transfer_path(struct transfer_msg* p_msg);
+/*
+    opens the file or maps the shared memory of the message. 1 -> success, 0 -> fail
+*/
+int open_transfer_stream(struct transfer_stream* p_stream, struct transfer_msg* p_msg);
+int close_transfer_stream(struct transfer_stream* p_stream);
+/*
+    reads until len bytes are read or the file ends. Number of read bytes, -1 -> fail
+*/
+int read_transfer_bytes(int fd, char* buf, size_t len);
+/*
+    writes all len bytes. 1 -> success, 0 -> fail
+*/
+int write_transfer_bytes(int fd, char* buf, size_t len);
+/*
+    parses one line of a text file. 1 -> element, 0 -> empty line, -1 -> invalid
+*/
+int parse_text_elem(char* line, int len, int32_t* p_value);
+/*
+    reads up to max_len next elements of the stream in host byte order. Number of read elements,
+    0 at the end, -1 -> fail
+*/
+int read_transfer_chunk(struct transfer_stream* p_stream, int32_t* values, int max_len);
+/*
+    writes len elements in host byte order to the stream, values may be changed.
+    1 -> success, 0 -> fail
+*/
+int write_transfer_chunk(struct transfer_stream* p_stream, int32_t* values, int len);
+/*
+    reads and validates the whole file of an import into p_elems, allocated. Shared memory isn't 
+    copied, p_elems gets NULL. Number of elements, -1 -> fail
+*/
+int stage_transfer_source(struct transfer_stream* p_stream, int32_t** p_elems);
+/*
+    loads the whole vector from the stream, chunk by chunk. The vector is created if it doesn't 
+    exist, otherwise the source must have as many elements as the vector. The source is staged 
+    first, a bad one never changes the vector. TRANSFER_SUCCESS or TRANSFER_FAIL
+*/
+int import_vector(struct transfer_msg* p_msg, struct transfer_stream* p_stream, int32_t* chunk);
+/*
+    opens the stream once the vector is locked, so a failed export leaves the file untouched, and 
+    stores the whole vector to it, chunk by chunk. TRANSFER_SUCCESS or TRANSFER_FAIL
+*/
+int export_vector(struct transfer_msg* p_msg, struct transfer_stream* p_stream, int32_t* chunk);
+/*
+    imports or exports the vector of the message, p_num_of_elems gets the number of moved 
+    elements. TRANSFER_SUCCESS or TRANSFER_FAIL
+*/
+int transfer_vector(struct transfer_msg* p_msg, int* p_num_of_elems);
+/*
+    performs logic for bulk import and export. Serves OP_TRANSFER requests. 
+    Executed by a request worker
+*/
+void* transfer(void* p_transfer_msg);
+/*
+    performs logic for requests using vector handles. Serves OP_HANDLE requests.
+    Executed by a request worker
+*/
+void* handle_request(void* p_handle_msg);
+/*
+    allocates the tables of clients and vector handles. 1 -> success, 0 -> fail
+*/
+int initialize_handle_tables();
+/*
+    releases vectors of all opened handles, closes response queues of all clients and frees 
+    the tables
+*/
+void destroy_handle_tables();
+/*
+    adds an entry with the given vector or response queue to the table. Returns the id of the 
+    entry, HANDLE_FAIL if the table is full
+*/
+int add_handle_entry(struct handle_table* p_table, struct vector_mutex* p_vec_mutex, 
+    mqd_t q_resp);
+/*
+    returns the entry with the given id locked shared, so it can't be removed while it's used.
+    Must be given back with pthread_rwlock_unlock. NULL if there is no such entry
+*/
+struct handle_entry* lock_handle_entry(struct handle_table* p_table, int id);
+/*
+    removes the entry with the given id and copies it to p_removed, so the caller can release
+    its vector or queue. 1 -> success, 0 -> no such entry
+*/
+int remove_handle_entry(struct handle_table* p_table, int id, struct handle_entry* p_removed);
+/*
+    sends the response to a request using a handle to the queue of a registered client
+*/
+void send_client_response(int client_id, int result, int value, int request_id);
+/*
+    maps a shared memory channel created by a client and starts a thread serving it. Serves 
+    OP_ATTACH requests. Executed by a request worker
+*/
+void* attach(void* p_attach_msg);
+/*
+    body of a thread serving one shared memory channel, until the client detaches or the server
+    stops
+*/
+void* serve_shm_client(void* p_shm_client);
+/*
+    executes one request from a shared memory channel and fills its response. 
+    0 -> the request was a detach, 1 -> otherwise
+*/
+int execute_shm_request(struct shm_request* p_request, struct shm_response* p_response);
+/*
+    tells all threads serving shared memory channels to finish and waits for them
+*/
+void stop_shm_clients();
+/*
+    waits until the tail of a ring differs from head. Spins for a while and then sleeps on the 
+    tail futex. p_stop may be NULL. 1 -> ring not empty, 0 -> *p_stop was set
+*/
+int wait_for_shm_ring(uint32_t* p_tail, uint32_t* p_sleeping, uint32_t head, int* p_stop);
+/* 
+    starts a thread for reading user input. User input is readed in order to detect when
+    server should stop so that all the clean up can be done
+*/
+int start_reading_user_input();
+/*
+    read user input and store it in user_input global variable. Requests shutdown when the exit
+    command is read
+*/
+void *update_user_input(void*);
+/*
+    sets the value at pos of a vector whose mutex is already obtained. SET_SUCCESS or SET_FAIL
+*/
+int set_value_in_vector(struct vector_mutex* p_vec_mutex, int pos, int val);
+/*
+    gets the value at pos of a vector whose mutex is already obtained. 1 -> success, 0 -> fail
+*/
+int get_value_from_vector(struct vector_mutex* p_vec_mutex, int pos, int* p_value);
+/*
+    lists the vector in the manifest, creates its file with 0 values and logs it. Vector lock
+    must be held exclusive. 1 -> success, 0 -> fail
+*/
+int write_new_vector_file(struct vector_mutex* p_vec_mutex, int size, int durability);
+/*
+    create a file for a vector and initialize it with 0 values. The existence is checked again
+    under the exclusive lock, so of concurrent inits of one name only the first creates it.
+    NEW_VECTOR_CREATED, VECTOR_ALREADY_EXISTS or VECTOR_CREATION_ERROR
+*/
+int create_array_file(char* name, int size, int durability);
+/*
+    returns size of a vector which is saved in a vector file. Requeres opening a file
+*/
+int get_vector_size(char* name);
+/*
+    checks the header of an opened vector file and returns the number of elements, -1 if the 
+    file has a wrong format. p_durability (may be NULL) gets the durability from the header
+*/
+int read_vector_file_header(int fd, int* p_durability);
+/*
+    sets file_name to the path of the vector file
+*/
+void get_full_vector_file_name(char* file_name, char* vector_name);
+/*
+    max length of a vector file path, including the string end character
+*/
+int get_full_vector_file_name_max_len();
+/*
+    opens the vector file (if not opened yet) and caches its descriptor and size in the vector
+    mutex struct. Must be called with the vector lock held, shared is enough. 
+    1 -> success, 0 -> fail
+*/
+int open_vector_file(struct vector_mutex* p_vec_mutex);
+/*
+    closes the cached vector file descriptor if it's opened, in cache mode after writing back
+    and freeing the cached elements. 1 -> success, 0 -> fail
+*/
+int close_vector_file(struct vector_mutex* p_vec_mutex);
+/*
+    caches an opened vector file descriptor and its size in the vector mutex struct. In mmap mode
+    also maps the whole file and in cache mode loads it into memory. 1 -> success, 0 -> fail
+*/
+int attach_vector_file(struct vector_mutex* p_vec_mutex, int fd, int size, int durability);
+/*
+    creates locks for element stripes of an attached vector. The number of stripes is limited by
+    config.num_of_lock_stripes and MIN_LOCK_STRIPE_LEN. 1 -> success, 0 -> fail
+*/
+int create_stripe_locks(struct vector_mutex* p_vec_mutex, int size);
+/*
+    destroys and frees stripe locks of the vector
+*/
+void destroy_stripe_locks(struct vector_mutex* p_vec_mutex);
+/*
+    returns the lock of the stripe containing the element at pos. Vector file must be opened
+*/
+pthread_rwlock_t* get_stripe_lock(struct vector_mutex* p_vec_mutex, int pos);
+/*
+    locks stripes of all elements from first_pos to last_pos, in ascending order so that threads
+    locking overlapping ranges can't deadlock. exclusive -> write locks, otherwise read locks.
+    Vector file must be opened. 1 -> success, 0 -> fail
+*/
+int lock_stripes(struct vector_mutex* p_vec_mutex, int first_pos, int last_pos, int exclusive);
+/*
+    unlocks stripes locked with lock_stripes
+*/
+void unlock_stripes(struct vector_mutex* p_vec_mutex, int first_pos, int last_pos);
+/*
+    reads the element at pos from an opened vector file, either with pread or from the mapping.
+    Position must be already validated. 1 -> success, 0 -> fail
+*/
+int read_vector_elem(struct vector_mutex* p_vec_mutex, int pos, int* p_value);
+/*
+    writes the element at pos of an opened vector file, either with pwrite or into the mapping.
+    Position must be already validated. 1 -> success, 0 -> fail
+*/
+int write_vector_elem(struct vector_mutex* p_vec_mutex, int pos, int value);
+/*
+    reads len elements starting at pos from an opened vector file, with one pread or from the 
+    mapping. Range must be already validated. 1 -> success, 0 -> fail
+*/
+int read_vector_range(struct vector_mutex* p_vec_mutex, int pos, int len, int* values);
+/*
+    writes len elements starting at pos of an opened vector file, with one pwrite or into the 
+    mapping. values are converted to the file byte order in place. Range must be already 
+    validated. 1 -> success, 0 -> fail
+*/
+int write_vector_range(struct vector_mutex* p_vec_mutex, int pos, int len, int* values);
+/*
+    flushes the mapping or the dirty pages of the cache of the vector file to disk, does nothing 
+    if the file is neither mapped nor cached. Must be called with the vector lock held. 
+    1 -> success, 0 -> fail
+*/
+int sync_vector_file(struct vector_mutex* p_vec_mutex);
+/*
+    coarse monotonic time in ms, cheap enough to be taken on every access of a cached vector
+*/
+uint64_t get_cache_time_ms();
+/*
+    copies all elements of an opened vector file into memory (cache mode). If they don't fit into
+    config.cache_budget_mb even after evicting idle vectors the vector is not cached and is 
+    accessed through its file like in file mode. 1 -> success, 0 -> fail
+*/
+int load_vector_cache(struct vector_mutex* p_vec_mutex, int fd, int size);
+/*
+    makes room for num_of_bytes in the cache by evicting least recently used vectors which are
+    not in use, and counts them as used. Other vectors are only tried, so it never blocks on 
+    their locks. 1 -> the bytes were reserved, 0 -> there is not enough room
+*/
+int reserve_cache_space(size_t num_of_bytes);
+/*
+    writes dirty pages of the cache back to the vector file and frees the cache. Must be called 
+    with the exclusive vector lock held. 1 -> success, 0 -> fail
+*/
+int drop_vector_cache(struct vector_mutex* p_vec_mutex);
+/*
+    writes dirty pages of the cache back to the vector file, consecutive dirty pages with one 
+    pwrite. Pages set dirty in the meantime stay dirty. 1 -> success, 0 -> fail
+*/
+int flush_vector_cache(struct vector_mutex* p_vec_mutex);
+/*
+    marks the pages of cached elements from pos to pos + len - 1 as changed
+*/
+void mark_pages_dirty(struct vector_mutex* p_vec_mutex, int pos, int len);
+/*
+    starts a thread which periodically flushes all mapped or cached vectors to disk (mmap and 
+    cache mode only). 1 -> success, 0 -> fail
+*/
+int start_msync_thread();
+/*
+    wakes up the msync thread, tells it to finish and waits until it does
+*/
+void stop_msync_thread();
+/*
+    body of the msync thread
+*/
+void* msync_mapped_vectors(void*);
+/*
+    raises the soft limit of open files to the hard limit, because every vector file used since
+    the start of the server keeps its descriptor opened
+*/
+void raise_open_files_limit();
+/*
+    sets wake_time to interval_ms from now, for pthread_cond_timedwait
+*/
+void get_wake_time(struct timespec* p_wake_time, int interval_ms);
+/*
+    replays the write-ahead log into the vector files, checkpoints them, opens a new log and 
+    starts the checkpointer and flusher threads. 1 -> success, 0 -> fail
+*/
+int start_wal();
+/*
+    tells the checkpointer and flusher threads to finish and waits until they do, then writes 
+    records which are still buffered
+*/
+void stop_wal();
+/*
+    closes the log and frees its buffers. Vectors must be already closed, so the log is not 
+    needed anymore
+*/
+void close_wal();
+/*
+    appends redo records of len elements starting at pos, already in the file byte order. 
+    Must be called while the elements are still locked, so the log has changes in the same order
+    as the vector. Records of strict vectors are durable after commit_wal, of periodic ones 
+    after the next background flush, and changes of DURABILITY_NONE vectors are not logged. 
+    len 0 --> the vector was created or destroyed, logged for every vector. Does nothing if there
+    is no log. 1 -> success, 0 -> fail
+*/
+int append_wal_record(struct vector_mutex* p_vec_mutex, int pos, int len, int32_t* elems);
+/*
+    waits until all records appended by the calling thread are durable. Concurrent requests 
+    are committed together, one of the waiting threads writes the records of all of them with 
+    one write and fdatasync. 1 -> success, 0 -> fail
+*/
+int commit_wal();
+/*
+    writes the records appended so far to the log and syncs it. Must be called with mutex_wal 
+    held and no commit in progress, unlocks it while writing
+*/
+void write_wal_buffer();
+/*
+    FNV-1a hash of the data, used as the record checksum
+*/
+uint32_t get_wal_checksum(char* data, size_t len);
+/*
+    replays the log files, first finding where every vector was created or destroyed for the 
+    last time. 1 -> success, 0 -> fail
+*/
+int replay_wal();
+/*
+    replays records of one log file, or only notes creations and destructions of vectors if
+    apply is 0. Stops at the first torn record. p_num_of_records counts records of all files.
+    1 -> success, 0 -> fail
+*/
+int replay_wal_file(char* file_name, int apply, uint64_t* p_num_of_records);
+/*
+    writes elements of one record into the vector. 1 -> success, 0 -> fail
+*/
+int replay_wal_record(struct vector_mutex* p_vec_mutex, int pos, int len, int32_t* elems);
+/*
+    moves the log aside so that a new one is started. Must be called with mutex_wal held and no 
+    commit in progress. 1 -> success, 0 -> fail
+*/
+int rotate_wal();
+/*
+    makes all changes of all vectors durable in their files. 1 -> success, 0 -> fail
+*/
+int checkpoint_vectors();
+/*
+    syncs the vectors folder, so that created, renamed and removed files are durable
+*/
+int sync_vectors_folder();
+/*
+    body of the checkpointer thread. Periodically, or when the log gets too long, moves the log
+    aside, checkpoints the vectors and removes the old log
+*/
+void* checkpoint_periodically(void*);
+/*
+    body of the flusher thread. Writes the log every config.flush_interval_ms, or earlier when
+    config.flush_ops changes of periodic vectors are waiting, so periodic vectors lose at most 
+    that much on a crash
+*/
+void* flush_wal_periodically(void*);
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// global variables
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// general ////////////////////////////////////////////////////////////////////////////////////////
+char user_input[] = INITIAL_COMMAND;  // for main loop finish detection
+struct server_config config = { 
+    DEFAULT_STORAGE_MODE, DEFAULT_MSYNC_INTERVAL_MS, DEFAULT_NUM_OF_WORKERS, 
+    DEFAULT_NUM_OF_LOCK_STRIPES, 
+    { DEFAULT_READ_PRIORITY, DEFAULT_WRITE_PRIORITY, DEFAULT_BULK_PRIORITY }, 
+    DEFAULT_CACHE_BUDGET_MB, DEFAULT_CHECKPOINT_INTERVAL_MS, DEFAULT_DURABILITY, 
+    DEFAULT_FLUSH_INTERVAL_MS, DEFAULT_FLUSH_OPS };
+
+// request workers ////////////////////////////////////////////////////////////////////////////////
+pthread_t* request_workers;         // worker threads, config.num_of_workers of them
+int num_of_started_workers = 0;
+// circular buffer of waiting requests for every priority, together they never hold more than
+// REQUEST_QUEUE_CAPACITY requests
+struct request_task request_queues[NUM_OF_REQUEST_PRIORITIES][REQUEST_QUEUE_CAPACITY];
+int request_queue_heads[NUM_OF_REQUEST_PRIORITIES];     // index of the oldest waiting request
+int request_queue_counts[NUM_OF_REQUEST_PRIORITIES];    // number of waiting requests
+int request_queue_count = 0;        // number of waiting requests of all priorities
+int request_workers_stop = 0;       // set to 1 on shutdown
+pthread_mutex_t mutex_request_queue = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cond_request_available = PTHREAD_COND_INITIALIZER;   // queue is not empty
+pthread_cond_t cond_request_space = PTHREAD_COND_INITIALIZER;       // queue is not full
+struct request_slot* request_slots;         // all preallocated slots
+struct request_slot** free_request_slots;   // stack of slots which are not in use
+int num_of_free_request_slots = 0;          // guarded by mutex_request_queue
+pthread_cond_t cond_request_slot_free = PTHREAD_COND_INITIALIZER;   // free slot available
 
 // user input /////////////////////////////////////////////////////////////////////////////////////
 pthread_t user_input_thread;
 
+// event loop /////////////////////////////////////////////////////////////////////////////////////
+int epoll_fd = -1;      // watches the requests queue and shutdown_fd
+int shutdown_fd = -1;   // eventfd written to when the server should stop
+struct request_type request_types[NUM_OF_OPCODES];
+
 // queue descriptors //////////////////////////////////////////////////////////////////////////////
-mqd_t q_init_vector;    // queue for receiving requests to create a new vector
-mqd_t q_set;            // queue for receiving requests to set a value in a vector
-mqd_t q_get;            // queue for receiving requests to get a value from a vector
-mqd_t q_destroy;        // queue for receiving requests to remove a vector
+mqd_t q_requests;       // queue for receiving all requests
+
+// msync thread ///////////////////////////////////////////////////////////////////////////////////
+pthread_t msync_thread;
+int msync_thread_started = 0;
+int msync_thread_stop = 0;      // set to 1 on shutdown, guarded by mutex_msync
+pthread_mutex_t mutex_msync = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cond_msync = PTHREAD_COND_INITIALIZER;
+
+// simd kernels ///////////////////////////////////////////////////////////////////////////////////
+int simd_level = SIMD_LEVEL_SCALAR;     // selected once by init
+
+// parallel tasks /////////////////////////////////////////////////////////////////////////////////
+int num_of_cpus = 1;    // online cpus, set by init
+pthread_t compute_workers[PARALLEL_MAX_TASKS];
+int num_of_started_compute_workers = 0;
+struct parallel_run* compute_queue_head = NULL;     // runs with unclaimed tasks, oldest first
+struct parallel_run* compute_queue_tail = NULL;
+int compute_workers_stop = 0;       // set to 1 on shutdown
+pthread_mutex_t mutex_compute = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cond_compute_available = PTHREAD_COND_INITIALIZER;  // a run was queued
+pthread_cond_t cond_compute_done = PTHREAD_COND_INITIALIZER;       // a run was finished
+
+// vector handles /////////////////////////////////////////////////////////////////////////////////
+struct handle_table vector_handles;     // opened vectors
+struct handle_table handle_clients;     // registered response queues
+
+// shared memory transport ////////////////////////////////////////////////////////////////////////
+struct shm_client* shm_clients = NULL;     // all attached channels
+pthread_mutex_t mutex_shm_clients = PTHREAD_MUTEX_INITIALIZER;
 
 // storage ////////////////////////////////////////////////////////////////////////////////////////
-struct vector_mutex** vector_mutexes;   // for each vector stores structs which conitain (beside
-                                        // others) mutexes to access vector files
+struct registry_segment registry[REGISTRY_NUM_OF_SEGMENTS];    // for each vector stores structs 
+                                        // which conitain (beside others) mutexes to access 
+                                        // vector files
+
+// manifest ///////////////////////////////////////////////////////////////////////////////////////
+int manifest_fd = -1;
+pthread_mutex_t mutex_manifest = PTHREAD_MUTEX_INITIALIZER;    // guards the variables below
+int manifest_num_of_slots = 0;      // entries in the manifest file, used or free
+int* manifest_free_slots = NULL;    // vec.h vector of free entries, it never shrinks so only
+int manifest_num_of_free_slots = 0; // the first manifest_num_of_free_slots are valid
+
+// write-ahead log ////////////////////////////////////////////////////////////////////////////////
+int wal_opened = 0;                 // set after replay, appends are ignored before
+int wal_fd = -1;
+pthread_mutex_t mutex_wal = PTHREAD_MUTEX_INITIALIZER;     // guards the variables below
+pthread_cond_t cond_wal_committed = PTHREAD_COND_INITIALIZER;
+pthread_cond_t cond_checkpoint = PTHREAD_COND_INITIALIZER;  // checkpoint should start
+char* wal_buffers[2];               // records are appended to one while the other is written
+int wal_active_buffer = 0;
+size_t wal_buffer_len = 0;          // length of records in the active buffer
+uint64_t wal_appended_lsn = 0;      // bytes of all records appended since the start
+uint64_t wal_committed_lsn = 0;     // bytes of all records which are durable
+int wal_commit_in_progress = 0;
+int wal_broken = 0;                 // the log couldn't be written, changes fail from now on
+size_t wal_file_len = 0;            // bytes written to the current log file
+pthread_cond_t cond_wal_flush = PTHREAD_COND_INITIALIZER;      // flush should start
+int wal_unflushed_ops = 0;          // changes of periodic vectors appended since the last write
+pthread_t checkpointer_thread;
+pthread_t flusher_thread;
+int wal_threads_started = 0;
+int wal_threads_stop = 0;
+__thread uint64_t wal_pending_lsn = 0;  // end of the last record appended by the thread, 0 --> 
+                                        // nothing to commit
+
+// vector cache ///////////////////////////////////////////////////////////////////////////////////
+pthread_mutex_t mutex_cache = PTHREAD_MUTEX_INITIALIZER;   // guards the variables below
+struct vector_mutex* cached_vectors = NULL;     // head of the list of cached vectors
+size_t cache_used_bytes = 0;                    // memory used and reserved by cached vectors
+uint64_t last_cache_scan_id = 0;                // id of the last eviction scan
 
 
 
@@ -276,1282 +1729,6681 @@ struct vector_mutex** vector_mutexes;   // for each vector stores structs which
 
 
 
-int main (int argc, char **argv)
+int main (int argc, char **argv)
+{
+    if (!parse_arguments(argc, argv))
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    printf("distributed vector server started\n");
+
+    if (init() != 1)
+    {
+        perror("INIT could not initialize server");
+        exit(1);
+    }
+
+    if (start_reading_user_input() == 0)
+    {
+        run_event_loop();
+    }
+    else
+    {
+        printf("USER INPUT READ could not start reading for user input\n");
+    }
+
+    // clean up
+    stop_request_workers();
+    stop_shm_clients();
+    stop_compute_workers();
+    stop_wal();
+    stop_msync_thread();
+    destroy_handle_tables();
+
+    if (!destroy_vector_mutexes())
+        printf("CLEAN UP could not destroy vector files mutexes\n");
+
+    close_wal();
+    close_manifest();
+
+    if (!close_queues())
+        printf("CLEAN UP could not close queues\n");
+
+    close_event_loop();
+}
+
+
+
+int init()
+{
+    raise_open_files_limit();
+    select_simd_level();
+
+    if ((num_of_cpus = (int) sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+        num_of_cpus = 1;
+
+    if (!initialize_vectors_folder())
+    {
+        printf("INIT could not initialize vectors folder\n");
+        return 0;
+    }
+
+    if (!initialize_vector_mutexes())
+    {
+        printf("INIT coud not initialize vector mutexes\n");
+        return 0;
+    }
+
+    if (!initialize_handle_tables())
+    {
+        printf("INIT could not initialize handle tables\n");
+        return 0;
+    }
+
+    if (!start_wal())
+    {
+        printf("INIT could not start the write-ahead log\n");
+        return 0;
+    }
+
+    if (!initialize_requests_queue())
+    {
+        printf("INIT could not initialize requests queue\n");
+        return 0;
+    }
+
+    if (!initialize_event_loop())
+    {
+        printf("INIT could not initialize event loop\n");
+        return 0;
+    }
+
+    if (!start_compute_workers())
+    {
+        printf("INIT could not start compute workers\n");
+        return 0;
+    }
+
+    if (!start_request_workers())
+    {
+        printf("INIT could not start request workers\n");
+        return 0;
+    }
+
+    if (config.storage_mode != STORAGE_MODE_FILE && config.msync_interval_ms > 0)
+    {
+        if (!start_msync_thread())
+        {
+            printf("INIT could not start msync thread\n");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+
+int parse_arguments(int argc, char** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:m:w:l:p:c:j:d:f:")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                if (strcmp(optarg, "file") == 0)
+                    config.storage_mode = STORAGE_MODE_FILE;
+                else if (strcmp(optarg, "mmap") == 0)
+                    config.storage_mode = STORAGE_MODE_MMAP;
+                else if (strcmp(optarg, "cache") == 0)
+                    config.storage_mode = STORAGE_MODE_CACHE;
+                else
+                    return 0;
+                break;
+            case 'm':
+                config.msync_interval_ms = atoi(optarg);
+                if (config.msync_interval_ms < 0)
+                    return 0;
+                break;
+            case 'w':
+                config.num_of_workers = atoi(optarg);
+                if (config.num_of_workers < 1)
+                    return 0;
+                break;
+            case 'l':
+                config.num_of_lock_stripes = atoi(optarg);
+                if (config.num_of_lock_stripes < 1)
+                    return 0;
+                break;
+            case 'p':
+                if (!parse_request_priorities(optarg))
+                    return 0;
+                break;
+            case 'c':
+                config.cache_budget_mb = atoi(optarg);
+                if (config.cache_budget_mb < 1)
+                    return 0;
+                break;
+            case 'j':
+                config.checkpoint_interval_ms = atoi(optarg);
+                if (config.checkpoint_interval_ms < 1)
+                    return 0;
+                break;
+            case 'd':
+                if (strcmp(optarg, "none") == 0)
+                    config.durability = DURABILITY_NONE;
+                else if (strcmp(optarg, "periodic") == 0)
+                    config.durability = DURABILITY_PERIODIC;
+                else if (strcmp(optarg, "strict") == 0)
+                    config.durability = DURABILITY_STRICT;
+                else
+                    return 0;
+                break;
+            case 'f':
+                if (!parse_flush_policy(optarg))
+                    return 0;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+
+int parse_request_priorities(char* arg)
+{
+    int priorities[NUM_OF_REQUEST_CLASSES];
+    char rest;
+
+    if (sscanf(arg, "%d,%d,%d%c", &priorities[REQUEST_CLASS_READ], 
+        &priorities[REQUEST_CLASS_WRITE], &priorities[REQUEST_CLASS_BULK], &rest) != 3)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < NUM_OF_REQUEST_CLASSES; i++)
+    {
+        if (priorities[i] < 0 || priorities[i] >= NUM_OF_REQUEST_PRIORITIES)
+            return 0;
+
+        config.request_priorities[i] = priorities[i];
+    }
+
+    return 1;
+}
+
+
+
+int parse_flush_policy(char* arg)
+{
+    int interval_ms;
+    int ops;
+    char rest;
+
+    if (sscanf(arg, "%d,%d%c", &interval_ms, &ops, &rest) != 2 || interval_ms < 1 || ops < 1)
+        return 0;
+
+    config.flush_interval_ms = interval_ms;
+    config.flush_ops = ops;
+
+    return 1;
+}
+
+
+
+void print_usage(char* program_name)
+{
+    printf("usage: %s [-s file|mmap|cache] [-m msync_interval_ms] [-w num_of_workers] "
+        "[-l num_of_lock_stripes] [-p read,write,bulk] [-c cache_budget_mb] "
+        "[-j checkpoint_interval_ms] [-d none|periodic|strict] [-f flush_ms,flush_ops]\n", 
+        program_name);
+    printf("  -s  storage mode, file (pread/pwrite, default), mmap (memory-mapped files) or cache "
+        "(recently used vectors in memory, written back in the background)\n");
+    printf("  -m  how often mapped or cached vectors are flushed to disk in ms, 0 --> only on "
+        "eviction and shutdown (default %d)\n", DEFAULT_MSYNC_INTERVAL_MS);
+    printf("  -w  number of request worker threads (default %d)\n", DEFAULT_NUM_OF_WORKERS);
+    printf("  -l  max number of element range locks per vector (default %d)\n", 
+        DEFAULT_NUM_OF_LOCK_STRIPES);
+    printf("  -p  priorities 0..%d of reads, writes and bulk requests waiting for a worker, "
+        "higher is served first (default %d,%d,%d)\n", NUM_OF_REQUEST_PRIORITIES - 1, 
+        DEFAULT_READ_PRIORITY, DEFAULT_WRITE_PRIORITY, DEFAULT_BULK_PRIORITY);
+    printf("  -c  memory budget of cached vectors in MB, least recently used vectors are evicted "
+        "(default %d)\n", DEFAULT_CACHE_BUDGET_MB);
+    printf("  -j  how often vector files of logged vectors are checkpointed in ms, so that the "
+        "write-ahead log can be removed (default %d)\n", DEFAULT_CHECKPOINT_INTERVAL_MS);
+    printf("  -d  durability of vectors created without their own, none (never synced), periodic "
+        "(logged, flushed in the background) or strict (logged before the response, "
+        "default none)\n");
+    printf("  -f  periodic durability writes the log every ms or after this many changes "
+        "(default %d,%d)\n", DEFAULT_FLUSH_INTERVAL_MS, DEFAULT_FLUSH_OPS);
+}
+
+
+
+int initialize_requests_queue()
+{
+    struct mq_attr q_requests_attr;
+
+    q_requests_attr.mq_flags = 0;                               // ingnored for MQ_OPEN
+    q_requests_attr.mq_maxmsg = REQUESTS_QUEUE_MAX_MESSAGES;
+    q_requests_attr.mq_msgsize = REQUEST_MSG_SIZE;
+    q_requests_attr.mq_curmsgs = 0;                             // initially 0 messages
+
+    int open_flags = O_CREAT | O_RDONLY | O_NONBLOCK;
+    mode_t permissions = S_IRUSR | S_IWUSR;                     // allow reads and writes into queue
+
+    if ((q_requests = mq_open(REQUESTS_QUEUE_NAME, open_flags, permissions, 
+        &q_requests_attr)) == -1)
+    {
+        perror("INITIALIZE REQUESTS QUEUE could not open the queue");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+
+int initialize_registry()
+{
+    for (int i = 0; i < REGISTRY_NUM_OF_SEGMENTS; i++)
+    {
+        if (pthread_mutex_init(&registry[i].mutex, NULL) != 0)
+        {
+            perror("INITIALIZE REGISTRY could not initialize segment mutex");
+            return 0;
+        }
+
+        registry[i].slots = (struct vector_mutex**) calloc(REGISTRY_SEGMENT_INITIAL_CAPACITY, 
+            sizeof(struct vector_mutex*));
+        if (registry[i].slots == NULL)
+        {
+            perror("INITIALIZE REGISTRY could not allocate segment");
+            return 0;
+        }
+
+        registry[i].capacity = REGISTRY_SEGMENT_INITIAL_CAPACITY;
+        registry[i].num_of_used_slots = 0;
+    }
+
+    return 1;
+}
+
+
+
+uint32_t hash_vector_name(char* name)
+{
+    uint32_t hash = 2166136261u;
+
+    for (; *name != '\0'; name++)
+    {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+
+struct registry_segment* get_registry_segment(uint32_t name_hash)
+{
+    return &registry[name_hash & (REGISTRY_NUM_OF_SEGMENTS - 1)];
+}
+
+
+
+int get_home_slot(struct registry_segment* p_segment, uint32_t name_hash)
+{
+    // low bits already select the segment, so use the other ones for the slot
+    return (name_hash / REGISTRY_NUM_OF_SEGMENTS) & (p_segment->capacity - 1);
+}
+
+
+
+int grow_registry_segment(struct registry_segment* p_segment)
+{
+    int old_capacity = p_segment->capacity;
+    struct vector_mutex** old_slots = p_segment->slots;
+    struct vector_mutex** new_slots = (struct vector_mutex**) calloc(old_capacity * 2, 
+        sizeof(struct vector_mutex*));
+
+    if (new_slots == NULL)
+    {
+        perror("GROW REGISTRY SEGMENT could not allocate slots");
+        return 0;
+    }
+
+    p_segment->slots = new_slots;
+    p_segment->capacity = old_capacity * 2;
+    p_segment->num_of_used_slots = 0;
+
+    for (int i = 0; i < old_capacity; i++)
+    {
+        if (old_slots[i] != NULL && old_slots[i] != REGISTRY_TOMBSTONE)
+        {
+            int slot = get_home_slot(p_segment, old_slots[i]->name_hash);
+            while (new_slots[slot] != NULL)
+                slot = (slot + 1) & (p_segment->capacity - 1);
+
+            new_slots[slot] = old_slots[i];
+            p_segment->num_of_used_slots++;
+        }
+    }
+
+    free(old_slots);
+
+    return 1;
+}
+
+
+
+int find_registry_slot(struct registry_segment* p_segment, char* vector_name, uint32_t name_hash)
+{
+    int slot = get_home_slot(p_segment, name_hash);
+    struct vector_mutex* p_entry;
+
+    while ((p_entry = p_segment->slots[slot]) != NULL)
+    {
+        if (p_entry != REGISTRY_TOMBSTONE && p_entry->name_hash == name_hash && 
+            !p_entry->to_remove && strcmp(p_entry->vector_name, vector_name) == 0)
+        {
+            return slot;
+        }
+
+        slot = (slot + 1) & (p_segment->capacity - 1);
+    }
+
+    return -1;
+}
+
+
+
+int add_vector_mutex(char* vec_name, int manifest_slot)
+{
+    uint32_t name_hash = hash_vector_name(vec_name);
+    struct registry_segment* p_segment = get_registry_segment(name_hash);
+    int res = 1;
+
+    if (pthread_mutex_lock(&p_segment->mutex) != 0)
+    {
+        perror("ADD VECTOR MUTEX could not lock registry segment");
+        return 0;
+    }
+
+    if (find_registry_slot(p_segment, vec_name, name_hash) == -1) // not registered yet
+    {
+        struct vector_mutex* p_vec_mut = (struct vector_mutex*) malloc(sizeof(struct vector_mutex));
+
+        strcpy(p_vec_mut->vector_name, vec_name);
+        p_vec_mut->name_hash = name_hash;
+        p_vec_mut->num_of_waiting_threads = 0;
+        p_vec_mut->to_remove = 0;
+        p_vec_mut->fd = -1;
+        p_vec_mut->size = -1;
+        p_vec_mut->p_map = NULL;
+        p_vec_mut->map_len = 0;
+        p_vec_mut->p_data = NULL;
+        p_vec_mut->dirty_pages = NULL;
+        p_vec_mut->num_of_pages = 0;
+        p_vec_mut->cache_len = 0;
+        p_vec_mut->last_used_ms = 0;
+        p_vec_mut->cache_scan_id = 0;
+        p_vec_mut->p_cache_prev = NULL;
+        p_vec_mut->p_cache_next = NULL;
+        p_vec_mut->durability = DURABILITY_DEFAULT;
+        p_vec_mut->wal_replay_from = 0;
+        p_vec_mut->manifest_slot = manifest_slot;
+        p_vec_mut->stripe_locks = NULL;
+        p_vec_mut->num_of_stripes = 0;
+        p_vec_mut->stripe_len = 0;
+
+        if (pthread_rwlock_init(&p_vec_mut->lock, NULL) != 0)
+        {
+            printf("ADD VECTOR MUTEX could not initialize vector lock\n");
+            free(p_vec_mut);
+            res = 0;
+        }
+        else if (pthread_mutex_init(&p_vec_mut->open_mutex, NULL) != 0)
+        {
+            printf("ADD VECTOR MUTEX could not initialize vector open mutex\n");
+            pthread_rwlock_destroy(&p_vec_mut->lock);
+            free(p_vec_mut);
+            res = 0;
+        }
+        else if ((p_segment->num_of_used_slots + 1) * 100 > 
+            p_segment->capacity * REGISTRY_MAX_LOAD_PERCENT && !grow_registry_segment(p_segment))
+        {
+            pthread_rwlock_destroy(&p_vec_mut->lock);
+            pthread_mutex_destroy(&p_vec_mut->open_mutex);
+            free(p_vec_mut);
+            res = 0;
+        }
+        else
+        {
+            // reuse the first tombstone on the probe sequence if there is one
+            int slot = get_home_slot(p_segment, name_hash);
+            while (p_segment->slots[slot] != NULL && p_segment->slots[slot] != REGISTRY_TOMBSTONE)
+                slot = (slot + 1) & (p_segment->capacity - 1);
+
+            if (p_segment->slots[slot] == NULL)
+                p_segment->num_of_used_slots++;
+
+            p_segment->slots[slot] = p_vec_mut;
+        }
+    }
+
+    if (pthread_mutex_unlock(&p_segment->mutex) != 0)
+    {
+        perror("ADD VECTOR MUTEX could not unlock registry segment");
+        res = 0;
+    }
+
+    return res;
+}
+
+
+
+int initialize_vector_mutexes()
+{
+    int res = 1;
+
+    DIR* vec_dir;
+    struct dirent* vec_dir_ent;
+
+    if (!initialize_registry())
+        return 0;
+
+    if (load_manifest())
+        return 1;
+
+    printf("INITIALIZE VECTOR MUTEXES no manifest, scanning the vectors folder\n");
+
+    if ((vec_dir = opendir(VECTORS_FOLDER)) != NULL) // open the directory with vectors
+    {
+        int extension_len = strlen(VECTOR_FILE_EXTENSION);      // length of vector file extension
+        char extension[extension_len + 1];                      // vector file extension; + 1 because of \0
+        extension[extension_len] = '\0';
+        char f_name[MAX_VECTOR_NAME_LEN + extension_len + 1];   // vector file name with extension
+        int f_name_len = 0;
+        char f_name_no_extension[MAX_VECTOR_NAME_LEN];          // vector file name with no extension
+        int f_name_no_extension_len = 0;
+
+        while ((vec_dir_ent = readdir(vec_dir)) != NULL) // read all files in the vector directory
+        {
+            strcpy(f_name, vec_dir_ent->d_name);
+            f_name_len = strlen(f_name);
+
+            if (f_name_len > extension_len) // ignore non vector files (too short name)
+            {
+                // obtain file extension
+                strncpy(extension, f_name + f_name_len - extension_len, extension_len);
+                
+                if (strcmp(extension, VECTOR_FILE_EXTENSION) == 0)  // ignore files with wrong extension
+                {
+                    f_name_no_extension_len = f_name_len - extension_len;
+                    // cut just vector name - ignore file extension
+                    strncpy(f_name_no_extension, f_name, f_name_no_extension_len);
+                    // fininsh the f_name_no_extension with string end character
+                    f_name_no_extension[f_name_no_extension_len] = '\0';
+                    
+                    if (!add_vector_mutex(f_name_no_extension, -1))
+                    {
+                        res = 0;
+                        printf("INITIALIZE VECTOR MUTEXES could not add the mutex to the list\n");
+                    }
+                }
+            } // end if (f_name_len > extension_len)
+        } // end while ((vec_dir_ent = readdir(vec_dir)) != NULL)
+
+        if (closedir(vec_dir) != 0)
+        {
+            res = 0;
+            perror("INITIALIZE VECTOR MUTEXES could not close vectors directory");
+        }
+    }
+    else // couldn't open the vector's directory
+    {
+        res = 0;
+        perror("INITIALIZE VECTOR MUTEXES could not open the vectors directory");
+    }
+
+    return res && create_manifest();
+}
+
+
+
+int load_manifest()
+{
+    int fd = open(MANIFEST_FILE_NAME, O_RDWR);
+    if (fd == -1)
+    {
+        if (errno != ENOENT)
+            perror("LOAD MANIFEST could not open the manifest");
+        return 0;
+    }
+
+    struct stat st;
+    char* data = NULL;
+    int res = fstat(fd, &st) == 0 && st.st_size >= (off_t) MANIFEST_HEADER_SIZE && 
+        (data = (char*) malloc(st.st_size)) != NULL;
+
+    size_t done = 0;
+    while (res && done < (size_t) st.st_size) // read may return less than requested
+    {
+        ssize_t n = read(fd, data + done, st.st_size - done);
+
+        if (n <= 0)
+            res = 0;
+        else
+            done += n;
+    }
+
+    struct manifest_header header;
+    if (res)
+    {
+        memcpy(&header, data, MANIFEST_HEADER_SIZE);
+        res = le32toh(header.magic) == MANIFEST_MAGIC && 
+            le32toh(header.version) == MANIFEST_VERSION && 
+            le32toh(header.entry_size) == MANIFEST_ENTRY_SIZE;
+    }
+
+    // a torn entry at the end is ignored, the next new entry is written over it
+    int num_of_slots = res ? (st.st_size - MANIFEST_HEADER_SIZE) / MANIFEST_ENTRY_SIZE : 0;
+    manifest_free_slots = vector_create();
+
+    for (int slot = 0; slot < num_of_slots && res; slot++)
+    {
+        struct manifest_entry entry;
+        memcpy(&entry, data + MANIFEST_HEADER_SIZE + (size_t) slot * MANIFEST_ENTRY_SIZE, 
+            MANIFEST_ENTRY_SIZE);
+        entry.name[MAX_VECTOR_NAME_LEN - 1] = '\0';
+
+        if (entry.name[0] == '\0')
+            add_free_manifest_slot(slot);
+        else if (!add_vector_mutex(entry.name, slot))
+            res = 0;
+    }
+
+    free(data);
+
+    if (res)
+    {
+        manifest_fd = fd;
+        manifest_num_of_slots = num_of_slots;
+    }
+    else
+    {
+        printf("LOAD MANIFEST the manifest is not valid\n");
+        close(fd);
+        close_manifest();
+    }
+
+    return res;
+}
+
+
+
+int create_manifest()
+{
+    struct vector_mutex** vectors = get_all_vector_mutexes();
+    if (vectors == NULL)
+        return 0;
+
+    int num_of_vectors = vector_size(vectors);
+    size_t len = MANIFEST_HEADER_SIZE + (size_t) num_of_vectors * MANIFEST_ENTRY_SIZE;
+    char* data = (char*) calloc(len, 1);
+    int res = data != NULL;
+
+    if (res)
+    {
+        struct manifest_header header;
+        header.magic = htole32(MANIFEST_MAGIC);
+        header.version = htole32(MANIFEST_VERSION);
+        header.entry_size = htole32(MANIFEST_ENTRY_SIZE);
+        header.reserved = 0;
+        memcpy(data, &header, MANIFEST_HEADER_SIZE);
+    }
+
+    for (int i = 0; i < num_of_vectors; i++)
+    {
+        if (res)
+        {
+            char file_name[get_full_vector_file_name_max_len()];
+            get_full_vector_file_name(file_name, vectors[i]->vector_name);
+
+            struct manifest_entry entry;
+            memset(&entry, 0, MANIFEST_ENTRY_SIZE);
+            strcpy(entry.name, vectors[i]->vector_name);
+
+            int durability = DURABILITY_DEFAULT;
+            int size = -1;
+            int fd = open(file_name, O_RDONLY);
+
+            if (fd != -1)
+            {
+                size = read_vector_file_header(fd, &durability);
+                close(fd);
+            }
+
+            entry.size = (int32_t) htole32((uint32_t) size);
+            entry.durability = (int32_t) htole32((uint32_t) durability);
+            memcpy(data + MANIFEST_HEADER_SIZE + (size_t) i * MANIFEST_ENTRY_SIZE, &entry, 
+                MANIFEST_ENTRY_SIZE);
+
+            // the server is still starting, so the exclusive lock is not needed
+            vectors[i]->manifest_slot = i;
+        }
+
+        release_vector_mutex(vectors[i]);
+    }
+
+    vector_free(vectors);
+
+    // written aside and renamed, so a crash leaves either the old or the new manifest
+    int fd = -1;
+    if (res)
+        fd = open(MANIFEST_TMP_FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+
+    if (fd == -1)
+        res = 0;
+    else
+    {
+        size_t done = 0;
+        while (res && done < len)
+        {
+            ssize_t n = write(fd, data + done, len - done);
+
+            if (n <= 0)
+                res = 0;
+            else
+                done += n;
+        }
+
+        if (fsync(fd) != 0 || close(fd) != 0)
+            res = 0;
+
+        if (res && (rename(MANIFEST_TMP_FILE_NAME, MANIFEST_FILE_NAME) != 0 || 
+            !sync_vectors_folder()))
+        {
+            res = 0;
+        }
+    }
+
+    free(data);
+
+    if (res && (manifest_fd = open(MANIFEST_FILE_NAME, O_RDWR)) == -1)
+        res = 0;
+
+    if (res)
+    {
+        manifest_num_of_slots = num_of_vectors;
+        manifest_free_slots = vector_create();
+    }
+    else
+        perror("CREATE MANIFEST could not write the manifest");
+
+    return res;
+}
+
+
+
+int write_manifest_entry(struct vector_mutex* p_vec_mutex, int size, int durability)
+{
+    if (pthread_mutex_lock(&mutex_manifest) != 0)
+    {
+        perror("WRITE MANIFEST ENTRY could not lock the manifest");
+        return 0;
+    }
+
+    if (p_vec_mutex->manifest_slot == -1)
+    {
+        if (manifest_num_of_free_slots > 0)
+            p_vec_mutex->manifest_slot = manifest_free_slots[--manifest_num_of_free_slots];
+        else
+            p_vec_mutex->manifest_slot = manifest_num_of_slots++;
+    }
+
+    pthread_mutex_unlock(&mutex_manifest);
+
+    int synced = (durability == DURABILITY_DEFAULT ? config.durability : durability) != 
+        DURABILITY_NONE;
+
+    return write_manifest_slot(p_vec_mutex->manifest_slot, p_vec_mutex->vector_name, size, 
+        durability, synced);
+}
+
+
+
+int remove_manifest_entry(struct vector_mutex* p_vec_mutex)
+{
+    if (p_vec_mutex->manifest_slot == -1)
+        return 1;
+
+    int slot = p_vec_mutex->manifest_slot;
+    p_vec_mutex->manifest_slot = -1;
+
+    // if it can't be freed, the vector is listed until the manifest is rebuilt
+    if (!write_manifest_slot(slot, "", 0, 0, p_vec_mutex->durability != DURABILITY_NONE))
+        return 0;
+
+    if (pthread_mutex_lock(&mutex_manifest) != 0)
+    {
+        perror("REMOVE MANIFEST ENTRY could not lock the manifest");
+        return 0;
+    }
+
+    add_free_manifest_slot(slot);
+
+    pthread_mutex_unlock(&mutex_manifest);
+
+    return 1;
+}
+
+
+
+int write_manifest_slot(int slot, char* name, int size, int durability, int sync)
+{
+    struct manifest_entry entry;
+    memset(&entry, 0, MANIFEST_ENTRY_SIZE);
+    strncpy(entry.name, name, MAX_VECTOR_NAME_LEN - 1);
+    entry.size = (int32_t) htole32((uint32_t) size);
+    entry.durability = (int32_t) htole32((uint32_t) durability);
+
+    off_t offset = MANIFEST_HEADER_SIZE + (off_t) slot * MANIFEST_ENTRY_SIZE;
+
+    if (pwrite(manifest_fd, &entry, MANIFEST_ENTRY_SIZE, offset) != MANIFEST_ENTRY_SIZE)
+    {
+        perror("WRITE MANIFEST SLOT could not write the entry");
+        return 0;
+    }
+
+    if (sync && fdatasync(manifest_fd) != 0)
+    {
+        perror("WRITE MANIFEST SLOT could not sync the manifest");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+
+void add_free_manifest_slot(int slot)
+{
+    if (manifest_num_of_free_slots < (int) vector_size(manifest_free_slots))
+        manifest_free_slots[manifest_num_of_free_slots] = slot;
+    else
+        vector_add(&manifest_free_slots, slot);
+
+    manifest_num_of_free_slots++;
+}
+
+
+
+void close_manifest()
+{
+    if (manifest_fd != -1 && close(manifest_fd) != 0)
+        perror("CLOSE MANIFEST could not close the manifest");
+
+    manifest_fd = -1;
+
+    if (manifest_free_slots != NULL)
+        vector_free(manifest_free_slots);
+
+    manifest_free_slots = NULL;
+    manifest_num_of_free_slots = 0;
+    manifest_num_of_slots = 0;
+}
+
+
+int initialize_vectors_folder()
+{
+    struct stat st = {0};
+
+    // if the directory doesn't exist
+    if (stat(VECTORS_FOLDER, &st) == -1)
+    {
+        if (mkdir(VECTORS_FOLDER, S_IRWXU) != 0)
+        {
+            perror("INITIALIZE VECTORS FOLDER could not create the vectors folder");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+
+void raise_open_files_limit()
+{
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limit) != 0)
+            perror("RAISE OPEN FILES LIMIT could not set the limit");
+    }
+    else
+        perror("RAISE OPEN FILES LIMIT could not get the limit");
+}
+
+
+
+int destroy_vector_mutexes()
+{
+    int res = 1;
+
+    for (int i = 0; i < REGISTRY_NUM_OF_SEGMENTS; i++)
+    {
+        struct registry_segment* p_segment = &registry[i];
+
+        for (int slot = 0; slot < p_segment->capacity; slot++)
+        {
+            struct vector_mutex* p_vec_mutex = p_segment->slots[slot];
+            if (p_vec_mutex == NULL || p_vec_mutex == REGISTRY_TOMBSTONE)
+                continue;
+
+            if (pthread_rwlock_destroy(&p_vec_mutex->lock) != 0 || 
+                pthread_mutex_destroy(&p_vec_mutex->open_mutex) != 0)
+            {
+                perror("DESTROY VECTOR MUTEXES cannot destroy mutex");
+                printf("the mutex which could not be destroyed is for vector: %s\n", 
+                    p_vec_mutex->vector_name);
+                
+                res = 0;
+            }
+
+            if (!sync_vector_file(p_vec_mutex) || !close_vector_file(p_vec_mutex))
+                res = 0;
+
+            free(p_vec_mutex);
+        }
+
+        free(p_segment->slots);
+        p_segment->slots = NULL;
+
+        if (pthread_mutex_destroy(&p_segment->mutex) != 0)
+        {
+            perror("DESTROY VECTOR MUTEXES cannot destroy registry segment mutex");
+            res = 0;
+        }
+    }
+
+    return res;
+}
+
+
+
+struct vector_mutex* get_vector_mutex(char* vector_name)
+{
+    struct vector_mutex* res = NULL;
+    uint32_t name_hash = hash_vector_name(vector_name);
+    struct registry_segment* p_segment = get_registry_segment(name_hash);
+
+    if (pthread_mutex_lock(&p_segment->mutex) == 0)
+    {
+        struct vector_mutex* p_vec_mutex = NULL;
+        int slot = find_registry_slot(p_segment, vector_name, name_hash);
+
+        if (slot != -1)
+        {
+            p_vec_mutex = p_segment->slots[slot];
+            p_vec_mutex->num_of_waiting_threads++;
+        }
+        
+        if (pthread_mutex_unlock(&p_segment->mutex) == 0)
+            res = p_vec_mutex;
+        else
+        {
+            if (p_vec_mutex != NULL)
+                p_vec_mutex->num_of_waiting_threads--;
+            perror("GET VECTOR MUTEX could not unlock registry segment");
+        }        
+    }
+    else // couldn't lock the segment
+        perror("GET VECTOR MUTEX could not lock registry segment");
+
+    return res;
+}
+
+
+
+struct vector_mutex** get_all_vector_mutexes()
+{
+    struct vector_mutex** vec_mutexes = vector_create();
+
+    if (vec_mutexes == NULL)
+        return NULL;
+
+    for (int i = 0; i < REGISTRY_NUM_OF_SEGMENTS; i++)
+    {
+        struct registry_segment* p_segment = &registry[i];
+
+        if (pthread_mutex_lock(&p_segment->mutex) != 0)
+        {
+            perror("GET ALL VECTOR MUTEXES could not lock registry segment");
+            continue;
+        }
+
+        for (int slot = 0; slot < p_segment->capacity; slot++)
+        {
+            struct vector_mutex* p_vec_mutex = p_segment->slots[slot];
+
+            if (p_vec_mutex != NULL && p_vec_mutex != REGISTRY_TOMBSTONE && 
+                !p_vec_mutex->to_remove)
+            {
+                p_vec_mutex->num_of_waiting_threads++;
+                vector_add(&vec_mutexes, p_vec_mutex);
+            }
+        }
+
+        pthread_mutex_unlock(&p_segment->mutex);
+    }
+
+    return vec_mutexes;
+}
+
+
+
+int unlock_vector_mutex(struct vector_mutex* p_vector_mutex)
+{
+    // the mutex is still counted as used by this thread, so it can't be freed in between
+    if (pthread_rwlock_unlock(&p_vector_mutex->lock) != 0)
+    {
+        perror("UNLOCK VECTOR MUTEX could not unlock the requested mutex");
+        return 0;
+    }
+
+    return release_vector_mutex(p_vector_mutex);
+}
+
+
+
+int release_vector_mutex(struct vector_mutex* p_vector_mutex)
+{
+    int res = 1;
+    int removed = 0;
+    struct registry_segment* p_segment = get_registry_segment(p_vector_mutex->name_hash);
+
+    if (pthread_mutex_lock(&p_segment->mutex) == 0)
+    {
+        p_vector_mutex->num_of_waiting_threads--;
+
+        // if marked to remove and no more threads are waiting remove it and free space
+        if (p_vector_mutex->to_remove == 1 && p_vector_mutex->num_of_waiting_threads == 0)
+        {
+            // the entry lies on the probe sequence of its name, find_registry_slot skips it 
+            // only because it's marked to remove
+            int slot = get_home_slot(p_segment, p_vector_mutex->name_hash);
+            while (p_segment->slots[slot] != p_vector_mutex)
+                slot = (slot + 1) & (p_segment->capacity - 1);
+
+            p_segment->slots[slot] = REGISTRY_TOMBSTONE;
+            removed = 1;
+        }
+
+        if (pthread_mutex_unlock(&p_segment->mutex) != 0)
+        {
+            res = 0;
+            perror("RELEASE VECTOR MUTEX could not unlock registry segment");
+        }
+
+        // nobody can pin the entry anymore, so the file is synced and closed without holding up
+        // the other vectors of the segment. A cached entry may still be locked by an eviction, 
+        // which finds it through the cache list, so it's dropped under the exclusive lock
+        if (removed)
+        {
+            if (pthread_rwlock_wrlock(&p_vector_mutex->lock) == 0)
+            {
+                close_vector_file(p_vector_mutex);
+                pthread_rwlock_unlock(&p_vector_mutex->lock);
+            }
+            else
+            {
+                perror("RELEASE VECTOR MUTEX could not lock the removed mutex");
+            }
+
+            if (pthread_rwlock_destroy(&p_vector_mutex->lock) != 0 ||
+                pthread_mutex_destroy(&p_vector_mutex->open_mutex) != 0)
+                perror("RELEASE VECTOR MUTEX could not destroy the mutex");
+            free(p_vector_mutex);
+        }
+    }
+    else // couldn't lock the segment
+    {
+        res = 0;
+        perror("RELEASE VECTOR MUTEX could not lock registry segment");
+    }
+
+    return res;
+}
+
+
+
+int mark_vector_mutex_to_remove(struct vector_mutex* p_vector_mutex)
+{
+    int res = 1;
+    struct registry_segment* p_segment = get_registry_segment(p_vector_mutex->name_hash);
+    
+    if (pthread_mutex_lock(&p_segment->mutex) == 0)
+    {
+        p_vector_mutex->to_remove = 1;
+
+        if (pthread_mutex_unlock(&p_segment->mutex) != 0)
+        {
+            res = 0;
+            perror("MARK VECTOR MUTEX TO REMOVE could not unlock mutex");
+        }
+    }
+    else
+    {
+        perror("MARK VECTOR MUTEX TO REMOVE could not lock mutex");
+        res = 0;
+    }
+    
+    return res;
+}
+
+
+
+int close_queues()
+{
+    int res = 1;
+
+    if (mq_close(q_requests) != 0)
+    {
+        perror("CLEAN UP could not close requests queue");
+        res = 0;
+    }
+    if (mq_unlink(REQUESTS_QUEUE_NAME) != 0)
+    {
+        perror("CLEAN UP could not unlink requests queue");
+        res = 0;
+    }
+
+    return res;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// event loop
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int initialize_event_loop()
+{
+    struct request_type types[NUM_OF_OPCODES] = {
+        { init_vector, "init vector" },
+        { set, "set value" },
+        { get, "get value" },
+        { destroy, "destroy" },
+        { batch, "batch" },
+        { range, "range" },
+        { attach, "attach" },
+        { handle_request, "handle" },
+        { rmw, "read-modify-write" },
+        { reduce, "reduce" },
+        { elementwise, "element-wise" },
+        { distance, "distance" },
+        { nearest, "nearest" },
+        { transfer, "transfer" }
+    };
+    memcpy(request_types, types, sizeof(types));
+
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        perror("INITIALIZE EVENT LOOP could not create epoll instance");
+        return 0;
+    }
+
+    if ((shutdown_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+    {
+        perror("INITIALIZE EVENT LOOP could not create shutdown eventfd");
+        return 0;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+
+    // on Linux a message queue descriptor is a file descriptor, so it can be watched by epoll
+    event.data.u32 = REQUESTS_EVENT_ID;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, q_requests, &event) != 0)
+    {
+        perror("INITIALIZE EVENT LOOP could not watch requests queue");
+        return 0;
+    }
+
+    event.data.u32 = SHUTDOWN_EVENT_ID;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, shutdown_fd, &event) != 0)
+    {
+        perror("INITIALIZE EVENT LOOP could not watch shutdown eventfd");
+        return 0;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_shutdown_signal;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGINT, &action, NULL) != 0 || sigaction(SIGTERM, &action, NULL) != 0)
+    {
+        perror("INITIALIZE EVENT LOOP could not set signal handlers");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+
+void close_event_loop()
+{
+    if (epoll_fd != -1 && close(epoll_fd) != 0)
+        perror("CLEAN UP could not close epoll instance");
+
+    if (shutdown_fd != -1 && close(shutdown_fd) != 0)
+        perror("CLEAN UP could not close shutdown eventfd");
+}
+
+
+
+void run_event_loop()
+{
+    struct epoll_event events[2];
+    int running = 1;
+
+    // sleep until there are requests. The queue gives messages with the highest priority first
+    while (running)
+    {
+        int num_of_events = epoll_wait(epoll_fd, events, 2, -1);
+
+        if (num_of_events == -1)
+        {
+            if (errno == EINTR) // interrupted by a signal, shutdown_fd tells if it was a stop
+                continue;
+
+            perror("RUN EVENT LOOP could not wait for requests");
+            break;
+        }
+
+        for (int i = 0; i < num_of_events; i++)
+        {
+            if (events[i].data.u32 == SHUTDOWN_EVENT_ID)
+            {
+                running = 0;
+            }
+            else
+            {
+                // at most a full queue per wake up, so a stop is noticed under constant load
+                int num_of_received = 0;
+                while (num_of_received < REQUESTS_QUEUE_MAX_MESSAGES && receive_request())
+                    num_of_received++;
+            }
+        }
+    }
+}
+
+
+
+int receive_request()
+{
+    struct request_slot* p_slot;
+    ssize_t msg_len;
+
+    if ((p_slot = acquire_request_slot()) == NULL)
+        return 0;
+
+    if ((msg_len = mq_receive(q_requests, (char*) &p_slot->msg, REQUEST_MSG_SIZE, NULL)) == -1)
+    {
+        // EAGAIN --> the queue is drained
+        if (errno != EAGAIN)
+            perror("RECEIVE REQUEST could not receive message");
+
+        release_request_slot(p_slot);
+        return 0;
+    }
+
+    int opcode = p_slot->msg.opcode;
+
+    if (msg_len < (ssize_t) REQUEST_MSG_HEADER_SIZE || opcode < 0 || opcode >= NUM_OF_OPCODES)
+    {
+        printf("RECEIVE REQUEST received a request with unknown opcode\n");
+        release_request_slot(p_slot);
+    }
+    else if (dispatch_request(request_types[opcode].handler, p_slot, 
+        get_request_priority(&p_slot->msg)) != REQUEST_DISPATCH_SUCCESS)
+    {
+        printf("DISPATCH REQUEST could not dispatch %s request\n", 
+            request_types[opcode].description);
+        release_request_slot(p_slot);
+    }
+
+    return 1;
+}
+
+
+
+int get_request_priority(struct request_msg* p_msg)
+{
+    int request_class = REQUEST_CLASS_BULK;
+
+    switch (p_msg->opcode)
+    {
+        case OP_GET:
+            request_class = REQUEST_CLASS_READ;
+            break;
+        case OP_SET:
+        case OP_RMW:
+            request_class = REQUEST_CLASS_WRITE;
+            break;
+        case OP_BATCH:
+            if (p_msg->body.batch.op == BATCH_OP_GET)
+                request_class = REQUEST_CLASS_READ;
+            break;
+        case OP_RANGE:
+            if (p_msg->body.range.op == RANGE_OP_GET)
+                request_class = REQUEST_CLASS_READ;
+            break;
+        case OP_HANDLE:
+            if (p_msg->body.handle.op == HANDLE_OP_GET)
+                request_class = REQUEST_CLASS_READ;
+            else if (p_msg->body.handle.op == HANDLE_OP_SET)
+                request_class = REQUEST_CLASS_WRITE;
+            break;
+    }
+
+    return config.request_priorities[request_class];
+}
+
+
+
+void request_shutdown()
+{
+    uint64_t one = 1;
+
+    // nothing sensible can be done if it fails, the only reason would be a counter overflow
+    if (write(shutdown_fd, &one, sizeof(one)) != sizeof(one))
+        return;
+}
+
+
+
+void handle_shutdown_signal(int signal_number)
+{
+    request_shutdown();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// request workers
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int start_request_workers()
+{
+    int num_of_slots = REQUEST_QUEUE_CAPACITY + config.num_of_workers;
+
+    request_workers = (pthread_t*) malloc(config.num_of_workers * sizeof(pthread_t));
+    request_slots = (struct request_slot*) malloc(num_of_slots * sizeof(struct request_slot));
+    free_request_slots = (struct request_slot**) malloc(num_of_slots *
+        sizeof(struct request_slot*));
+
+    if (request_workers == NULL || request_slots == NULL || free_request_slots == NULL)
+    {
+        perror("START REQUEST WORKERS could not allocate workers");
+        return 0;
+    }
+
+    for (int i = 0; i < num_of_slots; i++)
+        free_request_slots[i] = &request_slots[i];
+    num_of_free_request_slots = num_of_slots;
+
+    for (int i = 0; i < config.num_of_workers; i++)
+    {
+        if (pthread_create(&request_workers[i], NULL, request_worker, NULL) != 0)
+        {
+            perror("START REQUEST WORKERS could not create the thread");
+            return 0;
+        }
+
+        num_of_started_workers++;
+    }
+
+    return 1;
+}
+
+
+
+void stop_request_workers()
+{
+    pthread_mutex_lock(&mutex_request_queue);
+    request_workers_stop = 1;
+    pthread_cond_broadcast(&cond_request_available);
+    pthread_mutex_unlock(&mutex_request_queue);
+
+    for (int i = 0; i < num_of_started_workers; i++)
+    {
+        if (pthread_join(request_workers[i], NULL) != 0)
+            perror("STOP REQUEST WORKERS could not join worker");
+    }
+
+    num_of_started_workers = 0;
+    free(request_workers);
+    free(request_slots);
+    free(free_request_slots);
+    request_workers = NULL;
+    request_slots = NULL;
+    free_request_slots = NULL;
+}
+
+
+
+void* request_worker(void* arg)
+{
+    struct request_task task;
+    struct request_slot* p_served_slot = NULL;  // given back to the pool with the next queue access
+
+    while (1)
+    {
+        pthread_mutex_lock(&mutex_request_queue);
+
+        if (p_served_slot != NULL)
+        {
+            free_request_slots[num_of_free_request_slots++] = p_served_slot;
+            pthread_cond_signal(&cond_request_slot_free);
+            p_served_slot = NULL;
+        }
+
+        while (request_queue_count == 0 && !request_workers_stop)
+            pthread_cond_wait(&cond_request_available, &mutex_request_queue);
+
+        if (request_queue_count == 0) // stop requested and nothing left to do
+        {
+            pthread_mutex_unlock(&mutex_request_queue);
+            break;
+        }
+
+        // the oldest request with the highest priority
+        int priority = NUM_OF_REQUEST_PRIORITIES - 1;
+        while (request_queue_counts[priority] == 0)
+            priority--;
+
+        task = request_queues[priority][request_queue_heads[priority]];
+        request_queue_heads[priority] = (request_queue_heads[priority] + 1) % 
+            REQUEST_QUEUE_CAPACITY;
+        request_queue_counts[priority]--;
+        request_queue_count--;
+
+        pthread_cond_signal(&cond_request_space);
+        pthread_mutex_unlock(&mutex_request_queue);
+
+        task.function(&task.p_slot->msg.body);
+        p_served_slot = task.p_slot;
+    }
+
+    return NULL;
+}
+
+
+
+struct request_slot* acquire_request_slot()
+{
+    struct request_slot* p_slot = NULL;
+
+    if (pthread_mutex_lock(&mutex_request_queue) == 0)
+    {
+        while (num_of_free_request_slots == 0)
+            pthread_cond_wait(&cond_request_slot_free, &mutex_request_queue);
+
+        p_slot = free_request_slots[--num_of_free_request_slots];
+
+        pthread_mutex_unlock(&mutex_request_queue);
+    }
+    else // couldn't lock mutex
+        perror("ACQUIRE REQUEST SLOT could not lock the mutex_request_queue");
+
+    return p_slot;
+}
+
+
+
+void release_request_slot(struct request_slot* p_slot)
+{
+    pthread_mutex_lock(&mutex_request_queue);
+    free_request_slots[num_of_free_request_slots++] = p_slot;
+    pthread_cond_signal(&cond_request_slot_free);
+    pthread_mutex_unlock(&mutex_request_queue);
+}
+
+
+
+int dispatch_request(void* (*function)(void*), struct request_slot* p_slot, int priority)
+{
+    if (pthread_mutex_lock(&mutex_request_queue) == 0)
+    {
+        while (request_queue_count == REQUEST_QUEUE_CAPACITY)
+            pthread_cond_wait(&cond_request_space, &mutex_request_queue);
+
+        int tail = (request_queue_heads[priority] + request_queue_counts[priority]) % 
+            REQUEST_QUEUE_CAPACITY;
+        request_queues[priority][tail].function = function;
+        request_queues[priority][tail].p_slot = p_slot;
+        request_queue_counts[priority]++;
+        request_queue_count++;
+
+        pthread_cond_signal(&cond_request_available);
+        pthread_mutex_unlock(&mutex_request_queue);
+    }
+    else // couldn't lock mutex
+    {
+        perror("DISPATCH REQUEST could not lock the mutex_request_queue");
+        return REQUEST_DISPATCH_FAIL;
+    }
+
+    return REQUEST_DISPATCH_SUCCESS;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// init vector functions
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void *init_vector(void* p_init_msg)
+{
+    struct init_msg* p_msg = (struct init_msg*) p_init_msg;
+
+    // create vector
+    int response = create_vector(p_msg->name, p_msg->size, p_msg->durability);
+    
+    // send response
+    send_op_response(p_msg->resp_queue_name, response, 0, p_msg->request_id);
+
+    return NULL;
+}
+
+
+
+void send_op_response(char* resp_queue_name, int result, int value, int request_id)
+{
+    mqd_t q_resp;
+    if ((q_resp = mq_open(resp_queue_name, O_WRONLY)) == -1)
+    {
+        perror("RESPONSE ERROR could not open queue for sending response");
+    }
+    else
+    {
+        struct op_resp_msg response;
+        response.result = result;
+        response.value = value;
+        response.request_id = request_id;
+
+        if (mq_send(q_resp, (char*) &response, OP_RESP_MSG_SIZE, 0) == -1)
+        {
+            perror("RESPONSE ERROR could not send response");
+        }
+
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
+        }
+    }
+}
+
+
+
+int create_vector(char* name, int size, int durability)
+{
+    // an empty vector has no stripes
+    if (size < 1 || durability < DURABILITY_DEFAULT || durability > DURABILITY_STRICT)
+        return VECTOR_CREATION_ERROR;
+
+    int res = NEW_VECTOR_CREATED;
+    int old_vec_size = -1;
+
+    // all vectors are registered, so the file of a new vector is not opened in vain. A file left
+    // without a manifest entry by a crash is not a vector and it's created again
+    struct vector_mutex* p_vec_mutex = get_vector_mutex(name);
+    if (p_vec_mutex != NULL)
+    {
+        old_vec_size = get_vector_size(name);
+        release_vector_mutex(p_vec_mutex);
+    }
+    
+    if (old_vec_size < 0) // vector doesn't exist
+    {
+        if ((res = create_array_file(name, size, durability)) == VECTOR_CREATION_ERROR)
+            printf("CREATE VECTOR could not create vector\n");
+    }
+    else if (old_vec_size == size)
+        res = VECTOR_ALREADY_EXISTS;
+    else
+        res = VECTOR_CREATION_ERROR;
+    
+    return res;
+}
+
+
+
+void get_full_vector_file_name(char* file_name, char* vector_name)
+{
+    strcpy(file_name, VECTORS_FOLDER);
+    strcat(file_name, vector_name);
+    strcat(file_name, VECTOR_FILE_EXTENSION);
+}
+
+
+
+int get_full_vector_file_name_max_len()
+{
+    return MAX_VECTOR_NAME_LEN + strlen(VECTOR_FILE_EXTENSION) + strlen(VECTORS_FOLDER) + 1;
+}
+
+
+
+int read_vector_file_header(int fd, int* p_durability)
+{
+    struct vector_file_header header;
+
+    if (pread(fd, &header, VECTOR_FILE_HEADER_SIZE, 0) != VECTOR_FILE_HEADER_SIZE)
+        return -1;
+
+    if (le32toh(header.magic) != VECTOR_FILE_MAGIC ||
+        le32toh(header.version) != VECTOR_FILE_VERSION ||
+        le16toh(header.elem_size) != VECTOR_ELEM_SIZE || 
+        le16toh(header.durability) > DURABILITY_STRICT)
+    {
+        printf("READ VECTOR FILE HEADER vector file wrong format\n");
+        return -1;
+    }
+
+    if (p_durability != NULL)
+        *p_durability = le16toh(header.durability);
+
+    return (int32_t) le32toh((uint32_t) header.size);
+}
+
+
+
+int get_vector_size(char* name)
+{
+    int len = -1;
+
+    char file_name[get_full_vector_file_name_max_len()];
+    get_full_vector_file_name(file_name, name);
+
+    int fd = open(file_name, O_RDONLY);
+
+    if (fd != -1)
+    {
+        len = read_vector_file_header(fd, NULL);
+
+        if (close(fd) != 0)
+        {
+            len = -1;
+        }
+    }
+    
+    return len;
+}
+
+
+
+int open_vector_file(struct vector_mutex* p_vec_mutex)
+{
+    if (config.storage_mode == STORAGE_MODE_CACHE)
+        __atomic_store_n(&p_vec_mutex->last_used_ms, get_cache_time_ms(), __ATOMIC_RELAXED);
+
+    // fd is published last, so if it's set then size, mapping and cache are set too
+    if (__atomic_load_n(&p_vec_mutex->fd, __ATOMIC_ACQUIRE) != -1) // already opened
+        return 1;
+
+    int res = 1;
+
+    // many threads holding the shared lock may try to open the file at once
+    if (pthread_mutex_lock(&p_vec_mutex->open_mutex) != 0)
+    {
+        perror("OPEN VECTOR FILE could not lock open mutex");
+        return 0;
+    }
+
+    if (p_vec_mutex->fd == -1) // not opened by other thread in the meantime
+    {
+        char file_name[get_full_vector_file_name_max_len()];
+        get_full_vector_file_name(file_name, p_vec_mutex->vector_name);
+
+        int fd = open(file_name, O_RDWR);
+        int size = -1;
+        int durability = DURABILITY_DEFAULT;
+
+        if (fd == -1)
+        {
+            res = 0;
+            perror("OPEN VECTOR FILE could not open the vector file");
+        }
+        // an empty vector may be left by an older server, it can't be attached
+        else if ((size = read_vector_file_header(fd, &durability)) < 1)
+        {
+            res = 0;
+            printf("OPEN VECTOR FILE could not read the header of %s\n", p_vec_mutex->vector_name);
+            close(fd);
+        }
+        else if (!attach_vector_file(p_vec_mutex, fd, size, durability))
+        {
+            res = 0;
+            close(fd);
+        }
+    }
+
+    pthread_mutex_unlock(&p_vec_mutex->open_mutex);
+
+    return res;
+}
+
+
+
+int attach_vector_file(struct vector_mutex* p_vec_mutex, int fd, int size, int durability)
+{
+    if (config.storage_mode == STORAGE_MODE_MMAP)
+    {
+        size_t map_len = VECTOR_FILE_HEADER_SIZE + (size_t) size * VECTOR_ELEM_SIZE;
+
+        // a store to a hole of the mapping which finds the disk full raises SIGBUS, so the blocks
+        // are allocated up front, where no space is an ordinary error
+        int fallocate_res = posix_fallocate(fd, 0, (off_t) map_len);
+        if (fallocate_res != 0)
+        {
+            errno = fallocate_res;
+            perror("ATTACH VECTOR FILE could not allocate the vector file");
+            return 0;
+        }
+
+        void* p_map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (p_map == MAP_FAILED)
+        {
+            perror("ATTACH VECTOR FILE could not map the vector file");
+            return 0;
+        }
+
+        p_vec_mutex->p_map = p_map;
+        p_vec_mutex->map_len = map_len;
+        p_vec_mutex->p_data = (int32_t*) ((char*) p_map + VECTOR_FILE_HEADER_SIZE);
+    }
+    else if (config.storage_mode == STORAGE_MODE_CACHE && !load_vector_cache(p_vec_mutex, fd, size))
+    {
+        return 0;
+    }
+
+    if (!create_stripe_locks(p_vec_mutex, size))
+    {
+        if (p_vec_mutex->p_map != NULL)
+        {
+            munmap(p_vec_mutex->p_map, p_vec_mutex->map_len);
+            p_vec_mutex->p_map = NULL;
+            p_vec_mutex->map_len = 0;
+            p_vec_mutex->p_data = NULL;
+        }
+
+        // nothing is dirty yet
+        if (p_vec_mutex->dirty_pages != NULL)
+            drop_vector_cache(p_vec_mutex);
+
+        return 0;
+    }
+
+    p_vec_mutex->size = size;
+    p_vec_mutex->durability = durability == DURABILITY_DEFAULT ? config.durability : durability;
+    __atomic_store_n(&p_vec_mutex->fd, fd, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+
+
+int close_vector_file(struct vector_mutex* p_vec_mutex)
+{
+    int res = 1;
+
+    if (p_vec_mutex->p_map != NULL)
+    {
+        if (munmap(p_vec_mutex->p_map, p_vec_mutex->map_len) != 0)
+        {
+            res = 0;
+            perror("CLOSE VECTOR FILE could not unmap the vector file");
+        }
+
+        p_vec_mutex->p_map = NULL;
+        p_vec_mutex->map_len = 0;
+        p_vec_mutex->p_data = NULL;
+    }
+
+    // dirty pages are written while the descriptor is still opened
+    if (p_vec_mutex->dirty_pages != NULL && !drop_vector_cache(p_vec_mutex))
+        res = 0;
+
+    if (p_vec_mutex->fd != -1)
+    {
+        // the log may be checkpointed without this vector once it's closed
+        if (p_vec_mutex->durability != DURABILITY_NONE && fsync(p_vec_mutex->fd) != 0)
+        {
+            res = 0;
+            perror("CLOSE VECTOR FILE could not sync the vector file");
+        }
+
+        if (close(p_vec_mutex->fd) != 0)
+        {
+            res = 0;
+            perror("CLOSE VECTOR FILE could not close the vector file");
+        }
+
+        p_vec_mutex->fd = -1;
+        p_vec_mutex->size = -1;
+    }
+
+    destroy_stripe_locks(p_vec_mutex);
+
+    return res;
+}
+
+
+
+int create_stripe_locks(struct vector_mutex* p_vec_mutex, int size)
+{
+    int num_of_stripes = (size + MIN_LOCK_STRIPE_LEN - 1) / MIN_LOCK_STRIPE_LEN;
+    if (num_of_stripes > config.num_of_lock_stripes)
+        num_of_stripes = config.num_of_lock_stripes;
+
+    pthread_rwlock_t* stripe_locks = (pthread_rwlock_t*) malloc(
+        num_of_stripes * sizeof(pthread_rwlock_t));
+    if (stripe_locks == NULL)
+    {
+        perror("CREATE STRIPE LOCKS could not allocate locks");
+        return 0;
+    }
+
+    for (int i = 0; i < num_of_stripes; i++)
+    {
+        if (pthread_rwlock_init(&stripe_locks[i], NULL) != 0)
+        {
+            perror("CREATE STRIPE LOCKS could not initialize lock");
+
+            for (int j = 0; j < i; j++)
+                pthread_rwlock_destroy(&stripe_locks[j]);
+            free(stripe_locks);
+
+            return 0;
+        }
+    }
+
+    p_vec_mutex->stripe_locks = stripe_locks;
+    p_vec_mutex->num_of_stripes = num_of_stripes;
+    p_vec_mutex->stripe_len = (size + num_of_stripes - 1) / num_of_stripes;
+
+    return 1;
+}
+
+
+
+void destroy_stripe_locks(struct vector_mutex* p_vec_mutex)
+{
+    for (int i = 0; i < p_vec_mutex->num_of_stripes; i++)
+    {
+        if (pthread_rwlock_destroy(&p_vec_mutex->stripe_locks[i]) != 0)
+            perror("DESTROY STRIPE LOCKS could not destroy lock");
+    }
+
+    free(p_vec_mutex->stripe_locks);
+    p_vec_mutex->stripe_locks = NULL;
+    p_vec_mutex->num_of_stripes = 0;
+    p_vec_mutex->stripe_len = 0;
+}
+
+
+
+pthread_rwlock_t* get_stripe_lock(struct vector_mutex* p_vec_mutex, int pos)
+{
+    return &p_vec_mutex->stripe_locks[pos / p_vec_mutex->stripe_len];
+}
+
+
+
+int lock_stripes(struct vector_mutex* p_vec_mutex, int first_pos, int last_pos, int exclusive)
+{
+    int first_stripe = first_pos / p_vec_mutex->stripe_len;
+    int last_stripe = last_pos / p_vec_mutex->stripe_len;
+
+    for (int i = first_stripe; i <= last_stripe; i++)
+    {
+        pthread_rwlock_t* p_stripe_lock = &p_vec_mutex->stripe_locks[i];
+        int lock_res = exclusive ? pthread_rwlock_wrlock(p_stripe_lock) : 
+            pthread_rwlock_rdlock(p_stripe_lock);
+
+        if (lock_res != 0)
+        {
+            perror("LOCK STRIPES could not lock the stripe");
+
+            for (int j = first_stripe; j < i; j++)
+                pthread_rwlock_unlock(&p_vec_mutex->stripe_locks[j]);
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+
+void unlock_stripes(struct vector_mutex* p_vec_mutex, int first_pos, int last_pos)
+{
+    int first_stripe = first_pos / p_vec_mutex->stripe_len;
+    int last_stripe = last_pos / p_vec_mutex->stripe_len;
+
+    for (int i = first_stripe; i <= last_stripe; i++)
+        pthread_rwlock_unlock(&p_vec_mutex->stripe_locks[i]);
+}
+
+
+
+off_t get_elem_offset(int pos)
+{
+    return (off_t) VECTOR_FILE_HEADER_SIZE + (off_t) pos * VECTOR_ELEM_SIZE;
+}
+
+
+
+int read_vector_elem(struct vector_mutex* p_vec_mutex, int pos, int* p_value)
+{
+    int32_t elem;
+
+    if (p_vec_mutex->p_data != NULL) // mapped or cached, plain load
+        elem = p_vec_mutex->p_data[pos];
+    else if (pread(p_vec_mutex->fd, &elem, VECTOR_ELEM_SIZE, get_elem_offset(pos)) != 
+        VECTOR_ELEM_SIZE)
+    {
+        perror("READ VECTOR ELEM could not read the value");
+        return 0;
+    }
+
+    *p_value = (int32_t) le32toh((uint32_t) elem);
+
+    return 1;
+}
+
+
+
+int write_vector_elem(struct vector_mutex* p_vec_mutex, int pos, int value)
+{
+    int32_t elem = (int32_t) htole32((uint32_t) value);
+
+    if (p_vec_mutex->p_data != NULL) // mapped or cached, plain store
+    {
+        p_vec_mutex->p_data[pos] = elem;
+
+        if (p_vec_mutex->dirty_pages != NULL)
+            mark_pages_dirty(p_vec_mutex, pos, 1);
+    }
+    else if (pwrite(p_vec_mutex->fd, &elem, VECTOR_ELEM_SIZE, get_elem_offset(pos)) != 
+        VECTOR_ELEM_SIZE)
+    {
+        perror("WRITE VECTOR ELEM could not write the value");
+        return 0;
+    }
+
+    return append_wal_record(p_vec_mutex, pos, 1, &elem);
+}
+
+
+
+int read_vector_range(struct vector_mutex* p_vec_mutex, int pos, int len, int* values)
+{
+    if (p_vec_mutex->p_data != NULL) // mapped or cached, plain loads
+    {
+        for (int i = 0; i < len; i++)
+            values[i] = (int32_t) le32toh((uint32_t) p_vec_mutex->p_data[pos + i]);
+
+        return 1;
+    }
+
+    size_t num_of_bytes = (size_t) len * VECTOR_ELEM_SIZE;
+    size_t done = 0;
+
+    while (done < num_of_bytes) // pread may return less than requested for big ranges
+    {
+        ssize_t n = pread(p_vec_mutex->fd, (char*) values + done, num_of_bytes - done, 
+            get_elem_offset(pos) + (off_t) done);
+
+        if (n <= 0)
+        {
+            perror("READ VECTOR RANGE could not read the values");
+            return 0;
+        }
+
+        done += n;
+    }
+
+    for (int i = 0; i < len; i++)
+        values[i] = (int32_t) le32toh((uint32_t) values[i]);
+
+    return 1;
+}
+
+
+
+int write_vector_range(struct vector_mutex* p_vec_mutex, int pos, int len, int* values)
+{
+    for (int i = 0; i < len; i++)
+        values[i] = (int32_t) htole32((uint32_t) values[i]);
+
+    if (p_vec_mutex->p_data != NULL) // mapped or cached, plain stores
+    {
+        memcpy(&p_vec_mutex->p_data[pos], values, (size_t) len * VECTOR_ELEM_SIZE);
+
+        if (p_vec_mutex->dirty_pages != NULL)
+            mark_pages_dirty(p_vec_mutex, pos, len);
+
+        return append_wal_record(p_vec_mutex, pos, len, values);
+    }
+
+    size_t num_of_bytes = (size_t) len * VECTOR_ELEM_SIZE;
+    size_t done = 0;
+
+    while (done < num_of_bytes)
+    {
+        ssize_t n = pwrite(p_vec_mutex->fd, (char*) values + done, num_of_bytes - done, 
+            get_elem_offset(pos) + (off_t) done);
+
+        if (n <= 0)
+        {
+            perror("WRITE VECTOR RANGE could not write the values");
+            return 0;
+        }
+
+        done += n;
+    }
+
+    return append_wal_record(p_vec_mutex, pos, len, values);
+}
+
+
+
+int sync_vector_file(struct vector_mutex* p_vec_mutex)
+{
+    // not opened or still being opened by a thread holding the shared lock
+    if (__atomic_load_n(&p_vec_mutex->fd, __ATOMIC_ACQUIRE) == -1)
+        return 1;
+
+    if (p_vec_mutex->p_map != NULL && 
+        msync(p_vec_mutex->p_map, p_vec_mutex->map_len, MS_SYNC) != 0)
+    {
+        perror("SYNC VECTOR FILE could not sync the mapping");
+        return 0;
+    }
+
+    if (p_vec_mutex->dirty_pages != NULL && !flush_vector_cache(p_vec_mutex))
+        return 0;
+
+    return 1;
+}
+
+
+
+uint64_t get_cache_time_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+
+int load_vector_cache(struct vector_mutex* p_vec_mutex, int fd, int size)
+{
+    size_t num_of_bytes = (size_t) size * VECTOR_ELEM_SIZE;
+    int num_of_pages = (size + CACHE_PAGE_LEN - 1) / CACHE_PAGE_LEN;
+
+    if (!reserve_cache_space(num_of_bytes))
+        return 1;   // served from the file
+
+    int32_t* p_data = (int32_t*) malloc(num_of_bytes);
+    uint8_t* dirty_pages = (uint8_t*) calloc(num_of_pages, 1);
+
+    if (p_data == NULL || dirty_pages == NULL)
+    {
+        perror("LOAD VECTOR CACHE could not allocate the cache, the file is used instead");
+        free(p_data);
+        free(dirty_pages);
+
+        pthread_mutex_lock(&mutex_cache);
+        cache_used_bytes -= num_of_bytes;
+        pthread_mutex_unlock(&mutex_cache);
+
+        return 1;
+    }
+
+    // elements are kept in the file byte order, like in a mapping
+    size_t done = 0;
+
+    while (done < num_of_bytes)
+    {
+        ssize_t n = pread(fd, (char*) p_data + done, num_of_bytes - done, 
+            get_elem_offset(0) + (off_t) done);
+
+        if (n <= 0)
+        {
+            perror("LOAD VECTOR CACHE could not read the vector file");
+            free(p_data);
+            free(dirty_pages);
+
+            pthread_mutex_lock(&mutex_cache);
+            cache_used_bytes -= num_of_bytes;
+            pthread_mutex_unlock(&mutex_cache);
+
+            return 0;
+        }
+
+        done += n;
+    }
+
+    p_vec_mutex->p_data = p_data;
+    p_vec_mutex->dirty_pages = dirty_pages;
+    p_vec_mutex->num_of_pages = num_of_pages;
+    p_vec_mutex->cache_len = num_of_bytes;
+    p_vec_mutex->last_used_ms = get_cache_time_ms();
+
+    pthread_mutex_lock(&mutex_cache);
+    p_vec_mutex->p_cache_prev = NULL;
+    p_vec_mutex->p_cache_next = cached_vectors;
+    if (cached_vectors != NULL)
+        cached_vectors->p_cache_prev = p_vec_mutex;
+    cached_vectors = p_vec_mutex;
+    pthread_mutex_unlock(&mutex_cache);
+
+    return 1;
+}
+
+
+
+int reserve_cache_space(size_t num_of_bytes)
+{
+    size_t budget = (size_t) config.cache_budget_mb * 1024 * 1024;
+    int res = 1;
+
+    if (num_of_bytes > budget)
+        return 0;
+
+    pthread_mutex_lock(&mutex_cache);
+    uint64_t scan_id = ++last_cache_scan_id;
+
+    while (res && cache_used_bytes + num_of_bytes > budget)
+    {
+        // the least recently used vector which wasn't tried in this scan yet
+        struct vector_mutex* p_victim = NULL;
+        for (struct vector_mutex* p_vec_mutex = cached_vectors; p_vec_mutex != NULL; 
+            p_vec_mutex = p_vec_mutex->p_cache_next)
+        {
+            uint64_t last_used_ms = __atomic_load_n(&p_vec_mutex->last_used_ms, __ATOMIC_RELAXED);
+
+            if (p_vec_mutex->cache_scan_id != scan_id && (p_victim == NULL || 
+                last_used_ms < p_victim->last_used_ms))
+            {
+                p_victim = p_vec_mutex;
+            }
+        }
+
+        if (p_victim == NULL) // all other vectors are in use
+        {
+            res = 0;
+        }
+        else
+        {
+            p_victim->cache_scan_id = scan_id;
+
+            // cached vectors are not freed without being dropped from the list under the 
+            // exclusive lock, so the victim stays valid while it's locked
+            if (pthread_rwlock_trywrlock(&p_victim->lock) == 0)
+            {
+                pthread_mutex_unlock(&mutex_cache);
+
+                // the next access opens the file and loads the vector again
+                close_vector_file(p_victim);
+                pthread_rwlock_unlock(&p_victim->lock);
+
+                pthread_mutex_lock(&mutex_cache);
+            }
+        }
+    }
+
+    if (res)
+        cache_used_bytes += num_of_bytes;
+
+    pthread_mutex_unlock(&mutex_cache);
+
+    return res;
+}
+
+
+
+int drop_vector_cache(struct vector_mutex* p_vec_mutex)
+{
+    int res = flush_vector_cache(p_vec_mutex);
+
+    pthread_mutex_lock(&mutex_cache);
+
+    if (p_vec_mutex->p_cache_prev != NULL)
+        p_vec_mutex->p_cache_prev->p_cache_next = p_vec_mutex->p_cache_next;
+    else
+        cached_vectors = p_vec_mutex->p_cache_next;
+
+    if (p_vec_mutex->p_cache_next != NULL)
+        p_vec_mutex->p_cache_next->p_cache_prev = p_vec_mutex->p_cache_prev;
+
+    cache_used_bytes -= p_vec_mutex->cache_len;
+
+    pthread_mutex_unlock(&mutex_cache);
+
+    free(p_vec_mutex->p_data);
+    free(p_vec_mutex->dirty_pages);
+    p_vec_mutex->p_data = NULL;
+    p_vec_mutex->dirty_pages = NULL;
+    p_vec_mutex->num_of_pages = 0;
+    p_vec_mutex->cache_len = 0;
+    p_vec_mutex->p_cache_prev = NULL;
+    p_vec_mutex->p_cache_next = NULL;
+
+    return res;
+}
+
+
+
+int flush_vector_cache(struct vector_mutex* p_vec_mutex)
+{
+    int res = 1;
+    int page = 0;
+
+    while (page < p_vec_mutex->num_of_pages)
+    {
+        // a flag is cleared before its page is written, so a set done meanwhile marks it again
+        if (!__atomic_exchange_n(&p_vec_mutex->dirty_pages[page], 0, __ATOMIC_ACQ_REL))
+        {
+            page++;
+            continue;
+        }
+
+        int first_page = page++;
+        while (page < p_vec_mutex->num_of_pages && 
+            __atomic_exchange_n(&p_vec_mutex->dirty_pages[page], 0, __ATOMIC_ACQ_REL))
+        {
+            page++;
+        }
+
+        int first_pos = first_page * CACHE_PAGE_LEN;
+        int last_pos = page * CACHE_PAGE_LEN < p_vec_mutex->size ? 
+            page * CACHE_PAGE_LEN : p_vec_mutex->size;
+        size_t num_of_bytes = (size_t) (last_pos - first_pos) * VECTOR_ELEM_SIZE;
+        size_t done = 0;
+
+        while (done < num_of_bytes)
+        {
+            ssize_t n = pwrite(p_vec_mutex->fd, (char*) &p_vec_mutex->p_data[first_pos] + done, 
+                num_of_bytes - done, get_elem_offset(first_pos) + (off_t) done);
+
+            if (n <= 0)
+            {
+                perror("FLUSH VECTOR CACHE could not write the dirty pages");
+                break;
+            }
+
+            done += n;
+        }
+
+        if (done < num_of_bytes) // keep the pages dirty, so they are written next time
+        {
+            mark_pages_dirty(p_vec_mutex, first_pos, last_pos - first_pos);
+            res = 0;
+        }
+    }
+
+    return res;
+}
+
+
+
+void mark_pages_dirty(struct vector_mutex* p_vec_mutex, int pos, int len)
+{
+    int last_page = (pos + len - 1) / CACHE_PAGE_LEN;
+
+    for (int page = pos / CACHE_PAGE_LEN; page <= last_page; page++)
+        __atomic_store_n(&p_vec_mutex->dirty_pages[page], 1, __ATOMIC_RELEASE);
+}
+
+
+
+int start_msync_thread()
+{
+    if (pthread_create(&msync_thread, NULL, msync_mapped_vectors, NULL) != 0)
+    {
+        perror("START MSYNC THREAD could not create the thread");
+        return 0;
+    }
+
+    msync_thread_started = 1;
+
+    return 1;
+}
+
+
+
+void stop_msync_thread()
+{
+    if (!msync_thread_started)
+        return;
+
+    pthread_mutex_lock(&mutex_msync);
+    msync_thread_stop = 1;
+    pthread_cond_signal(&cond_msync);
+    pthread_mutex_unlock(&mutex_msync);
+
+    if (pthread_join(msync_thread, NULL) != 0)
+        perror("STOP MSYNC THREAD could not join the thread");
+
+    msync_thread_started = 0;
+}
+
+
+
+void* msync_mapped_vectors(void* arg)
+{
+    pthread_mutex_lock(&mutex_msync);
+
+    while (!msync_thread_stop)
+    {
+        struct timespec wake_time;
+        get_wake_time(&wake_time, config.msync_interval_ms);
+
+        int wait_res = 0;
+        while (!msync_thread_stop && wait_res != ETIMEDOUT)
+            wait_res = pthread_cond_timedwait(&cond_msync, &mutex_msync, &wake_time);
+
+        if (msync_thread_stop)
+            break;
+
+        pthread_mutex_unlock(&mutex_msync);
+
+        // take every vector so that it can't be freed while it's synced
+        struct vector_mutex** to_sync = get_all_vector_mutexes();
+        int num_to_sync = to_sync != NULL ? vector_size(to_sync) : 0;
+
+        for (int i = 0; i < num_to_sync; i++)
+        {
+            if (pthread_rwlock_rdlock(&to_sync[i]->lock) == 0)
+            {
+                sync_vector_file(to_sync[i]);
+                unlock_vector_mutex(to_sync[i]);
+            }
+            else
+            {
+                perror("MSYNC MAPPED VECTORS could not lock vector mutex");
+                release_vector_mutex(to_sync[i]);
+            }
+        }
+
+        if (to_sync != NULL)
+            vector_free(to_sync);
+
+        pthread_mutex_lock(&mutex_msync);
+    }
+
+    pthread_mutex_unlock(&mutex_msync);
+
+    return NULL;
+}
+
+
+
+int initialize_array_file(int fd, int size, int durability)
+{
+    int res = 1;
+
+    struct vector_file_header header;
+    header.magic = htole32(VECTOR_FILE_MAGIC);
+    header.version = htole32(VECTOR_FILE_VERSION);
+    header.elem_size = htole16(VECTOR_ELEM_SIZE);
+    header.durability = htole16(durability);
+    header.size = (int32_t) htole32((uint32_t) size);
+
+    if (pwrite(fd, &header, VECTOR_FILE_HEADER_SIZE, 0) == VECTOR_FILE_HEADER_SIZE)
+    {
+        // the elements are left as a hole, which reads as zeros, so creating a vector costs the
+        // same whatever its size. Blocks are allocated by the first write to them, in mmap mode 
+        // by attach_vector_file
+        if (ftruncate(fd, get_elem_offset(size)) != 0)
+        {
+            res = 0;
+            perror("INITIALIZE ARRAY FILE could not extend the vector file");
+        }
+    }
+    else
+    {
+        res = 0;
+    }
+
+    return res;
+}
+
+
+
+int write_new_vector_file(struct vector_mutex* p_vec_mutex, int size, int durability)
+{
+    int res = 1;
+
+    // drop the descriptor of a file which doesn't exist anymore
+    close_vector_file(p_vec_mutex);
+
+    char file_name[get_full_vector_file_name_max_len()];
+    get_full_vector_file_name(file_name, p_vec_mutex->vector_name);
+
+    int fd = -1;
+
+    // listed before the file is created, so that a crash can't leave a vector file 
+    // which is not in the manifest
+    if (!write_manifest_entry(p_vec_mutex, size, durability))
+    {
+        res = 0;
+        printf("WRITE NEW VECTOR FILE could not add the vector to the manifest\n");
+    }
+    else if ((fd = open(file_name, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1)
+    {
+        res = 0;
+        perror("WRITE NEW VECTOR FILE could not create the vector file");
+    }
+    // on success file descriptor (and mapping) is cached in the vector mutex
+    else if (!initialize_array_file(fd, size, durability) || 
+        !attach_vector_file(p_vec_mutex, fd, size, durability))
+    {
+        res = 0;
+        printf("WRITE NEW VECTOR FILE could not initialize file\n");
+
+        if (close(fd) != 0)
+            perror("WRITE NEW VECTOR FILE could not close file descriptor");
+    }
+    // the log can't recreate the file, so it's made durable before it's logged
+    else if (wal_opened && ((p_vec_mutex->durability != DURABILITY_NONE && 
+        (fsync(fd) != 0 || !sync_vectors_folder())) || 
+        !append_wal_record(p_vec_mutex, 0, 0, NULL)))
+    {
+        res = 0;
+        printf("WRITE NEW VECTOR FILE could not log the new vector\n");
+    }
+
+    return res;
+}
+
+
+
+int create_array_file(char* name, int size, int durability)
+{
+    int res = NEW_VECTOR_CREATED;
+    int mutex_added = 0;
+    int destroyed = 0;
+    struct vector_mutex* p_vec_mutex = NULL;
+
+    // the vector may still be registered if its file was removed while the server was running
+    if ((p_vec_mutex = get_vector_mutex(name)) == NULL) 
+    {
+        if (add_vector_mutex(name, -1)) // create mutex for new vector
+        {
+            mutex_added = 1;
+            p_vec_mutex = get_vector_mutex(name); // acquire newly created mutex
+        }
+        else
+            printf("CREATE ARRAY FILE could not create vector mutex\n");
+    }
+        
+    if (p_vec_mutex != NULL)
+    {
+        if (pthread_rwlock_wrlock(&p_vec_mutex->lock) == 0)  // lock access to vector file
+        {
+            // another init of the name may have got the lock first. A mutex registered here 
+            // gets a manifest slot only when its vector is created, without one the file is a 
+            // leftover of a crash and it's overwritten
+            int old_vec_size = -1;
+            if (!mutex_added || p_vec_mutex->manifest_slot != -1)
+                old_vec_size = get_vector_size(name);
+
+            // destroyed while it was pinned, the name is looked up again once it's released
+            if (p_vec_mutex->to_remove)
+                destroyed = 1;
+            else if (old_vec_size >= 0)
+                res = old_vec_size == size ? VECTOR_ALREADY_EXISTS : VECTOR_CREATION_ERROR;
+            else if (!write_new_vector_file(p_vec_mutex, size, durability))
+            {
+                res = VECTOR_CREATION_ERROR;
+
+                // in case mutex was created but some other errors occurred remove the mutex
+                if (mutex_added)
+                {
+                    remove_manifest_entry(p_vec_mutex);
+                    mark_vector_mutex_to_remove(p_vec_mutex);
+                }
+            }
+
+            if (!unlock_vector_mutex(p_vec_mutex))
+            {
+                res = VECTOR_CREATION_ERROR;
+                perror("CREATE ARRAY FILE could not unlock mutex");
+            }
+        }
+        else // couldn't lock mutex
+        {
+            res = VECTOR_CREATION_ERROR;
+            perror("CREATE ARRAY FILE could not lock mutex");
+        }
+    }
+    else // NULL vector mutex, no such vector
+    {
+        res = VECTOR_CREATION_ERROR;
+    }
+
+    if (!commit_wal())
+        res = VECTOR_CREATION_ERROR;
+
+    if (destroyed)
+        return create_array_file(name, size, durability);
+    
+    return res;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// write-ahead log functions
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void get_wake_time(struct timespec* p_wake_time, int interval_ms)
+{
+    clock_gettime(CLOCK_REALTIME, p_wake_time);
+    p_wake_time->tv_sec += interval_ms / 1000;
+    p_wake_time->tv_nsec += (long) (interval_ms % 1000) * 1000000;
+    if (p_wake_time->tv_nsec >= 1000000000)
+    {
+        p_wake_time->tv_sec++;
+        p_wake_time->tv_nsec -= 1000000000;
+    }
+}
+
+
+
+int start_wal()
+{
+    if (!replay_wal())
+        return 0;
+
+    // everything replayed is in the vector files, so the old logs are not needed anymore
+    if (!checkpoint_vectors())
+    {
+        printf("START WAL could not checkpoint replayed vectors\n");
+        return 0;
+    }
+
+    if ((unlink(WAL_OLD_FILE_NAME) != 0 && errno != ENOENT) || 
+        (unlink(WAL_FILE_NAME) != 0 && errno != ENOENT))
+    {
+        perror("START WAL could not remove the replayed log");
+        return 0;
+    }
+
+    wal_fd = open(WAL_FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, S_IRUSR | S_IWUSR);
+    if (wal_fd == -1)
+    {
+        perror("START WAL could not create the log");
+        return 0;
+    }
+
+    wal_buffers[0] = (char*) malloc(WAL_BUFFER_SIZE);
+    wal_buffers[1] = (char*) malloc(WAL_BUFFER_SIZE);
+    if (wal_buffers[0] == NULL || wal_buffers[1] == NULL)
+    {
+        perror("START WAL could not allocate the log buffers");
+        return 0;
+    }
+
+    if (!sync_vectors_folder())
+        return 0;
+
+    wal_opened = 1;
+
+    if (pthread_create(&checkpointer_thread, NULL, checkpoint_periodically, NULL) != 0)
+    {
+        perror("START WAL could not create the checkpointer thread");
+        return 0;
+    }
+
+    if (pthread_create(&flusher_thread, NULL, flush_wal_periodically, NULL) != 0)
+    {
+        perror("START WAL could not create the flusher thread");
+
+        pthread_mutex_lock(&mutex_wal);
+        wal_threads_stop = 1;
+        pthread_cond_signal(&cond_checkpoint);
+        pthread_mutex_unlock(&mutex_wal);
+        pthread_join(checkpointer_thread, NULL);
+
+        return 0;
+    }
+
+    wal_threads_started = 1;
+
+    return 1;
+}
+
+
+
+void stop_wal()
+{
+    if (!wal_threads_started)
+        return;
+
+    pthread_mutex_lock(&mutex_wal);
+    wal_threads_stop = 1;
+    pthread_cond_signal(&cond_checkpoint);
+    pthread_cond_signal(&cond_wal_flush);
+    pthread_mutex_unlock(&mutex_wal);
+
+    if (pthread_join(checkpointer_thread, NULL) != 0)
+        perror("STOP WAL could not join the checkpointer thread");
+
+    if (pthread_join(flusher_thread, NULL) != 0)
+        perror("STOP WAL could not join the flusher thread");
+
+    wal_threads_started = 0;
+
+    // changes of periodic vectors which were not flushed yet
+    pthread_mutex_lock(&mutex_wal);
+
+    if (wal_buffer_len > 0 && !wal_broken)
+        write_wal_buffer();
+
+    pthread_mutex_unlock(&mutex_wal);
+}
+
+
+
+void close_wal()
+{
+    wal_opened = 0;
+
+    if (wal_fd != -1 && close(wal_fd) != 0)
+        perror("CLOSE WAL could not close the log");
+
+    wal_fd = -1;
+
+    free(wal_buffers[0]);
+    free(wal_buffers[1]);
+    wal_buffers[0] = NULL;
+    wal_buffers[1] = NULL;
+}
+
+
+
+uint32_t get_wal_checksum(char* data, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t) data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+
+int append_wal_record(struct vector_mutex* p_vec_mutex, int pos, int len, int32_t* elems)
+{
+    if (!wal_opened || (len > 0 && p_vec_mutex->durability == DURABILITY_NONE))
+        return 1;
+
+    int res = 1;
+
+    pthread_mutex_lock(&mutex_wal);
+
+    int done = 0;
+    do // at least once, a record with no elements is logged as well
+    {
+        int record_len = len - done < WAL_MAX_RECORD_LEN ? len - done : WAL_MAX_RECORD_LEN;
+        size_t record_size = WAL_RECORD_HEADER_SIZE + (size_t) record_len * VECTOR_ELEM_SIZE;
+
+        // the buffer is full, wait until the other one is written or write this one
+        while (!wal_broken && wal_buffer_len + record_size > WAL_BUFFER_SIZE)
+        {
+            if (wal_commit_in_progress)
+                pthread_cond_wait(&cond_wal_committed, &mutex_wal);
+            else
+                write_wal_buffer();
+        }
+
+        if (wal_broken)
+        {
+            res = 0;
+            break;
+        }
+
+        char* p_record = wal_buffers[wal_active_buffer] + wal_buffer_len;
+
+        struct wal_record_header header;
+        memset(&header, 0, WAL_RECORD_HEADER_SIZE);
+        header.pos = (int32_t) htole32((uint32_t) (pos + done));
+        header.len = (int32_t) htole32((uint32_t) record_len);
+        strncpy(header.name, p_vec_mutex->vector_name, MAX_VECTOR_NAME_LEN - 1);
+
+        memcpy(p_record, &header, WAL_RECORD_HEADER_SIZE);
+        if (record_len > 0)
+        {
+            memcpy(p_record + WAL_RECORD_HEADER_SIZE, &elems[done], 
+                (size_t) record_len * VECTOR_ELEM_SIZE);
+        }
+
+        uint32_t checksum = htole32(get_wal_checksum(p_record + sizeof(header.checksum), 
+            record_size - sizeof(header.checksum)));
+        memcpy(p_record, &checksum, sizeof(checksum));
+
+        wal_buffer_len += record_size;
+        wal_appended_lsn += record_size;
+        done += record_len;
+    } while (done < len);
+
+    if (res && (len == 0 || p_vec_mutex->durability == DURABILITY_STRICT))
+        wal_pending_lsn = wal_appended_lsn;
+    else if (res && ++wal_unflushed_ops >= config.flush_ops) // periodic, don't wait for the flusher
+        pthread_cond_signal(&cond_wal_flush);
+
+    pthread_mutex_unlock(&mutex_wal);
+
+    return res;
+}
+
+
+
+int commit_wal()
+{
+    if (wal_pending_lsn == 0) // nothing appended by this thread
+        return 1;
+
+    pthread_mutex_lock(&mutex_wal);
+
+    while (!wal_broken && wal_committed_lsn < wal_pending_lsn)
+    {
+        if (wal_commit_in_progress) // records of this thread may be written by the leader
+            pthread_cond_wait(&cond_wal_committed, &mutex_wal);
+        else // become the leader and write records of all waiting threads
+            write_wal_buffer();
+    }
+
+    int res = wal_committed_lsn >= wal_pending_lsn;
+    wal_pending_lsn = 0;
+
+    pthread_mutex_unlock(&mutex_wal);
+
+    return res;
+}
+
+
+
+void write_wal_buffer()
+{
+    char* buffer = wal_buffers[wal_active_buffer];
+    size_t num_of_bytes = wal_buffer_len;
+    uint64_t end_lsn = wal_appended_lsn;
+    int fd = wal_fd;
+
+    // next records go to the other buffer while this one is written
+    wal_active_buffer = 1 - wal_active_buffer;
+    wal_buffer_len = 0;
+    wal_unflushed_ops = 0;
+    wal_commit_in_progress = 1;
+
+    pthread_mutex_unlock(&mutex_wal);
+
+    int res = 1;
+    size_t done = 0;
+
+    while (done < num_of_bytes)
+    {
+        ssize_t n = write(fd, buffer + done, num_of_bytes - done);
+
+        if (n <= 0)
+        {
+            res = 0;
+            perror("WRITE WAL BUFFER could not write the log");
+            break;
+        }
+
+        done += n;
+    }
+
+    if (res && fdatasync(fd) != 0)
+    {
+        res = 0;
+        perror("WRITE WAL BUFFER could not sync the log");
+    }
+
+    pthread_mutex_lock(&mutex_wal);
+
+    if (res)
+    {
+        wal_committed_lsn = end_lsn;
+        wal_file_len += num_of_bytes;
+
+        if (wal_file_len >= WAL_CHECKPOINT_SIZE)
+            pthread_cond_signal(&cond_checkpoint);
+    }
+    else // the records are lost, so no change can be reported as durable anymore
+    {
+        wal_broken = 1;
+    }
+
+    wal_commit_in_progress = 0;
+    pthread_cond_broadcast(&cond_wal_committed);
+}
+
+
+
+int replay_wal()
+{
+    uint64_t num_of_records = 0;
+
+    // the old log has older records, it's still there if the last checkpoint didn't finish
+    if (!replay_wal_file(WAL_OLD_FILE_NAME, 0, &num_of_records) || 
+        !replay_wal_file(WAL_FILE_NAME, 0, &num_of_records))
+    {
+        return 0;
+    }
+
+    num_of_records = 0;
+
+    return replay_wal_file(WAL_OLD_FILE_NAME, 1, &num_of_records) && 
+        replay_wal_file(WAL_FILE_NAME, 1, &num_of_records);
+}
+
+
+
+int replay_wal_file(char* file_name, int apply, uint64_t* p_num_of_records)
+{
+    FILE* p_file = fopen(file_name, "rb");
+    if (p_file == NULL)
+    {
+        if (errno == ENOENT)
+            return 1;
+
+        perror("REPLAY WAL FILE could not open the log");
+        return 0;
+    }
+
+    int res = 1;
+    char* record = (char*) malloc(WAL_RECORD_HEADER_SIZE + WAL_MAX_RECORD_LEN * VECTOR_ELEM_SIZE);
+    int* values = (int*) malloc(WAL_MAX_RECORD_LEN * sizeof(int));
+
+    if (record == NULL || values == NULL)
+    {
+        res = 0;
+        perror("REPLAY WAL FILE could not allocate the record buffer");
+    }
+
+    // a torn or corrupted record ends the log, it was never committed
+    while (res && fread(record, WAL_RECORD_HEADER_SIZE, 1, p_file) == 1)
+    {
+        struct wal_record_header header;
+        memcpy(&header, record, WAL_RECORD_HEADER_SIZE);
+
+        int pos = (int32_t) le32toh((uint32_t) header.pos);
+        int len = (int32_t) le32toh((uint32_t) header.len);
+        size_t elems_size = (size_t) len * VECTOR_ELEM_SIZE;
+
+        if (len < 0 || len > WAL_MAX_RECORD_LEN || 
+            (len > 0 && fread(record + WAL_RECORD_HEADER_SIZE, elems_size, 1, p_file) != 1) || 
+            le32toh(header.checksum) != get_wal_checksum(record + sizeof(header.checksum), 
+                WAL_RECORD_HEADER_SIZE + elems_size - sizeof(header.checksum)))
+        {
+            printf("REPLAY WAL FILE %s ends with an incomplete record\n", file_name);
+            break;
+        }
+
+        header.name[MAX_VECTOR_NAME_LEN - 1] = '\0';
+        uint64_t record_num = ++(*p_num_of_records);
+
+        // records of vectors which don't exist anymore are ignored
+        struct vector_mutex* p_vec_mutex = get_vector_mutex(header.name);
+        if (p_vec_mutex == NULL)
+            continue;
+
+        if (!apply && len == 0)
+            p_vec_mutex->wal_replay_from = record_num;
+        else if (apply && len > 0 && record_num > p_vec_mutex->wal_replay_from)
+        {
+            int32_t* elems = (int32_t*) (record + WAL_RECORD_HEADER_SIZE);
+            for (int i = 0; i < len; i++)
+                values[i] = (int32_t) le32toh((uint32_t) elems[i]);
+
+            res = replay_wal_record(p_vec_mutex, pos, len, values);
+        }
+
+        if (!release_vector_mutex(p_vec_mutex))
+            res = 0;
+    }
+
+    if (ferror(p_file))
+    {
+        res = 0;
+        perror("REPLAY WAL FILE could not read the log");
+    }
+
+    free(record);
+    free(values);
+    fclose(p_file);
+
+    return res;
+}
+
+
+
+int replay_wal_record(struct vector_mutex* p_vec_mutex, int pos, int len, int32_t* elems)
+{
+    int res = 1;
+
+    if (pthread_rwlock_rdlock(&p_vec_mutex->lock) != 0)
+    {
+        perror("REPLAY WAL RECORD could not lock the mutex");
+        return 0;
+    }
+
+    if (!open_vector_file(p_vec_mutex))
+    {
+        res = 0;
+        printf("REPLAY WAL RECORD could not open the vector file of %s\n", 
+            p_vec_mutex->vector_name);
+    }
+    else if (pos >= 0 && pos <= p_vec_mutex->size - len) // size may differ after a crash
+    {
+        res = write_vector_range(p_vec_mutex, pos, len, elems);
+    }
+
+    if (pthread_rwlock_unlock(&p_vec_mutex->lock) != 0)
+    {
+        res = 0;
+        perror("REPLAY WAL RECORD could not unlock the mutex");
+    }
+
+    return res;
+}
+
+
+
+int rotate_wal()
+{
+    if (rename(WAL_FILE_NAME, WAL_OLD_FILE_NAME) != 0)
+    {
+        perror("ROTATE WAL could not rename the log");
+        return 0;
+    }
+
+    int fd = open(WAL_FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, S_IRUSR | S_IWUSR);
+
+    if (fd == -1 || !sync_vectors_folder())
+    {
+        perror("ROTATE WAL could not create a new log");
+
+        if (fd != -1)
+            close(fd);
+
+        // keep appending to the old log, it still has all the records
+        if (rename(WAL_OLD_FILE_NAME, WAL_FILE_NAME) != 0)
+        {
+            perror("ROTATE WAL could not rename the old log back");
+            wal_broken = 1;
+        }
+
+        return 0;
+    }
+
+    if (close(wal_fd) != 0)
+        perror("ROTATE WAL could not close the old log");
+
+    wal_fd = fd;
+    wal_file_len = 0;
+
+    return 1;
+}
+
+
+
+int checkpoint_vectors()
+{
+    int res = 1;
+
+    // take every vector so that it can't be freed while it's synced
+    struct vector_mutex** to_sync = get_all_vector_mutexes();
+    int num_to_sync = to_sync != NULL ? vector_size(to_sync) : 0;
+
+    if (to_sync == NULL)
+        res = 0;
+
+    for (int i = 0; i < num_to_sync; i++)
+    {
+        if (pthread_rwlock_rdlock(&to_sync[i]->lock) == 0)
+        {
+            int fd = __atomic_load_n(&to_sync[i]->fd, __ATOMIC_ACQUIRE);
+
+            // vectors which are not logged are left to the msync thread and eviction
+            if (fd != -1 && to_sync[i]->durability != DURABILITY_NONE)
+            {
+                if (!sync_vector_file(to_sync[i]))
+                    res = 0;
+                else if (fsync(fd) != 0)
+                {
+                    res = 0;
+                    perror("CHECKPOINT VECTORS could not sync the vector file");
+                }
+            }
+
+            if (!unlock_vector_mutex(to_sync[i]))
+                res = 0;
+        }
+        else
+        {
+            res = 0;
+            perror("CHECKPOINT VECTORS could not lock vector mutex");
+            release_vector_mutex(to_sync[i]);
+        }
+    }
+
+    if (to_sync != NULL)
+        vector_free(to_sync);
+
+    return sync_vectors_folder() && res;
+}
+
+
+
+int sync_vectors_folder()
+{
+    int dir_fd = open(VECTORS_FOLDER, O_RDONLY | O_DIRECTORY);
+
+    if (dir_fd == -1)
+    {
+        perror("SYNC VECTORS FOLDER could not open the vectors folder");
+        return 0;
+    }
+
+    int res = 1;
+
+    if (fsync(dir_fd) != 0)
+    {
+        res = 0;
+        perror("SYNC VECTORS FOLDER could not sync the vectors folder");
+    }
+
+    close(dir_fd);
+
+    return res;
+}
+
+
+
+void* checkpoint_periodically(void* arg)
+{
+    int old_log_exists = 0; // the last checkpoint failed, it's retried before a new rotation
+
+    pthread_mutex_lock(&mutex_wal);
+
+    while (!wal_threads_stop)
+    {
+        struct timespec wake_time;
+        get_wake_time(&wake_time, config.checkpoint_interval_ms);
+
+        int wait_res = 0;
+        while (!wal_threads_stop && wait_res != ETIMEDOUT && wal_file_len < WAL_CHECKPOINT_SIZE)
+            wait_res = pthread_cond_timedwait(&cond_checkpoint, &mutex_wal, &wake_time);
+
+        if (wal_threads_stop)
+            break;
+
+        if (!old_log_exists)
+        {
+            if (wal_file_len == 0) // nothing changed since the last checkpoint
+                continue;
+
+            // the descriptor can't be swapped while a leader writes to it
+            while (wal_commit_in_progress)
+                pthread_cond_wait(&cond_wal_committed, &mutex_wal);
+
+            if (!rotate_wal())
+                continue;
+
+            old_log_exists = 1;
+        }
+
+        pthread_mutex_unlock(&mutex_wal);
+
+        // records of the old log were applied before they were appended, so they are all in
+        // the vectors now and the log can be removed once the vectors are durable
+        if (checkpoint_vectors())
+        {
+            if (unlink(WAL_OLD_FILE_NAME) == 0)
+                old_log_exists = 0;
+            else
+                perror("CHECKPOINT PERIODICALLY could not remove the old log");
+        }
+        else
+            printf("CHECKPOINT PERIODICALLY could not checkpoint vectors\n");
+
+        pthread_mutex_lock(&mutex_wal);
+    }
+
+    pthread_mutex_unlock(&mutex_wal);
+
+    return NULL;
+}
+
+
+
+void* flush_wal_periodically(void* arg)
+{
+    pthread_mutex_lock(&mutex_wal);
+
+    while (!wal_threads_stop)
+    {
+        struct timespec wake_time;
+        get_wake_time(&wake_time, config.flush_interval_ms);
+
+        int wait_res = 0;
+        while (!wal_threads_stop && wait_res != ETIMEDOUT && wal_unflushed_ops < config.flush_ops)
+            wait_res = pthread_cond_timedwait(&cond_wal_flush, &mutex_wal, &wake_time);
+
+        if (wal_threads_stop)
+            break;
+
+        // a commit of a strict change may be writing the buffer already
+        while (wal_commit_in_progress)
+            pthread_cond_wait(&cond_wal_committed, &mutex_wal);
+
+        if (wal_buffer_len > 0 && !wal_broken)
+            write_wal_buffer();
+    }
+
+    pthread_mutex_unlock(&mutex_wal);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// set value in vector functions
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int set_value_in_vector_file(char* vec_name, int pos, int val)
+{
+    if (pos < 0)
+        return SET_FAIL;
+
+    int res = SET_SUCCESS;
+    
+    struct vector_mutex* p_vec_mutex = NULL;
+
+    if ((p_vec_mutex = get_vector_mutex(vec_name)) != NULL) // obtain mutex for the vector file
+    {
+        res = set_value_in_vector(p_vec_mutex, pos, val);
+
+        if (!release_vector_mutex(p_vec_mutex))
+            res = SET_FAIL;      
+    }
+    else // can't obtain mutex, no such vector
+    {
+        res = SET_FAIL;
+    }
+
+    return res;
+}
+
+
+
+int set_value_in_vector(struct vector_mutex* p_vec_mutex, int pos, int val)
+{
+    if (pos < 0)
+        return SET_FAIL;
+
+    int res = SET_SUCCESS;
+
+    // shared, the element itself is protected by its stripe lock
+    if (pthread_rwlock_rdlock(&p_vec_mutex->lock) == 0)
+    {
+        // destroyed while it was pinned
+        if (p_vec_mutex->to_remove)
+            res = SET_FAIL;
+        else if (open_vector_file(p_vec_mutex))
+        {
+            if (pos < p_vec_mutex->size)
+            {
+                pthread_rwlock_t* p_stripe_lock = get_stripe_lock(p_vec_mutex, pos);
+
+                if (pthread_rwlock_wrlock(p_stripe_lock) == 0)
+                {
+                    if (!write_vector_elem(p_vec_mutex, pos, val))
+                        res = SET_FAIL;
+
+                    pthread_rwlock_unlock(p_stripe_lock);
+                }
+                else
+                {
+                    res = SET_FAIL;
+                    perror("SET VALUE IN VECTOR could not lock the stripe");
+                }
+            }
+            else // position out of range
+            {
+                res = SET_FAIL;
+            }
+        }
+        else // can't open vector file
+        {
+            res = SET_FAIL;   
+            printf("SET VALUE IN VECTOR could not open the vector file\n");
+        }
+
+        if (pthread_rwlock_unlock(&p_vec_mutex->lock) != 0)
+        {
+            res = SET_FAIL;
+            perror("SET VALUE IN VECTOR could not unlock the mutex");
+        }
+    }
+    else // can't lock mutex
+    {
+        res = SET_FAIL;
+        perror("SET VALUE IN VECTOR could not lock the mutex");
+    }
+
+    // after the locks are released, so that concurrent sets are committed together
+    if (!commit_wal())
+        res = SET_FAIL;
+
+    return res;
+}
+
+
+
+void *set(void* p_set_msg)
+{
+    struct set_msg* p_msg = (struct set_msg*) p_set_msg;
+
+    // set value in file
+    int response = set_value_in_vector_file(p_msg->name, p_msg->pos, p_msg->value);
+    
+    // send response
+    send_op_response(p_msg->resp_queue_name, response, 0, p_msg->request_id);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// get value from vector
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int get_value_from_vector_file(char* vec_name, int pos, int* p_value)
+{
+    if (pos < 0)
+        return 0;
+
+    int res = 1;
+
+    struct vector_mutex* p_vec_mutex;
+    if ((p_vec_mutex = get_vector_mutex(vec_name)) != NULL) // obtain mutex for the vector file
+    {
+        res = get_value_from_vector(p_vec_mutex, pos, p_value);
+
+        if (!release_vector_mutex(p_vec_mutex))
+            res = 0;
+    }
+    else // vector doesn't exist
+    {
+        res = 0;
+    }
+
+    return res;
+}
+
+
+
+int get_value_from_vector(struct vector_mutex* p_vec_mutex, int pos, int* p_value)
+{
+    if (pos < 0)
+        return 0;
+
+    int res = 1;
+
+    // shared, so that gets of the same vector run in parallel
+    if (pthread_rwlock_rdlock(&p_vec_mutex->lock) == 0)
+    {
+        // destroyed while it was pinned
+        if (p_vec_mutex->to_remove)
+            res = 0;
+        else if (open_vector_file(p_vec_mutex))
+        {
+            if (pos < p_vec_mutex->size)
+            {
+                pthread_rwlock_t* p_stripe_lock = get_stripe_lock(p_vec_mutex, pos);
+
+                if (pthread_rwlock_rdlock(p_stripe_lock) == 0)
+                {
+                    if (!read_vector_elem(p_vec_mutex, pos, p_value))
+                        res = 0;
+
+                    pthread_rwlock_unlock(p_stripe_lock);
+                }
+                else
+                {
+                    res = 0;
+                    perror("GET VALUE FROM VECTOR could not lock the stripe");
+                }
+            }
+            else // position out of range
+            {
+                res = 0;
+            }
+        }
+        else // can't open file
+        {
+            res = 0;
+            printf("GET VALUE FROM VECTOR could not open file\n");
+        }
+
+        if (pthread_rwlock_unlock(&p_vec_mutex->lock) != 0)
+        {
+            res = 0;
+            perror("GET VALUE FROM VECTOR could not unlock mutex");
+        }
+    }
+    else // couldn't lock mutex
+    {
+        res = 0;
+        perror("GET VALUE FROM VECTOR could not lock mutex");
+    }  
+
+    return res;
+}
+
+
+
+void* get(void* p_get_msg)
+{
+    struct get_msg* p_msg = (struct get_msg*) p_get_msg;
+
+    // get value from file
+    int value = 0;
+    int error = get_value_from_vector_file(p_msg->name, p_msg->pos, &value) ? 
+        GET_SUCCESS : GET_FAIL;
+    
+    // send response
+    send_op_response(p_msg->resp_queue_name, error, value, p_msg->request_id);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// destroy
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int destroy_vector(char* name)
+{
+    int result = DESTROY_SUCCESS;
+    
+    struct vector_mutex* p_vec_mutex;
+    
+    if ((p_vec_mutex = get_vector_mutex(name)) != NULL)
+    {
+        char full_vector_file_name[get_full_vector_file_name_max_len()];
+        get_full_vector_file_name(full_vector_file_name, name);
+        
+        if (pthread_rwlock_wrlock(&p_vec_mutex->lock) == 0)
+        {
+            // destroyed by another thread while it was pinned, the file may already belong to 
+            // a new vector of the same name
+            if (p_vec_mutex->to_remove)
+            {
+                result = DESTROY_FAIL;
+
+                if (!unlock_vector_mutex(p_vec_mutex))
+                    printf("DESTROY could not unlock vector mutex\n");
+            }
+            else
+            {
+                // the file is removed anyway, so the cache is not written back
+                if (p_vec_mutex->dirty_pages != NULL)
+                    memset(p_vec_mutex->dirty_pages, 0, p_vec_mutex->num_of_pages);
+
+                if (!close_vector_file(p_vec_mutex))
+                    result = DESTROY_FAIL;
+
+                if (remove(full_vector_file_name) != 0) // if couldn't remove the file
+                {
+                    perror("DESTROY could not remove the vector file");
+                    result = DESTROY_FAIL;
+                }
+                else if (!remove_manifest_entry(p_vec_mutex))
+                {
+                    printf("DESTROY could not remove the vector from the manifest\n");
+                    result = DESTROY_FAIL;
+                }
+                // older records must not be replayed into a vector created with the same name
+                else if (wal_opened && ((p_vec_mutex->durability != DURABILITY_NONE && 
+                    !sync_vectors_folder()) || !append_wal_record(p_vec_mutex, 0, 0, NULL)))
+                {
+                    printf("DESTROY could not log the removal\n");
+                    result = DESTROY_FAIL;
+                }
+
+                if (mark_vector_mutex_to_remove(p_vec_mutex))
+                {
+                    if (!unlock_vector_mutex(p_vec_mutex))
+                    {
+                        result = DESTROY_FAIL;
+                        printf("DESTROY could not unlock vector mutex");
+                    }
+                }
+                else
+                {
+                    printf("DESTROY could not set mutex to remove\n");
+                }
+            }
+        }
+        else // couldn't lock mutex
+        {
+            result = DESTROY_FAIL;
+            perror("DESTROY could not lock the mutex");
+        }
+    }
+    else // vector doesn't exist
+    {
+        result = DESTROY_FAIL;
+    }
+
+    if (!commit_wal())
+        result = DESTROY_FAIL;
+
+    return result;
+}
+
+
+
+void* destroy(void* p_destroy_msg)
+{
+    struct destroy_msg* p_msg = (struct destroy_msg*) p_destroy_msg;
+
+    // destroy vector
+    int result = destroy_vector(p_msg->name);
+    
+    // send response
+    send_op_response(p_msg->resp_queue_name, result, 0, p_msg->request_id);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// batch
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+/*
+    finds the lowest and the highest position of the batch. 0 if any position is out of range
+*/
+int get_batch_span(struct batch_msg* p_msg, int size, int* p_first_pos, int* p_last_pos)
+{
+    *p_first_pos = size;
+    *p_last_pos = -1;
+
+    for (int i = 0; i < p_msg->len; i++)
+    {
+        int pos = p_msg->elems[i].pos;
+
+        if (pos < 0 || pos >= size)
+            return 0;
+
+        if (pos < *p_first_pos)
+            *p_first_pos = pos;
+        if (pos > *p_last_pos)
+            *p_last_pos = pos;
+    }
+
+    return 1;
+}
+
+
+
+/*
+    sets or gets all elements of the batch, stripes of the whole span must be locked. Elements 
+    which are close to each other are done with one file pass over the span, in mmap mode and
+    for scattered positions elements are done one by one. 1 -> success, 0 -> fail
+*/
+int execute_batch(struct vector_mutex* p_vec_mutex, struct batch_msg* p_msg, int first_pos, 
+    int last_pos, int* values)
+{
+    int res = 1;
+    int span_len = last_pos - first_pos + 1;
+
+    if (p_vec_mutex->p_data != NULL || span_len > MAX_BATCH_SPAN_LEN)
+    {
+        for (int i = 0; i < p_msg->len && res; i++)
+        {
+            if (p_msg->op == BATCH_OP_SET)
+                res = write_vector_elem(p_vec_mutex, p_msg->elems[i].pos, p_msg->elems[i].value);
+            else
+                res = read_vector_elem(p_vec_mutex, p_msg->elems[i].pos, &values[i]);
+        }
+    }
+    else
+    {
+        int* span = (int*) malloc((size_t) span_len * sizeof(int));
+        if (span == NULL)
+        {
+            perror("EXECUTE BATCH could not allocate the span buffer");
+            return 0;
+        }
+
+        if (read_vector_range(p_vec_mutex, first_pos, span_len, span))
+        {
+            for (int i = 0; i < p_msg->len; i++)
+            {
+                if (p_msg->op == BATCH_OP_SET)
+                    span[p_msg->elems[i].pos - first_pos] = p_msg->elems[i].value;
+                else
+                    values[i] = span[p_msg->elems[i].pos - first_pos];
+            }
+
+            if (p_msg->op == BATCH_OP_SET && 
+                !write_vector_range(p_vec_mutex, first_pos, span_len, span))
+            {
+                res = 0;
+            }
+        }
+        else // can't read the span
+        {
+            res = 0;
+        }
+
+        free(span);
+    }
+
+    return res;
+}
+
+
+
+/*
+    applies a set or a get batch to the vector file, values of a get batch are stored in values.
+    The vector lock is taken once, shared, and stripes covering all the positions are locked 
+    together, so other requests see the whole batch applied or not applied at all. 
+    If any position is out of range nothing is done. 1 -> success, 0 -> fail
+*/
+int apply_batch_to_vector_file(struct batch_msg* p_msg, int* values)
+{
+    if (p_msg->len < 1 || p_msg->len > MAX_BATCH_LEN || 
+        (p_msg->op != BATCH_OP_SET && p_msg->op != BATCH_OP_GET))
+    {
+        return 0;
+    }
+
+    int res = 1;
+
+    struct vector_mutex* p_vec_mutex;
+    if ((p_vec_mutex = get_vector_mutex(p_msg->name)) != NULL) // obtain mutex for the vector file
+    {
+        // shared, the elements are protected by their stripe locks
+        if (pthread_rwlock_rdlock(&p_vec_mutex->lock) == 0)
+        {
+            // destroyed while it was pinned
+            if (p_vec_mutex->to_remove)
+                res = 0;
+            else if (open_vector_file(p_vec_mutex))
+            {
+                int first_pos;
+                int last_pos;
+
+                if (get_batch_span(p_msg, p_vec_mutex->size, &first_pos, &last_pos))
+                {
+                    if (lock_stripes(p_vec_mutex, first_pos, last_pos, 
+                        p_msg->op == BATCH_OP_SET))
+                    {
+                        if (!execute_batch(p_vec_mutex, p_msg, first_pos, last_pos, values))
+                            res = 0;
+
+                        unlock_stripes(p_vec_mutex, first_pos, last_pos);
+                    }
+                    else // couldn't lock stripes
+                    {
+                        res = 0;
+                    }
+                }
+                else // position out of range
+                {
+                    res = 0;
+                }
+            }
+            else // can't open vector file
+            {
+                res = 0;
+                printf("APPLY BATCH TO VECTOR FILE could not open the vector file\n");
+            }
+
+            if (!unlock_vector_mutex(p_vec_mutex))
+                res = 0;
+        }
+        else // can't lock mutex
+        {
+            res = 0;
+            perror("APPLY BATCH TO VECTOR FILE could not lock the mutex");
+        }
+    }
+    else // can't obtain mutex, no such vector
+    {
+        res = 0;
+    }
+
+    if (!commit_wal())
+        res = 0;
+
+    return res;
+}
+
+
+
+void* batch(void* p_batch_msg)
+{
+    struct batch_msg* p_msg = (struct batch_msg*) p_batch_msg;
+
+    struct batch_resp_msg response;
+    response.error = apply_batch_to_vector_file(p_msg, response.values) ? 
+        BATCH_SUCCESS : BATCH_FAIL;
+    response.len = response.error == BATCH_SUCCESS && p_msg->op == BATCH_OP_GET ? p_msg->len : 0;
+    
+    // send response
+    mqd_t q_resp;
+    if ((q_resp = mq_open(p_msg->resp_queue_name, O_WRONLY)) == -1)
+    {
+        perror("RESPONSE ERROR could not open queue for sending response");
+    }
+    else
+    {
+        // only the filled part of values is sent
+        size_t resp_size = BATCH_RESP_MSG_HEADER_SIZE + response.len * sizeof(int);
+
+        if (mq_send(q_resp, (char*) &response, resp_size, 0) == -1)
+        {
+            perror("RESPONSE ERROR could not send response");
+        }
+
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
+        }
+    }
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// range
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+/*
+    sets the values from the message or gets len elements starting at start into values, with
+    one pwrite/pread (or memcpy in mmap mode). The vector lock is taken shared and the stripes
+    covering the range are locked together. 1 -> success, 0 -> fail
+*/
+int apply_range_to_vector_file(struct range_msg* p_msg, int* values)
+{
+    if (p_msg->start < 0 || p_msg->len < 1 || p_msg->len > MAX_RANGE_LEN || 
+        (p_msg->op != RANGE_OP_SET && p_msg->op != RANGE_OP_GET))
+    {
+        return 0;
+    }
+
+    int res = 1;
+
+    struct vector_mutex* p_vec_mutex;
+    if ((p_vec_mutex = get_vector_mutex(p_msg->name)) != NULL) // obtain mutex for the vector file
+    {
+        // shared, the elements are protected by their stripe locks
+        if (pthread_rwlock_rdlock(&p_vec_mutex->lock) == 0)
+        {
+            // destroyed while it was pinned
+            if (p_vec_mutex->to_remove)
+                res = 0;
+            else if (open_vector_file(p_vec_mutex))
+            {
+                int first_pos = p_msg->start;
+                int last_pos = p_msg->start + p_msg->len - 1;
+
+                if (p_msg->start <= p_vec_mutex->size - p_msg->len)
+                {
+                    if (lock_stripes(p_vec_mutex, first_pos, last_pos, 
+                        p_msg->op == RANGE_OP_SET))
+                    {
+                        if (p_msg->op == RANGE_OP_SET)
+                            res = write_vector_range(p_vec_mutex, first_pos, p_msg->len, 
+                                p_msg->values);
+                        else
+                            res = read_vector_range(p_vec_mutex, first_pos, p_msg->len, values);
+
+                        unlock_stripes(p_vec_mutex, first_pos, last_pos);
+                    }
+                    else // couldn't lock stripes
+                    {
+                        res = 0;
+                    }
+                }
+                else // range doesn't fit into the vector
+                {
+                    res = 0;
+                }
+            }
+            else // can't open vector file
+            {
+                res = 0;
+                printf("APPLY RANGE TO VECTOR FILE could not open the vector file\n");
+            }
+
+            if (!unlock_vector_mutex(p_vec_mutex))
+                res = 0;
+        }
+        else // can't lock mutex
+        {
+            res = 0;
+            perror("APPLY RANGE TO VECTOR FILE could not lock the mutex");
+        }
+    }
+    else // can't obtain mutex, no such vector
+    {
+        res = 0;
+    }
+
+    if (!commit_wal())
+        res = 0;
+
+    return res;
+}
+
+
+
+void* range(void* p_range_msg)
+{
+    struct range_msg* p_msg = (struct range_msg*) p_range_msg;
+
+    struct range_resp_msg response;
+    response.error = apply_range_to_vector_file(p_msg, response.values) ? 
+        RANGE_SUCCESS : RANGE_FAIL;
+    response.len = response.error == RANGE_SUCCESS && p_msg->op == RANGE_OP_GET ? p_msg->len : 0;
+    
+    // send response
+    mqd_t q_resp;
+    if ((q_resp = mq_open(p_msg->resp_queue_name, O_WRONLY)) == -1)
+    {
+        perror("RESPONSE ERROR could not open queue for sending response");
+    }
+    else
+    {
+        // only the filled part of values is sent
+        size_t resp_size = RANGE_RESP_MSG_HEADER_SIZE + response.len * sizeof(int);
+
+        if (mq_send(q_resp, (char*) &response, resp_size, 0) == -1)
+        {
+            perror("RESPONSE ERROR could not send response");
+        }
+
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
+        }
+    }
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// atomic read-modify-write
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int rmw_value_in_vector_file(struct rmw_msg* p_msg, int* p_old_value)
+{
+    if (p_msg->pos < 0 || 
+        (p_msg->op != RMW_OP_FETCH_ADD && p_msg->op != RMW_OP_CAS && p_msg->op != RMW_OP_EXCHANGE))
+    {
+        return RMW_FAIL;
+    }
+
+    int res = RMW_SUCCESS;
+
+    struct vector_mutex* p_vec_mutex;
+    if ((p_vec_mutex = get_vector_mutex(p_msg->name)) != NULL) // obtain mutex for the vector file
+    {
+        res = rmw_value_in_vector(p_vec_mutex, p_msg, p_old_value);
+
+        if (!release_vector_mutex(p_vec_mutex))
+            res = RMW_FAIL;
+    }
+    else // can't obtain mutex, no such vector
+    {
+        res = RMW_FAIL;
+    }
+
+    return res;
+}
+
+
+
+int rmw_value_in_vector(struct vector_mutex* p_vec_mutex, struct rmw_msg* p_msg, int* p_old_value)
+{
+    int res = RMW_SUCCESS;
+    int pos = p_msg->pos;
+
+    // shared, the element itself is protected by its stripe lock
+    if (pthread_rwlock_rdlock(&p_vec_mutex->lock) == 0)
+    {
+        // destroyed while it was pinned
+        if (p_vec_mutex->to_remove)
+            res = RMW_FAIL;
+        else if (open_vector_file(p_vec_mutex))
+        {
+            if (pos < p_vec_mutex->size)
+            {
+                pthread_rwlock_t* p_stripe_lock = get_stripe_lock(p_vec_mutex, pos);
+
+                // read and written under one lock, so no other change gets in between
+                if (pthread_rwlock_wrlock(p_stripe_lock) == 0)
+                {
+                    if (read_vector_elem(p_vec_mutex, pos, p_old_value))
+                    {
+                        int new_value = *p_old_value;
+
+                        if (p_msg->op == RMW_OP_FETCH_ADD) // wraps around like the client's add
+                            new_value = (int) ((uint32_t) *p_old_value + (uint32_t) p_msg->operand);
+                        else if (p_msg->op == RMW_OP_EXCHANGE || *p_old_value == p_msg->expected)
+                            new_value = p_msg->operand;
+
+                        // a failed compare-and-swap is only a read, it's neither written nor logged
+                        if (new_value != *p_old_value && 
+                            !write_vector_elem(p_vec_mutex, pos, new_value))
+                        {
+                            res = RMW_FAIL;
+                        }
+                    }
+                    else
+                    {
+                        res = RMW_FAIL;
+                    }
+
+                    pthread_rwlock_unlock(p_stripe_lock);
+                }
+                else
+                {
+                    res = RMW_FAIL;
+                    perror("RMW VALUE IN VECTOR could not lock the stripe");
+                }
+            }
+            else // position out of range
+            {
+                res = RMW_FAIL;
+            }
+        }
+        else // can't open vector file
+        {
+            res = RMW_FAIL;
+            printf("RMW VALUE IN VECTOR could not open the vector file\n");
+        }
+
+        if (pthread_rwlock_unlock(&p_vec_mutex->lock) != 0)
+        {
+            res = RMW_FAIL;
+            perror("RMW VALUE IN VECTOR could not unlock the mutex");
+        }
+    }
+    else // can't lock mutex
+    {
+        res = RMW_FAIL;
+        perror("RMW VALUE IN VECTOR could not lock the mutex");
+    }
+
+    if (!commit_wal())
+        res = RMW_FAIL;
+
+    return res;
+}
+
+
+
+void* rmw(void* p_rmw_msg)
+{
+    struct rmw_msg* p_msg = (struct rmw_msg*) p_rmw_msg;
+
+    int old_value = 0;
+    int response = rmw_value_in_vector_file(p_msg, &old_value);
+
+    send_op_response(p_msg->resp_queue_name, response, old_value, p_msg->request_id);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// simd kernels
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void select_simd_level()
+{
+    simd_level = SIMD_LEVEL_SCALAR;
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        simd_level = SIMD_LEVEL_AVX2;
+    else if (__builtin_cpu_supports("sse4.1"))
+        simd_level = SIMD_LEVEL_SSE41;
+#endif
+}
+
+
+
+int64_t sum_elems(int32_t* elems, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return sum_elems_avx2(elems, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return sum_elems_sse41(elems, len);
+#endif
+
+    int64_t sum = 0;
+
+    for (int i = 0; i < len; i++)
+        sum += elems[i];
+
+    return sum;
+}
+
+
+
+int32_t min_elems(int32_t* elems, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return min_elems_avx2(elems, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return min_elems_sse41(elems, len);
+#endif
+
+    int32_t min = INT32_MAX;
+
+    for (int i = 0; i < len; i++)
+    {
+        if (elems[i] < min)
+            min = elems[i];
+    }
+
+    return min;
+}
+
+
+
+int32_t max_elems(int32_t* elems, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return max_elems_avx2(elems, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return max_elems_sse41(elems, len);
+#endif
+
+    int32_t max = INT32_MIN;
+
+    for (int i = 0; i < len; i++)
+    {
+        if (elems[i] > max)
+            max = elems[i];
+    }
+
+    return max;
+}
+
+
+
+int count_nonzero_elems(int32_t* elems, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return count_nonzero_elems_avx2(elems, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return count_nonzero_elems_sse41(elems, len);
+#endif
+
+    int num_of_nonzero = 0;
+
+    for (int i = 0; i < len; i++)
+    {
+        if (elems[i] != 0)
+            num_of_nonzero++;
+    }
+
+    return num_of_nonzero;
+}
+
+
+
+void elementwise_elems(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+    {
+        elementwise_elems_avx2(op, x, y, k, out, len);
+        return;
+    }
+    else if (simd_level == SIMD_LEVEL_SSE41)
+    {
+        elementwise_elems_sse41(op, x, y, k, out, len);
+        return;
+    }
+#endif
+
+    elementwise_elems_scalar(op, x, y, k, out, len);
+}
+
+
+
+void elementwise_elems_scalar(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len)
+{
+    // unsigned arithmetic, so results wrap around like in the simd kernels
+    for (int i = 0; i < len; i++)
+    {
+        if (op == ELEMENTWISE_OP_ADD)
+            out[i] = (int32_t) ((uint32_t) x[i] + (uint32_t) y[i]);
+        else if (op == ELEMENTWISE_OP_SCALE)
+            out[i] = (int32_t) ((uint32_t) x[i] * (uint32_t) k);
+        else if (op == ELEMENTWISE_OP_AXPY)
+            out[i] = (int32_t) ((uint32_t) x[i] * (uint32_t) k + (uint32_t) y[i]);
+        else if (op == ELEMENTWISE_OP_MIN)
+            out[i] = x[i] < y[i] ? x[i] : y[i];
+        else // ELEMENTWISE_OP_MAX
+            out[i] = x[i] > y[i] ? x[i] : y[i];
+    }
+}
+
+
+
+double dot_elems(int32_t* x, int32_t* y, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return dot_elems_avx2(x, y, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return dot_elems_sse41(x, y, len);
+#endif
+
+    double dot = 0;
+
+    for (int i = 0; i < len; i++)
+        dot += (double) x[i] * y[i];
+
+    return dot;
+}
+
+
+
+double sq_diff_elems(int32_t* x, int32_t* y, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return sq_diff_elems_avx2(x, y, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return sq_diff_elems_sse41(x, y, len);
+#endif
+
+    double sum = 0;
+
+    for (int i = 0; i < len; i++)
+    {
+        double diff = (double) x[i] - y[i];
+        sum += diff * diff;
+    }
+
+    return sum;
+}
+
+
+
+double abs_diff_elems(int32_t* x, int32_t* y, int len)
+{
+#ifdef SIMD_X86
+    if (simd_level == SIMD_LEVEL_AVX2)
+        return abs_diff_elems_avx2(x, y, len);
+    else if (simd_level == SIMD_LEVEL_SSE41)
+        return abs_diff_elems_sse41(x, y, len);
+#endif
+
+    double sum = 0;
+
+    for (int i = 0; i < len; i++)
+        sum += fabs((double) x[i] - y[i]);
+
+    return sum;
+}
+
+
+
+#ifdef SIMD_X86
+
+__attribute__((target("avx2")))
+int64_t sum_elems_avx2(int32_t* elems, int len)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+
+    // elements are widened to 64 bits before adding, so the sum can't overflow
+    for (; i + 8 <= len; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((__m256i*) (elems + i));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    for (; i < len; i++)
+        sum += elems[i];
+
+    return sum;
+}
+
+
+
+__attribute__((target("avx2")))
+int32_t min_elems_avx2(int32_t* elems, int len)
+{
+    __m256i acc = _mm256_set1_epi32(INT32_MAX);
+    int i = 0;
+
+    for (; i + 8 <= len; i += 8)
+        acc = _mm256_min_epi32(acc, _mm256_loadu_si256((__m256i*) (elems + i)));
+
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    int32_t min = INT32_MAX;
+
+    for (int j = 0; j < 8; j++)
+        min = lanes[j] < min ? lanes[j] : min;
+
+    for (; i < len; i++)
+        min = elems[i] < min ? elems[i] : min;
+
+    return min;
+}
+
+
+
+__attribute__((target("avx2")))
+int32_t max_elems_avx2(int32_t* elems, int len)
+{
+    __m256i acc = _mm256_set1_epi32(INT32_MIN);
+    int i = 0;
+
+    for (; i + 8 <= len; i += 8)
+        acc = _mm256_max_epi32(acc, _mm256_loadu_si256((__m256i*) (elems + i)));
+
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    int32_t max = INT32_MIN;
+
+    for (int j = 0; j < 8; j++)
+        max = lanes[j] > max ? lanes[j] : max;
+
+    for (; i < len; i++)
+        max = elems[i] > max ? elems[i] : max;
+
+    return max;
+}
+
+
+
+__attribute__((target("avx2")))
+int count_nonzero_elems_avx2(int32_t* elems, int len)
+{
+    __m256i zeros = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+
+    // a zero element compares to -1, so subtracting the comparison counts zeros in every lane
+    for (; i + 8 <= len; i += 8)
+        acc = _mm256_sub_epi32(acc, 
+            _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i*) (elems + i)), zeros));
+
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    int num_of_zeros = 0;
+
+    for (int j = 0; j < 8; j++)
+        num_of_zeros += lanes[j];
+
+    for (; i < len; i++)
+        num_of_zeros += elems[i] == 0;
+
+    return len - num_of_zeros;
+}
+
+
+
+__attribute__((target("avx2")))
+void elementwise_elems_avx2(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len)
+{
+    __m256i vk = _mm256_set1_epi32(k);
+    int i = 0;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        __m256i vx = _mm256_loadu_si256((__m256i*) (x + i));
+        __m256i vy = op == ELEMENTWISE_OP_SCALE ? vx : _mm256_loadu_si256((__m256i*) (y + i));
+        __m256i v;
+
+        if (op == ELEMENTWISE_OP_ADD)
+            v = _mm256_add_epi32(vx, vy);
+        else if (op == ELEMENTWISE_OP_SCALE)
+            v = _mm256_mullo_epi32(vx, vk);
+        else if (op == ELEMENTWISE_OP_AXPY)
+            v = _mm256_add_epi32(_mm256_mullo_epi32(vx, vk), vy);
+        else if (op == ELEMENTWISE_OP_MIN)
+            v = _mm256_min_epi32(vx, vy);
+        else // ELEMENTWISE_OP_MAX
+            v = _mm256_max_epi32(vx, vy);
+
+        _mm256_storeu_si256((__m256i*) (out + i), v);
+    }
+
+    elementwise_elems_scalar(op, x + i, op == ELEMENTWISE_OP_SCALE ? NULL : y + i, k, out + i, 
+        len - i);
+}
+
+
+
+__attribute__((target("avx2")))
+double dot_elems_avx2(int32_t* x, int32_t* y, int len)
+{
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+
+    // int32 elements convert to doubles exactly
+    for (; i + 4 <= len; i += 4)
+    {
+        __m256d vx = _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (x + i)));
+        __m256d vy = _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (y + i)));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(vx, vy));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double dot = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    for (; i < len; i++)
+        dot += (double) x[i] * y[i];
+
+    return dot;
+}
+
+
+
+__attribute__((target("avx2")))
+double sq_diff_elems_avx2(int32_t* x, int32_t* y, int len)
+{
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+    {
+        __m256d diff = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (x + i))),
+            _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (y + i))));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(diff, diff));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    for (; i < len; i++)
+    {
+        double diff = (double) x[i] - y[i];
+        sum += diff * diff;
+    }
+
+    return sum;
+}
+
+
+
+__attribute__((target("avx2")))
+double abs_diff_elems_avx2(int32_t* x, int32_t* y, int len)
+{
+    __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+    {
+        __m256d diff = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (x + i))),
+            _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i*) (y + i))));
+        acc = _mm256_add_pd(acc, _mm256_andnot_pd(sign, diff));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    for (; i < len; i++)
+        sum += fabs((double) x[i] - y[i]);
+
+    return sum;
+}
+
+
+
+__attribute__((target("sse4.1")))
+int64_t sum_elems_sse41(int32_t* elems, int len)
+{
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((__m128i*) (elems + i));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*) lanes, acc);
+    int64_t sum = lanes[0] + lanes[1];
+
+    for (; i < len; i++)
+        sum += elems[i];
+
+    return sum;
+}
+
+
+
+__attribute__((target("sse4.1")))
+int32_t min_elems_sse41(int32_t* elems, int len)
+{
+    __m128i acc = _mm_set1_epi32(INT32_MAX);
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+        acc = _mm_min_epi32(acc, _mm_loadu_si128((__m128i*) (elems + i)));
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*) lanes, acc);
+    int32_t min = INT32_MAX;
+
+    for (int j = 0; j < 4; j++)
+        min = lanes[j] < min ? lanes[j] : min;
+
+    for (; i < len; i++)
+        min = elems[i] < min ? elems[i] : min;
+
+    return min;
+}
+
+
+
+__attribute__((target("sse4.1")))
+int32_t max_elems_sse41(int32_t* elems, int len)
+{
+    __m128i acc = _mm_set1_epi32(INT32_MIN);
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+        acc = _mm_max_epi32(acc, _mm_loadu_si128((__m128i*) (elems + i)));
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*) lanes, acc);
+    int32_t max = INT32_MIN;
+
+    for (int j = 0; j < 4; j++)
+        max = lanes[j] > max ? lanes[j] : max;
+
+    for (; i < len; i++)
+        max = elems[i] > max ? elems[i] : max;
+
+    return max;
+}
+
+
+
+__attribute__((target("sse4.1")))
+int count_nonzero_elems_sse41(int32_t* elems, int len)
+{
+    __m128i zeros = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+        acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_loadu_si128((__m128i*) (elems + i)), zeros));
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*) lanes, acc);
+    int num_of_zeros = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    for (; i < len; i++)
+        num_of_zeros += elems[i] == 0;
+
+    return len - num_of_zeros;
+}
+
+
+
+__attribute__((target("sse4.1")))
+void elementwise_elems_sse41(int op, int32_t* x, int32_t* y, int k, int32_t* out, int len)
+{
+    __m128i vk = _mm_set1_epi32(k);
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i vx = _mm_loadu_si128((__m128i*) (x + i));
+        __m128i vy = op == ELEMENTWISE_OP_SCALE ? vx : _mm_loadu_si128((__m128i*) (y + i));
+        __m128i v;
+
+        if (op == ELEMENTWISE_OP_ADD)
+            v = _mm_add_epi32(vx, vy);
+        else if (op == ELEMENTWISE_OP_SCALE)
+            v = _mm_mullo_epi32(vx, vk);
+        else if (op == ELEMENTWISE_OP_AXPY)
+            v = _mm_add_epi32(_mm_mullo_epi32(vx, vk), vy);
+        else if (op == ELEMENTWISE_OP_MIN)
+            v = _mm_min_epi32(vx, vy);
+        else // ELEMENTWISE_OP_MAX
+            v = _mm_max_epi32(vx, vy);
+
+        _mm_storeu_si128((__m128i*) (out + i), v);
+    }
+
+    elementwise_elems_scalar(op, x + i, op == ELEMENTWISE_OP_SCALE ? NULL : y + i, k, out + i, 
+        len - i);
+}
+
+
+
+__attribute__((target("sse4.1")))
+double dot_elems_sse41(int32_t* x, int32_t* y, int len)
+{
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2)
+    {
+        __m128d vx = _mm_cvtepi32_pd(_mm_loadl_epi64((__m128i*) (x + i)));
+        __m128d vy = _mm_cvtepi32_pd(_mm_loadl_epi64((__m128i*) (y + i)));
+        acc = _mm_add_pd(acc, _mm_mul_pd(vx, vy));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double dot = lanes[0] + lanes[1];
+
+    for (; i < len; i++)
+        dot += (double) x[i] * y[i];
+
+    return dot;
+}
+
+
+
+__attribute__((target("sse4.1")))
+double sq_diff_elems_sse41(int32_t* x, int32_t* y, int len)
+{
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2)
+    {
+        __m128d diff = _mm_sub_pd(_mm_cvtepi32_pd(_mm_loadl_epi64((__m128i*) (x + i))),
+            _mm_cvtepi32_pd(_mm_loadl_epi64((__m128i*) (y + i))));
+        acc = _mm_add_pd(acc, _mm_mul_pd(diff, diff));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1];
+
+    for (; i < len; i++)
+    {
+        double diff = (double) x[i] - y[i];
+        sum += diff * diff;
+    }
+
+    return sum;
+}
+
+
+
+__attribute__((target("sse4.1")))
+double abs_diff_elems_sse41(int32_t* x, int32_t* y, int len)
+{
+    __m128d sign = _mm_set1_pd(-0.0);
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2)
+    {
+        __m128d diff = _mm_sub_pd(_mm_cvtepi32_pd(_mm_loadl_epi64((__m128i*) (x + i))),
+            _mm_cvtepi32_pd(_mm_loadl_epi64((__m128i*) (y + i))));
+        acc = _mm_add_pd(acc, _mm_andnot_pd(sign, diff));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1];
+
+    for (; i < len; i++)
+        sum += fabs((double) x[i] - y[i]);
+
+    return sum;
+}
+
+#endif
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// reductions
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void reduce_elems(int op, int32_t* elems, int len, struct reduce_acc* p_acc)
+{
+    if (op == REDUCE_OP_SUM || op == REDUCE_OP_MEAN)
+        p_acc->sum += sum_elems(elems, len);
+    else if (op == REDUCE_OP_MIN)
+    {
+        int32_t min = min_elems(elems, len);
+        p_acc->min = min < p_acc->min ? min : p_acc->min;
+    }
+    else if (op == REDUCE_OP_MAX)
+    {
+        int32_t max = max_elems(elems, len);
+        p_acc->max = max > p_acc->max ? max : p_acc->max;
+    }
+    else // REDUCE_OP_COUNT_NONZERO
+        p_acc->num_of_nonzero += count_nonzero_elems(elems, len);
+}
+
+
+
+int reduce_vector_range(struct vector_mutex* p_vec_mutex, int op, int start, int end, 
+    struct reduce_acc* p_acc)
+{
+    int res = 1;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (p_vec_mutex->p_data != NULL) // mapped or cached, the kernels run on the stored elements
+    {
+        reduce_elems(op, p_vec_mutex->p_data + start, end - start, p_acc);
+        return 1;
+    }
+#endif
+
+    // read in chunks, converted to host order by read_vector_range
+    int32_t* chunk = malloc(REDUCE_CHUNK_LEN * sizeof(int32_t));
+    if (chunk == NULL)
+    {
+        perror("REDUCE VECTOR RANGE could not allocate the chunk");
+        return 0;
+    }
+
+    for (int pos = start; pos < end && res; pos += REDUCE_CHUNK_LEN)
+    {
+        int len = end - pos < REDUCE_CHUNK_LEN ? end - pos : REDUCE_CHUNK_LEN;
+
+        if ((res = read_vector_range(p_vec_mutex, pos, len, chunk)))
+            reduce_elems(op, chunk, len, p_acc);
+    }
+
+    free(chunk);
+
+    return res;
+}
+
+
+
+int reduce_vector_file(struct reduce_msg* p_msg, struct reduce_resp_msg* p_resp)
+{
+    if (p_msg->start < 0 || p_msg->op < REDUCE_OP_SUM || p_msg->op > REDUCE_OP_COUNT_NONZERO)
+        return REDUCE_FAIL;
+
+    int res = REDUCE_SUCCESS;
+    struct reduce_acc acc = { 0, INT32_MAX, INT32_MIN, 0 };
+    int len = 0;
+
+    struct vector_mutex* p_vec_mutex;
+    if ((p_vec_mutex = get_vector_mutex(p_msg->name)) != NULL) // obtain mutex for the vector file
+    {
+        // shared, the elements are protected by their stripe locks
+        if (pthread_rwlock_rdlock(&p_vec_mutex->lock) == 0)
+        {
+            // destroyed while it was pinned
+            if (p_vec_mutex->to_remove)
+                res = REDUCE_FAIL;
+            else if (open_vector_file(p_vec_mutex))
+            {
+                int end = p_msg->end == REDUCE_TO_END ? p_vec_mutex->size : p_msg->end;
+                len = end - p_msg->start;
+
+                if (end > p_vec_mutex->size || len < 0)
+                    res = REDUCE_FAIL;
+                else if (len > 0)
+                {
+                    // the whole range is read at one point in time
+                    if (lock_stripes(p_vec_mutex, p_msg->start, end - 1, 0))
+                    {
+                        if (!reduce_vector_range(p_vec_mutex, p_msg->op, p_msg->start, end, &acc))
+                            res = REDUCE_FAIL;
+
+                        unlock_stripes(p_vec_mutex, p_msg->start, end - 1);
+                    }
+                    else // couldn't lock stripes
+                    {
+                        res = REDUCE_FAIL;
+                    }
+                }
+            }
+            else // can't open vector file
+            {
+                res = REDUCE_FAIL;
+                printf("REDUCE VECTOR FILE could not open the vector file\n");
+            }
+
+            if (!unlock_vector_mutex(p_vec_mutex))
+                res = REDUCE_FAIL;
+        }
+        else // can't lock mutex
+        {
+            res = REDUCE_FAIL;
+            perror("REDUCE VECTOR FILE could not lock the mutex");
+        }
+    }
+    else // can't obtain mutex, no such vector
+    {
+        res = REDUCE_FAIL;
+    }
+
+    if (res == REDUCE_SUCCESS)
+    {
+        if (p_msg->op == REDUCE_OP_SUM)
+            p_resp->value = acc.sum;
+        else if (p_msg->op == REDUCE_OP_COUNT_NONZERO)
+            p_resp->value = acc.num_of_nonzero;
+        else if (len == 0) // min, max and mean of no elements
+            res = REDUCE_FAIL;
+        else if (p_msg->op == REDUCE_OP_MIN)
+            p_resp->value = acc.min;
+        else if (p_msg->op == REDUCE_OP_MAX)
+            p_resp->value = acc.max;
+        else // REDUCE_OP_MEAN
+            p_resp->mean = (double) acc.sum / len;
+    }
+
+    return res;
+}
+
+
+
+void* reduce(void* p_reduce_msg)
+{
+    struct reduce_msg* p_msg = (struct reduce_msg*) p_reduce_msg;
+
+    struct reduce_resp_msg response;
+    response.value = 0;
+    response.mean = 0;
+    response.request_id = p_msg->request_id;
+    response.error = reduce_vector_file(p_msg, &response);
+
+    // send response
+    mqd_t q_resp;
+    if ((q_resp = mq_open(p_msg->resp_queue_name, O_WRONLY)) == -1)
+    {
+        perror("RESPONSE ERROR could not open queue for sending response");
+    }
+    else
+    {
+        if (mq_send(q_resp, (char*) &response, REDUCE_RESP_MSG_SIZE, 0) == -1)
+        {
+            perror("RESPONSE ERROR could not send response");
+        }
+
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
+        }
+    }
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// parallel tasks
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int get_num_of_parallel_tasks(int len)
+{
+    int num_of_tasks = len / PARALLEL_MIN_TASK_LEN;
+
+    if (num_of_tasks > num_of_cpus)
+        num_of_tasks = num_of_cpus;
+
+    if (num_of_tasks > PARALLEL_MAX_TASKS)
+        num_of_tasks = PARALLEL_MAX_TASKS;
+
+    return num_of_tasks < 1 ? 1 : num_of_tasks;
+}
+
+
+
+void run_parallel_tasks(void* (*function)(void*), void* tasks, size_t task_size, int num_of_tasks)
+{
+    if (num_of_tasks == 1 || num_of_started_compute_workers == 0)
+    {
+        for (int i = 0; i < num_of_tasks; i++)
+            function((char*) tasks + i * task_size);
+
+        return;
+    }
+
+    struct parallel_run run;
+    run.function = function;
+    run.tasks = (char*) tasks;
+    run.task_size = task_size;
+    run.num_of_tasks = num_of_tasks;
+    run.num_of_claimed = 0;
+    run.num_of_done = 0;
+    run.p_next = NULL;
+
+    pthread_mutex_lock(&mutex_compute);
+
+    if (compute_queue_tail != NULL)
+        compute_queue_tail->p_next = &run;
+    else
+        compute_queue_head = &run;
+    compute_queue_tail = &run;
+
+    pthread_cond_broadcast(&cond_compute_available);
+
+    // request workers are not used, they may all be busy waiting for runs like this one. The
+    // calling thread computes too, so the request advances even if the compute workers are busy
+    int i;
+    while ((i = claim_parallel_task(&run)) != -1)
+    {
+        pthread_mutex_unlock(&mutex_compute);
+        function((char*) tasks + i * task_size);
+        pthread_mutex_lock(&mutex_compute);
+
+        run.num_of_done++;
+    }
+
+    while (run.num_of_done < run.num_of_tasks)
+        pthread_cond_wait(&cond_compute_done, &mutex_compute);
+
+    pthread_mutex_unlock(&mutex_compute);
+}
+
+
+
+int claim_parallel_task(struct parallel_run* p_run)
+{
+    if (p_run->num_of_claimed == p_run->num_of_tasks)
+        return -1;
+
+    int i = p_run->num_of_claimed++;
+
+    if (p_run->num_of_claimed == p_run->num_of_tasks) // nothing left to take, dequeue it
+    {
+        struct parallel_run* p_prev = NULL;
+        struct parallel_run* p_queued = compute_queue_head;
+
+        while (p_queued != p_run)
+        {
+            p_prev = p_queued;
+            p_queued = p_queued->p_next;
+        }
+
+        if (p_prev != NULL)
+            p_prev->p_next = p_run->p_next;
+        else
+            compute_queue_head = p_run->p_next;
+
+        if (compute_queue_tail == p_run)
+            compute_queue_tail = p_prev;
+    }
+
+    return i;
+}
+
+
+
+int start_compute_workers()
+{
+    int num_of_workers = (num_of_cpus < PARALLEL_MAX_TASKS ? num_of_cpus : PARALLEL_MAX_TASKS) - 1;
+
+    for (int i = 0; i < num_of_workers; i++)
+    {
+        if (pthread_create(&compute_workers[i], NULL, compute_worker, NULL) != 0)
+        {
+            perror("START COMPUTE WORKERS could not create the thread");
+            return 0;
+        }
+
+        num_of_started_compute_workers++;
+    }
+
+    return 1;
+}
+
+
+
+void stop_compute_workers()
+{
+    pthread_mutex_lock(&mutex_compute);
+    compute_workers_stop = 1;
+    pthread_cond_broadcast(&cond_compute_available);
+    pthread_mutex_unlock(&mutex_compute);
+
+    for (int i = 0; i < num_of_started_compute_workers; i++)
+    {
+        if (pthread_join(compute_workers[i], NULL) != 0)
+            perror("STOP COMPUTE WORKERS could not join worker");
+    }
+
+    num_of_started_compute_workers = 0;
+}
+
+
+
+void* compute_worker(void* arg)
+{
+    pthread_mutex_lock(&mutex_compute);
+
+    while (1)
+    {
+        while (compute_queue_head == NULL && !compute_workers_stop)
+            pthread_cond_wait(&cond_compute_available, &mutex_compute);
+
+        if (compute_queue_head == NULL) // stopped and nothing is left
+            break;
+
+        struct parallel_run* p_run = compute_queue_head;
+        int i = claim_parallel_task(p_run);
+
+        pthread_mutex_unlock(&mutex_compute);
+        p_run->function(p_run->tasks + i * p_run->task_size);
+        pthread_mutex_lock(&mutex_compute);
+
+        // the run belongs to the calling thread, it may return right after the broadcast
+        if (++p_run->num_of_done == p_run->num_of_tasks)
+            pthread_cond_broadcast(&cond_compute_done);
+    }
+
+    pthread_mutex_unlock(&mutex_compute);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// vector groups
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int acquire_vector_group(struct vector_group* p_group, char** names, int num_of_names, 
+    struct vector_mutex** p_named_vectors)
+{
+    char* sorted_names[MAX_GROUP_VECTORS];
+    p_group->num_of_vectors = 0;
+    p_group->num_of_locked = 0;
+
+    // distinct names in order, so groups sharing vectors always lock them in the same order
+    for (int i = 0; i < num_of_names; i++)
+    {
+        int pos = 0;
+        while (pos < p_group->num_of_vectors && strcmp(sorted_names[pos], names[i]) < 0)
+            pos++;
+
+        if (pos < p_group->num_of_vectors && strcmp(sorted_names[pos], names[i]) == 0)
+            continue;
+
+        for (int j = p_group->num_of_vectors; j > pos; j--)
+            sorted_names[j] = sorted_names[j - 1];
+
+        sorted_names[pos] = names[i];
+        p_group->num_of_vectors++;
+    }
+
+    int res = 1;
+    int num_of_obtained = 0;
+
+    for (int i = 0; i < p_group->num_of_vectors && res; i++)
+    {
+        struct vector_mutex* p_vec_mutex;
+        if ((p_vec_mutex = get_vector_mutex(sorted_names[i])) == NULL) // no such vector
+        {
+            res = 0;
+            break;
+        }
+
+        p_group->vectors[i] = p_vec_mutex;
+        num_of_obtained++;
+
+        // shared, the elements are protected by their stripe locks
+        if (pthread_rwlock_rdlock(&p_vec_mutex->lock) != 0)
+        {
+            res = 0;
+            perror("ACQUIRE VECTOR GROUP could not lock the mutex");
+            break;
+        }
+
+        p_group->num_of_locked++;
+
+        // destroyed while it was pinned
+        if (p_vec_mutex->to_remove)
+            res = 0;
+        else if (!open_vector_file(p_vec_mutex))
+        {
+            res = 0;
+            printf("ACQUIRE VECTOR GROUP could not open the vector file\n");
+        }
+    }
+
+    if (!res)
+    {
+        p_group->num_of_vectors = num_of_obtained;
+        release_vector_group(p_group);
+        return 0;
+    }
+
+    for (int i = 0; i < num_of_names; i++)
+    {
+        for (int j = 0; j < p_group->num_of_vectors; j++)
+        {
+            if (strcmp(p_group->vectors[j]->vector_name, names[i]) == 0)
+                p_named_vectors[i] = p_group->vectors[j];
+        }
+    }
+
+    return 1;
+}
+
+
+
+int release_vector_group(struct vector_group* p_group)
+{
+    int res = 1;
+
+    for (int i = 0; i < p_group->num_of_vectors; i++)
+    {
+        if (i < p_group->num_of_locked && pthread_rwlock_unlock(&p_group->vectors[i]->lock) != 0)
+        {
+            res = 0;
+            perror("RELEASE VECTOR GROUP could not unlock the mutex");
+        }
+
+        if (!release_vector_mutex(p_group->vectors[i]))
+            res = 0;
+    }
+
+    p_group->num_of_vectors = 0;
+    p_group->num_of_locked = 0;
+
+    return res;
+}
+
+
+
+int lock_vector_group_elems(struct vector_group* p_group, struct vector_mutex* p_exclusive)
+{
+    for (int i = 0; i < p_group->num_of_vectors; i++)
+    {
+        struct vector_mutex* p_vec_mutex = p_group->vectors[i];
+
+        if (p_vec_mutex->size > 0 && 
+            !lock_stripes(p_vec_mutex, 0, p_vec_mutex->size - 1, p_vec_mutex == p_exclusive))
+        {
+            for (int j = 0; j < i; j++)
+            {
+                if (p_group->vectors[j]->size > 0)
+                    unlock_stripes(p_group->vectors[j], 0, p_group->vectors[j]->size - 1);
+            }
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+
+void unlock_vector_group_elems(struct vector_group* p_group)
+{
+    for (int i = 0; i < p_group->num_of_vectors; i++)
+    {
+        if (p_group->vectors[i]->size > 0)
+            unlock_stripes(p_group->vectors[i], 0, p_group->vectors[i]->size - 1);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// element-wise operations
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void* run_elementwise_task(void* p_elementwise_task)
+{
+    struct elementwise_task* p_task = (struct elementwise_task*) p_elementwise_task;
+
+    int32_t* x = malloc(ELEMENTWISE_CHUNK_LEN * sizeof(int32_t));
+    int32_t* y = malloc(ELEMENTWISE_CHUNK_LEN * sizeof(int32_t));
+
+    if (x == NULL || y == NULL)
+    {
+        p_task->res = 0;
+        perror("RUN ELEMENTWISE TASK could not allocate chunks");
+    }
+
+    // the result is computed into x and written to the target with its log record
+    for (int pos = p_task->start; pos < p_task->end && p_task->res; pos += ELEMENTWISE_CHUNK_LEN)
+    {
+        int len = p_task->end - pos < ELEMENTWISE_CHUNK_LEN ? p_task->end - pos : 
+            ELEMENTWISE_CHUNK_LEN;
+
+        if (!read_vector_range(p_task->p_x, pos, len, x) ||
+            (p_task->p_y != NULL && !read_vector_range(p_task->p_y, pos, len, y)))
+        {
+            p_task->res = 0;
+        }
+        else
+        {
+            elementwise_elems(p_task->op, x, y, p_task->k, x, len);
+            p_task->res = write_vector_range(p_task->p_target, pos, len, x);
+        }
+    }
+
+    free(x);
+    free(y);
+
+    // the task may run in another thread, whose pending log records nobody would commit
+    p_task->wal_pending_lsn = wal_pending_lsn;
+    wal_pending_lsn = 0;
+
+    return NULL;
+}
+
+
+
+int apply_elementwise_to_vectors(struct elementwise_msg* p_msg)
+{
+    if (p_msg->op < ELEMENTWISE_OP_ADD || p_msg->op > ELEMENTWISE_OP_MAX)
+        return ELEMENTWISE_FAIL;
+
+    // y is not used by scale
+    char* names[] = { p_msg->target, p_msg->x, p_msg->y };
+    int num_of_names = p_msg->op == ELEMENTWISE_OP_SCALE ? 2 : 3;
+    struct vector_mutex* named_vectors[3] = { NULL, NULL, NULL };
+    struct vector_group group;
+
+    if (!acquire_vector_group(&group, names, num_of_names, named_vectors))
+    {
+        commit_wal();
+        return ELEMENTWISE_FAIL;
+    }
+
+    int res = ELEMENTWISE_SUCCESS;
+    int size = named_vectors[0]->size;
+
+    if (named_vectors[1]->size != size || (num_of_names == 3 && named_vectors[2]->size != size))
+        res = ELEMENTWISE_FAIL;
+    // the whole target at once, so nobody sees it half computed
+    else if (lock_vector_group_elems(&group, named_vectors[0]))
+    {
+        struct elementwise_task tasks[PARALLEL_MAX_TASKS];
+        int num_of_tasks = get_num_of_parallel_tasks(size);
+        int task_len = (size + num_of_tasks - 1) / num_of_tasks;
+
+        for (int i = 0; i < num_of_tasks; i++)
+        {
+            tasks[i].p_target = named_vectors[0];
+            tasks[i].p_x = named_vectors[1];
+            tasks[i].p_y = named_vectors[2];
+            tasks[i].op = p_msg->op;
+            tasks[i].k = p_msg->k;
+            tasks[i].start = i * task_len < size ? i * task_len : size;
+            tasks[i].end = tasks[i].start + task_len < size ? tasks[i].start + task_len : size;
+            tasks[i].res = 1;
+            tasks[i].wal_pending_lsn = 0;
+        }
+
+        run_parallel_tasks(run_elementwise_task, tasks, sizeof(struct elementwise_task), 
+            num_of_tasks);
+
+        for (int i = 0; i < num_of_tasks; i++)
+        {
+            if (!tasks[i].res)
+                res = ELEMENTWISE_FAIL;
+
+            // records of all tasks are committed below, before the response is sent
+            if (tasks[i].wal_pending_lsn > wal_pending_lsn)
+                wal_pending_lsn = tasks[i].wal_pending_lsn;
+        }
+
+        unlock_vector_group_elems(&group);
+    }
+    else // couldn't lock stripes
+    {
+        res = ELEMENTWISE_FAIL;
+    }
+
+    if (!release_vector_group(&group))
+        res = ELEMENTWISE_FAIL;
+
+    if (!commit_wal())
+        res = ELEMENTWISE_FAIL;
+
+    return res;
+}
+
+
+
+void* elementwise(void* p_elementwise_msg)
+{
+    struct elementwise_msg* p_msg = (struct elementwise_msg*) p_elementwise_msg;
+
+    int response = apply_elementwise_to_vectors(p_msg);
+
+    send_op_response(p_msg->resp_queue_name, response, 0, p_msg->request_id);
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// distances
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int32_t* get_vector_chunk(struct vector_mutex* p_vec_mutex, int pos, int len, int32_t* buf)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (p_vec_mutex->p_data != NULL) // mapped or cached, no copy
+        return p_vec_mutex->p_data + pos;
+#endif
+
+    return read_vector_range(p_vec_mutex, pos, len, buf) ? buf : NULL;
+}
+
+
+
+void accumulate_distance(int metric, int32_t* a, int32_t* b, int len, struct distance_acc* p_acc)
+{
+    if (metric == METRIC_DOT)
+        p_acc->dot += dot_elems(a, b, len);
+    else if (metric == METRIC_L1)
+        p_acc->diff += abs_diff_elems(a, b, len);
+    else if (metric == METRIC_L2)
+        p_acc->diff += sq_diff_elems(a, b, len);
+    else // METRIC_COSINE
+    {
+        p_acc->dot += dot_elems(a, b, len);
+        p_acc->norm_a += dot_elems(a, a, len);
+        p_acc->norm_b += dot_elems(b, b, len);
+    }
+}
+
+
+
+int compare_vectors(int metric, struct vector_mutex* p_a, int32_t* a_elems, 
+    struct vector_mutex* p_b, double* p_value)
+{
+    int res = 1;
+    struct distance_acc acc = { 0, 0, 0, 0 };
+
+    int32_t* a_buf = malloc(DISTANCE_CHUNK_LEN * sizeof(int32_t));
+    int32_t* b_buf = malloc(DISTANCE_CHUNK_LEN * sizeof(int32_t));
+
+    if (a_buf == NULL || b_buf == NULL)
+    {
+        res = 0;
+        perror("COMPARE VECTORS could not allocate chunks");
+    }
+
+    for (int pos = 0; pos < p_b->size && res; pos += DISTANCE_CHUNK_LEN)
+    {
+        int len = p_b->size - pos < DISTANCE_CHUNK_LEN ? p_b->size - pos : DISTANCE_CHUNK_LEN;
+        int32_t* a = a_elems != NULL ? a_elems + pos : get_vector_chunk(p_a, pos, len, a_buf);
+        int32_t* b = get_vector_chunk(p_b, pos, len, b_buf);
+
+        if (a == NULL || b == NULL)
+            res = 0;
+        else
+            accumulate_distance(metric, a, b, len, &acc);
+    }
+
+    free(a_buf);
+    free(b_buf);
+
+    if (!res)
+        return 0;
+
+    if (metric == METRIC_DOT)
+        *p_value = acc.dot;
+    else if (metric == METRIC_L1)
+        *p_value = acc.diff;
+    else if (metric == METRIC_L2)
+        *p_value = sqrt(acc.diff);
+    else if (acc.norm_a == 0 || acc.norm_b == 0) // cosine of a zero vector is undefined
+        res = 0;
+    else
+        *p_value = acc.dot / (sqrt(acc.norm_a) * sqrt(acc.norm_b));
+
+    return res;
+}
+
+
+
+int compute_distance(struct distance_msg* p_msg, double* p_value)
+{
+    if (p_msg->metric < METRIC_DOT || p_msg->metric > METRIC_COSINE)
+        return DISTANCE_FAIL;
+
+    char* names[] = { p_msg->a, p_msg->b };
+    struct vector_mutex* named_vectors[2];
+    struct vector_group group;
+
+    if (!acquire_vector_group(&group, names, 2, named_vectors))
+        return DISTANCE_FAIL;
+
+    int res = DISTANCE_SUCCESS;
+
+    if (named_vectors[0]->size != named_vectors[1]->size)
+        res = DISTANCE_FAIL;
+    else if (lock_vector_group_elems(&group, NULL))
+    {
+        if (!compare_vectors(p_msg->metric, named_vectors[0], NULL, named_vectors[1], p_value))
+            res = DISTANCE_FAIL;
+
+        unlock_vector_group_elems(&group);
+    }
+    else // couldn't lock stripes
+    {
+        res = DISTANCE_FAIL;
+    }
+
+    if (!release_vector_group(&group))
+        res = DISTANCE_FAIL;
+
+    return res;
+}
+
+
+
+void* distance(void* p_distance_msg)
+{
+    struct distance_msg* p_msg = (struct distance_msg*) p_distance_msg;
+
+    struct distance_resp_msg response;
+    response.value = 0;
+    response.request_id = p_msg->request_id;
+    response.error = compute_distance(p_msg, &response.value);
+
+    // send response
+    mqd_t q_resp;
+    if ((q_resp = mq_open(p_msg->resp_queue_name, O_WRONLY)) == -1)
+    {
+        perror("RESPONSE ERROR could not open queue for sending response");
+    }
+    else
+    {
+        if (mq_send(q_resp, (char*) &response, DISTANCE_RESP_MSG_SIZE, 0) == -1)
+        {
+            perror("RESPONSE ERROR could not send response");
+        }
+
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
+        }
+    }
+
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// nearest vectors
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+void insert_nearest(int metric, int k, int* indexes, double* values, int* p_len, int index, 
+    double value)
+{
+    // similarities are nearer when greater, distances when smaller
+    int greater_is_nearer = metric == METRIC_DOT || metric == METRIC_COSINE;
+    int pos = *p_len;
+
+    while (pos > 0 && (greater_is_nearer ? value > values[pos - 1] : value < values[pos - 1]))
+        pos--;
+
+    if (pos >= k) // not among the k nearest
+        return;
+
+    int last = *p_len < k ? *p_len : k - 1;
+    for (int i = last; i > pos; i--)
+    {
+        indexes[i] = indexes[i - 1];
+        values[i] = values[i - 1];
+    }
+
+    indexes[pos] = index;
+    values[pos] = value;
+
+    if (*p_len < k)
+        (*p_len)++;
+}
+
+
+
+void* run_nearest_task(void* p_nearest_task)
 {
-    printf("distributed vector server started\n");
+    struct nearest_task* p_task = (struct nearest_task*) p_nearest_task;
+    struct nearest_msg* p_msg = p_task->p_msg;
 
-    if (init() != 1)
+    for (int i = p_task->first; i < p_task->last; i++)
     {
-        perror("INIT could not initialize server");
-        exit(1);
-    }
+        char* name = p_msg->candidates[i];
+        struct vector_mutex* p_candidate;
+        struct vector_group group;
+        double value;
 
-    if (start_reading_user_input() == 0)
-    {
-        // messages to be retrived from requests
-        struct init_msg in_init_msg;
-        struct set_msg in_set_msg;
-        struct get_msg in_get_msg;
-        struct destroy_msg in_destroy_msg;
+        // one candidate at a time, so only one vector is locked by the task
+        if (!acquire_vector_group(&group, &name, 1, &p_candidate))
+            continue;
 
-        // listen for requests till user wirtes exit command
-        while (strcmp(user_input, EXIT_COMMAND) != 0)
+        if (p_candidate->size == p_task->size && lock_vector_group_elems(&group, NULL))
         {
-            // read messages in all queues if available
-            if (mq_receive(q_init_vector, (char*) &in_init_msg, INIT_MSG_SIZE, NULL) != -1)
-            {
-                if (start_request_thread(init_vector, &in_init_msg) != REQUEST_THREAD_CREATE_SUCCESS)
-                {
-                    printf("REQUEST THREAD could not create thread for init vector request\n");
-                }
-            }
-
-            if (mq_receive(q_set, (char*) &in_set_msg, SET_MSG_SIZE, NULL) != -1)
+            if (compare_vectors(p_msg->metric, NULL, p_task->query, p_candidate, &value))
             {
-                if (start_request_thread(set, &in_set_msg) != REQUEST_THREAD_CREATE_SUCCESS)
-                {
-                    printf("REQUEST THREAD could not create thread for set value request\n");
-                }
+                insert_nearest(p_msg->metric, p_msg->k, p_task->indexes, p_task->values, 
+                    &p_task->len, i, value);
             }
 
-            if (mq_receive(q_get, (char*) &in_get_msg, GET_MSG_SIZE, NULL) != -1)
-            {
-                if (start_request_thread(get, &in_get_msg) != REQUEST_THREAD_CREATE_SUCCESS)
-                {
-                    printf("REQUEST THREAD could not create thread for get value request\n");
-                }
-            }
+            unlock_vector_group_elems(&group);
+        }
 
-            if (mq_receive(q_destroy, (char*) &in_destroy_msg, DESTROY_MSG_SIZE, NULL) != -1)
-            {
-                if (start_request_thread(destroy, &in_destroy_msg) != REQUEST_THREAD_CREATE_SUCCESS)
-                {
-                    printf("REQUEST THREAD could not create thread for destroy request\n");
-                }
-            }
-        } // end main while
-    }
-    else
-    {
-        printf("USER INPUT READ could not start reading for user input\n");
+        release_vector_group(&group);
     }
 
-    // clean up
-    if (pthread_mutex_destroy(&mutex_msg) != 0)
-        perror("CLEAN UP could not destroy mutex_msg");
-    if (pthread_cond_destroy(&cond_msg) != 0)
-        perror("CLEAN UP could not destroy cond_msg");
-    if (pthread_attr_destroy(&request_thread_attr) != 0)
-        perror("CLEAN UP could not destroy request_thread_attr");
-    if (pthread_mutex_destroy(&mutex_vec_mutex) != 0)
-        perror("CLEAN UP could not destroy mutex_vec_mutex");
-
-    if (!destroy_vector_mutexes())
-        printf("CLEAN UP could not destroy vector files mutexes\n");
-
-    if (!close_queues())
-        printf("CLEAN UP could not close queues\n");
+    return NULL;
 }
 
 
 
-int init()
+int find_nearest_vectors(struct nearest_msg* p_msg, struct nearest_resp_msg* p_resp)
 {
-    if (pthread_mutex_init(&mutex_msg, NULL) != 0)
+    if (p_msg->metric < METRIC_DOT || p_msg->metric > METRIC_COSINE || p_msg->k < 1 || 
+        p_msg->k > MAX_NEAREST_K || p_msg->num_of_candidates < 0 || 
+        p_msg->num_of_candidates > MAX_NEAREST_CANDIDATES)
     {
-        perror("INIT could not init mutex_msg");
-        return 0;
+        return NEAREST_FAIL;
     }
 
-    if (pthread_cond_init(&cond_msg, NULL) != 0)
-    {
-        perror("INIT could not init cond_msg");
-        return 0;
-    }
+    char* name = p_msg->query;
+    struct vector_mutex* p_query;
+    struct vector_group group;
 
-    if (pthread_attr_init(&request_thread_attr) != 0)
-    {
-        perror("INIT could not init request_thread_attr");
-        return 0;
-    }
+    if (!acquire_vector_group(&group, &name, 1, &p_query))
+        return NEAREST_FAIL;
 
-    if (pthread_attr_setdetachstate(&request_thread_attr, PTHREAD_CREATE_DETACHED) != 0)
-    {
-        perror("INIT could not set detach state for request_thread_attr");
-        return 0;
-    }
+    // the query is copied, so it isn't locked together with candidates
+    int res = NEAREST_SUCCESS;
+    int size = p_query->size;
+    int32_t* query = malloc(((size_t) size + 1) * sizeof(int32_t));
 
-    if (!initialize_vectors_folder())
+    if (query == NULL)
     {
-        printf("INIT could not initialize vectors folder\n");
-        return 0;
+        res = NEAREST_FAIL;
+        perror("FIND NEAREST VECTORS could not allocate the query");
     }
+    else if (lock_vector_group_elems(&group, NULL))
+    {
+        if (size > 0 && !read_vector_range(p_query, 0, size, query))
+            res = NEAREST_FAIL;
 
-    if (!initialize_vector_mutexes())
+        unlock_vector_group_elems(&group);
+    }
+    else // couldn't lock stripes
     {
-        printf("INIT coud not initialize vector mutexes\n");
-        return 0;
+        res = NEAREST_FAIL;
     }
 
-    if (!initialize_request_queues())
+    if (!release_vector_group(&group))
+        res = NEAREST_FAIL;
+
+    if (res == NEAREST_SUCCESS)
     {
-        printf("INIT could not initialize request queues\n");
-        return 0;
+        struct nearest_task tasks[PARALLEL_MAX_TASKS];
+        int64_t num_of_elems = (int64_t) size * p_msg->num_of_candidates;
+        int num_of_tasks = get_num_of_parallel_tasks(num_of_elems < INT_MAX ? 
+            (int) num_of_elems : INT_MAX);
+
+        if (num_of_tasks > p_msg->num_of_candidates)
+            num_of_tasks = p_msg->num_of_candidates > 0 ? p_msg->num_of_candidates : 1;
+
+        int task_len = (p_msg->num_of_candidates + num_of_tasks - 1) / num_of_tasks;
+
+        for (int i = 0; i < num_of_tasks; i++)
+        {
+            tasks[i].p_msg = p_msg;
+            tasks[i].query = query;
+            tasks[i].size = size;
+            tasks[i].first = i * task_len < p_msg->num_of_candidates ? i * task_len : 
+                p_msg->num_of_candidates;
+            tasks[i].last = tasks[i].first + task_len < p_msg->num_of_candidates ? 
+                tasks[i].first + task_len : p_msg->num_of_candidates;
+            tasks[i].len = 0;
+        }
+
+        run_parallel_tasks(run_nearest_task, tasks, sizeof(struct nearest_task), num_of_tasks);
+
+        // merge the k nearest of every task
+        p_resp->len = 0;
+        for (int i = 0; i < num_of_tasks; i++)
+        {
+            for (int j = 0; j < tasks[i].len; j++)
+            {
+                insert_nearest(p_msg->metric, p_msg->k, p_resp->indexes, p_resp->values, 
+                    &p_resp->len, tasks[i].indexes[j], tasks[i].values[j]);
+            }
+        }
     }
 
-    return 1;
+    free(query);
+
+    return res;
 }
 
 
 
-int initialize_request_queues()
+void* nearest(void* p_nearest_msg)
 {
-    // init queue
-    if (initialize_init_vector_queue() != QUEUE_INIT_SUCCESS)
+    struct nearest_msg* p_msg = (struct nearest_msg*) p_nearest_msg;
+
+    struct nearest_resp_msg response;
+    response.len = 0;
+    response.request_id = p_msg->request_id;
+    response.error = find_nearest_vectors(p_msg, &response);
+
+    // send response
+    mqd_t q_resp;
+    if ((q_resp = mq_open(p_msg->resp_queue_name, O_WRONLY)) == -1)
     {
-        printf("INITIALIZE REQUEST QUEUES could not open init vector queue");
-        return 0;
+        perror("RESPONSE ERROR could not open queue for sending response");
     }
-
-    // set queue
-    if (initialize_set_queue() != QUEUE_INIT_SUCCESS)
+    else
     {
-        perror("INITIALIZE REQUEST QUEUES could not open set queue");
-        return 0;
+        if (mq_send(q_resp, (char*) &response, NEAREST_RESP_MSG_SIZE, 0) == -1)
+        {
+            perror("RESPONSE ERROR could not send response");
+        }
+
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
+        }
     }
 
-    // get queue
-    if (initialize_get_queue() != QUEUE_INIT_SUCCESS)
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// bulk import and export
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+int resolve_transfer_path(struct transfer_msg* p_msg)
+{
+    char vectors_folder[PATH_MAX];
+    char resolved[PATH_MAX];
+
+    if (realpath(VECTORS_FOLDER, vectors_folder) == NULL)
     {
-        perror("INITIALIZE REQUEST QUEUES could not open get queue");
+        perror("RESOLVE TRANSFER PATH could not resolve the vectors folder");
         return 0;
     }
 
-    // destroy queue
-    if (initialize_destroy_queue() != QUEUE_INIT_SUCCESS)
+    if (realpath(p_msg->path, resolved) == NULL)
     {
-        perror("INITIALIZE REQUEST QUEUES could not open destroy queue");
-        return 0;
-    }
+        char* p_slash = strrchr(p_msg->path, '/');
 
-    return 1;
-}
+        // only a missing file to export, in an existing folder, is fine
+        if (p_msg->op != TRANSFER_OP_EXPORT || errno != ENOENT || p_slash == NULL || 
+            strcmp(p_slash + 1, "") == 0 || strcmp(p_slash + 1, ".") == 0 || 
+            strcmp(p_slash + 1, "..") == 0)
+        {
+            perror("RESOLVE TRANSFER PATH could not resolve the path");
+            return 0;
+        }
 
+        char folder[MAX_TRANSFER_PATH_LEN];
+        size_t folder_len = p_slash - p_msg->path;
+        memcpy(folder, p_msg->path, folder_len);
+        folder[folder_len] = '\0';
 
+        if (realpath(folder_len > 0 ? folder : "/", resolved) == NULL)
+        {
+            perror("RESOLVE TRANSFER PATH could not resolve the folder");
+            return 0;
+        }
 
-int add_vector_mutex(char* vec_name)
-{
-    struct vector_mutex* p_vec_mut = (struct vector_mutex*) malloc(sizeof(struct vector_mutex));
+        size_t resolved_len = strlen(resolved);
+        if (resolved_len + 1 + strlen(p_slash + 1) >= MAX_TRANSFER_PATH_LEN)
+        {
+            printf("RESOLVE TRANSFER PATH the path is too long\n");
+            return 0;
+        }
 
-    strcpy(p_vec_mut->vector_name, vec_name);
-    p_vec_mut->num_of_waiting_threads = 0;
-    p_vec_mut->to_remove = 0;
+        if (resolved_len > 1) // not the root folder
+            strcat(resolved, "/");
+        strcat(resolved, p_slash + 1);
+    }
+    else if (strlen(resolved) >= MAX_TRANSFER_PATH_LEN)
+    {
+        printf("RESOLVE TRANSFER PATH the path is too long\n");
+        return 0;
+    }
 
-    if (pthread_mutex_init(&p_vec_mut->mutex, NULL) != 0)
+    size_t vectors_folder_len = strlen(vectors_folder);
+    if (strncmp(resolved, vectors_folder, vectors_folder_len) == 0 && 
+        (resolved[vectors_folder_len] == '\0' || resolved[vectors_folder_len] == '/'))
     {
-        printf("ADD VECTOR MUTEX could not initialize vector mutex\n");
+        printf("RESOLVE TRANSFER PATH %s is inside the vectors folder\n", resolved);
         return 0;
     }
 
-    vector_add(&vector_mutexes, p_vec_mut);
+    strcpy(p_msg->path, resolved);
 
     return 1;
 }
 
 
 
-int initialize_vector_mutexes()
+int open_transfer_stream(struct transfer_stream* p_stream, struct transfer_msg* p_msg)
 {
-    int res = 1;
+    memset(p_stream, 0, sizeof(struct transfer_stream));
+    p_stream->format = p_msg->format;
+    p_stream->fd = -1;
 
-    DIR* vec_dir;
-    struct dirent* vec_dir_ent;
+    int res = 1;
 
-    if ((vec_dir = opendir(VECTORS_FOLDER)) != NULL) // open the directory with vectors
+    if (p_msg->format == TRANSFER_FORMAT_SHM)
     {
-        vector_mutexes = vector_create();
+        p_stream->shm_len = p_msg->len;
 
-        int extension_len = strlen(VECTOR_FILE_EXTENSION);      // length of vector file extension
-        char extension[extension_len + 1];                      // vector file extension; + 1 because of \0
-        extension[extension_len] = '\0';
-        char f_name[MAX_VECTOR_NAME_LEN + extension_len + 1];   // vector file name with extension
-        int f_name_len = 0;
-        char f_name_no_extension[MAX_VECTOR_NAME_LEN];          // vector file name with no extension
-        int f_name_no_extension_len = 0;
+        struct stat shm_stat;
+        size_t num_of_bytes = (size_t) p_msg->len * sizeof(int32_t);
+        int fd = shm_open(p_msg->path, O_RDWR, 0);
 
-        while ((vec_dir_ent = readdir(vec_dir)) != NULL) // read all files in the vector directory
+        if (fd == -1)
         {
-            strcpy(f_name, vec_dir_ent->d_name);
-            f_name_len = strlen(f_name);
+            res = 0;
+            perror("OPEN TRANSFER STREAM could not open the shared memory");
+        }
+        else if (p_msg->len < 1 || fstat(fd, &shm_stat) != 0 || 
+            shm_stat.st_size < (off_t) num_of_bytes)
+        {
+            res = 0;
+            printf("OPEN TRANSFER STREAM shared memory is too small\n");
+        }
+        else if ((p_stream->p_shm = mmap(NULL, num_of_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, 
+            fd, 0)) == MAP_FAILED)
+        {
+            res = 0;
+            p_stream->p_shm = NULL;
+            perror("OPEN TRANSFER STREAM could not map the shared memory");
+        }
 
-            if (f_name_len > extension_len) // ignore non vector files (too short name)
-            {
-                // obtain file extension
-                strncpy(extension, f_name + f_name_len - extension_len, extension_len);
-                
-                if (strcmp(extension, VECTOR_FILE_EXTENSION) == 0)  // ignore files with wrong extension
-                {
-                    f_name_no_extension_len = f_name_len - extension_len;
-                    // cut just vector name - ignore file extension
-                    strncpy(f_name_no_extension, f_name, f_name_no_extension_len);
-                    // fininsh the f_name_no_extension with string end character
-                    f_name_no_extension[f_name_no_extension_len] = '\0';
-                    
-                    if (!add_vector_mutex(f_name_no_extension))
-                    {
-                        res = 0;
-                        printf("INITIALIZE VECTOR MUTEXES could not add the mutex to the list\n");
-                    }
-                }
-            } // end if (f_name_len > extension_len)
-        } // end while ((vec_dir_ent = readdir(vec_dir)) != NULL)
+        if (fd != -1)
+            close(fd); // the mapping stays valid
+    }
+    else
+    {
+        // the path is resolved, a symbolic link put in its place meanwhile isn't followed
+        int flags = p_msg->op == TRANSFER_OP_IMPORT ? O_RDONLY | O_NOFOLLOW : 
+            O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW;
 
-        if (closedir(vec_dir) != 0)
+        if ((p_stream->fd = open(p_msg->path, flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) == -1)
         {
             res = 0;
-            perror("INITIALIZE VECTOR MUTEXES could not close vectors directory");
+            perror("OPEN TRANSFER STREAM could not open the file");
+        }
+        else if (p_msg->format == TRANSFER_FORMAT_TEXT && 
+            (p_stream->text = malloc(TRANSFER_TEXT_BUFFER_SIZE)) == NULL)
+        {
+            res = 0;
+            perror("OPEN TRANSFER STREAM could not allocate the text buffer");
         }
     }
-    else // couldn't open the vector's directory
+
+    if (!res)
+        close_transfer_stream(p_stream);
+
+    return res;
+}
+
+
+
+int close_transfer_stream(struct transfer_stream* p_stream)
+{
+    int res = 1;
+
+    if (p_stream->p_shm != NULL && munmap(p_stream->p_shm, p_stream->shm_len * sizeof(int32_t)))
     {
         res = 0;
-        perror("INITIALIZE VECTOR MUTEXES could not open the vectors directory");
+        perror("CLOSE TRANSFER STREAM could not unmap the shared memory");
     }
 
+    if (p_stream->fd != -1 && close(p_stream->fd) != 0)
+    {
+        res = 0;
+        perror("CLOSE TRANSFER STREAM could not close the file");
+    }
+
+    free(p_stream->text);
+
+    p_stream->p_shm = NULL;
+    p_stream->fd = -1;
+    p_stream->text = NULL;
+
     return res;
 }
 
 
 
-int initialize_vectors_folder()
+int read_transfer_bytes(int fd, char* buf, size_t len)
 {
-    struct stat st = {0};
+    size_t done = 0;
 
-    // if the directory doesn't exist
-    if (stat(VECTORS_FOLDER, &st) == -1)
+    while (done < len)
     {
-        if (mkdir(VECTORS_FOLDER, S_IRWXU) != 0)
+        ssize_t n = read(fd, buf + done, len - done);
+
+        if (n == -1 && errno == EINTR)
+            continue;
+        else if (n == -1)
         {
-            perror("INITIALIZE VECTORS FOLDER could not create the vectors folder");
-            return 0;
+            perror("READ TRANSFER BYTES could not read the file");
+            return -1;
         }
+        else if (n == 0) // end of file
+            break;
+
+        done += n;
     }
 
-    return 1;
+    return (int) done;
 }
 
 
 
-int destroy_vector_mutexes()
+int write_transfer_bytes(int fd, char* buf, size_t len)
 {
-    int res = 1;
+    size_t done = 0;
 
-    int size = vector_size(vector_mutexes);
-    for (int i = 0; i < size; i++)
+    while (done < len)
     {
-        if (pthread_mutex_destroy(&vector_mutexes[i]->mutex) != 0)
+        ssize_t n = write(fd, buf + done, len - done);
+
+        if (n == -1 && errno == EINTR)
+            continue;
+        else if (n <= 0)
         {
-            perror("DESTROY VECTOR MUTEXES cannot destroy mutex");
-            printf("the mutex which could not be destroyed is for vector: %s\n", 
-                vector_mutexes[i]->vector_name);
-            
-            res = 0;
+            perror("WRITE TRANSFER BYTES could not write the file");
+            return 0;
         }
 
-        free(vector_mutexes[i]);
+        done += n;
     }
 
-    vector_free(vector_mutexes);
-
-    return res;
+    return 1;
 }
 
 
 
-struct vector_mutex* get_vector_mutex(char* vector_name)
+int parse_text_elem(char* line, int len, int32_t* p_value)
 {
-    struct vector_mutex* res = NULL;
+    char text[TRANSFER_MAX_LINE_LEN + 1];
+    int start = 0;
 
-    if (pthread_mutex_lock(&mutex_vec_mutex) == 0)
-    {
-        int size = vector_size(vector_mutexes);
-        struct vector_mutex* p_vec_mutex = NULL;
+    // surrounding white space, e.g. \r of files written on windows, is ignored
+    while (start < len && isspace((unsigned char) line[start]))
+        start++;
 
-        for (int i = 0; i < size; i++)
-        {
-            p_vec_mutex = vector_mutexes[i];
+    while (len > start && isspace((unsigned char) line[len - 1]))
+        len--;
 
-            if (strcmp(p_vec_mutex->vector_name, vector_name) == 0 &&
-                !p_vec_mutex->to_remove)
-            {
-                vector_mutexes[i]->num_of_waiting_threads++;
-                break;
-            }
+    if (len == start) // empty line
+        return 0;
 
-            p_vec_mutex = NULL;
-        }
-        
-        if (pthread_mutex_unlock(&mutex_vec_mutex) == 0)
-            res = p_vec_mutex;
-        else
-        {
-            if (p_vec_mutex != NULL)
-                p_vec_mutex->num_of_waiting_threads--;
-            perror("GET VECTOR MUTEX could not unlock mutex");
-        }        
-    }
-    else // couldn't lock mutex_vec_mutex
-        perror("GET VECTOR MUTEX could not lock mutex_vec_mutex");
+    if (len - start > TRANSFER_MAX_LINE_LEN)
+        return -1;
 
-    return res;
+    memcpy(text, line + start, len - start);
+    text[len - start] = '\0';
+
+    char* p_end;
+    errno = 0;
+    long long value = strtoll(text, &p_end, 10);
+
+    if (errno != 0 || *p_end != '\0' || value < INT32_MIN || value > INT32_MAX)
+        return -1;
+
+    *p_value = (int32_t) value;
+
+    return 1;
 }
 
 
 
-int unlock_vector_mutex(struct vector_mutex* p_vector_mutex)
+int read_transfer_chunk(struct transfer_stream* p_stream, int32_t* values, int max_len)
 {
-    int res = 1;
+    int len = 0;
 
-    if (pthread_mutex_lock(&mutex_vec_mutex) == 0)
+    if (p_stream->format == TRANSFER_FORMAT_SHM)
     {
-        int initial_num_of_waiting_threads = p_vector_mutex->num_of_waiting_threads;
+        len = p_stream->shm_len - p_stream->num_of_elems < max_len ? 
+            p_stream->shm_len - p_stream->num_of_elems : max_len;
 
-        p_vector_mutex->num_of_waiting_threads--;
+        // copied, the buffer of the client must not be changed by write_vector_range
+        memcpy(values, p_stream->p_shm + p_stream->num_of_elems, (size_t) len * sizeof(int32_t));
+    }
+    else if (p_stream->format == TRANSFER_FORMAT_BINARY)
+    {
+        int n = read_transfer_bytes(p_stream->fd, (char*) values, (size_t) max_len * 
+            sizeof(int32_t));
 
-        // if marked to remove and no more threads are waiting remove it and free space
-        if (p_vector_mutex->to_remove == 1 && p_vector_mutex->num_of_waiting_threads == 0)
+        if (n < 0 || n % sizeof(int32_t) != 0) // failed or the file ends inside an element
+        {
+            printf("READ TRANSFER CHUNK could not read whole elements\n");
+            return -1;
+        }
+
+        len = n / sizeof(int32_t);
+        for (int i = 0; i < len; i++)
+            values[i] = (int32_t) le32toh((uint32_t) values[i]);
+    }
+    else // TRANSFER_FORMAT_TEXT
+    {
+        while (len < max_len)
         {
-            int size = vector_size(vector_mutexes);
-            for (int i = 0; i < size; i++)
+            char* line = p_stream->text + p_stream->text_pos;
+            int available = p_stream->text_len - p_stream->text_pos;
+            char* p_newline = memchr(line, '\n', available);
+
+            if (p_newline == NULL && !p_stream->text_eof) // the line continues in the file
             {
-                if (vector_mutexes[i] == p_vector_mutex)
+                if (available > TRANSFER_MAX_LINE_LEN)
                 {
-                    if (pthread_mutex_unlock(&p_vector_mutex->mutex) == 0)
-                    {
-                        vector_remove(vector_mutexes, i);
-                        free(p_vector_mutex);
-                    }
-                    else
-                    {
-                        res = 0;
-                        p_vector_mutex->num_of_waiting_threads = initial_num_of_waiting_threads;
-                        perror("UNLOCK VECTOR MUTEX could not unlock the requested mutex");
-                    }
+                    printf("READ TRANSFER CHUNK line is too long\n");
+                    return -1;
                 }
+
+                memmove(p_stream->text, line, available);
+                p_stream->text_len = available;
+                p_stream->text_pos = 0;
+
+                int n = read_transfer_bytes(p_stream->fd, p_stream->text + available, 
+                    TRANSFER_TEXT_BUFFER_SIZE - available);
+                if (n < 0)
+                    return -1;
+
+                p_stream->text_len += n;
+                p_stream->text_eof = n < TRANSFER_TEXT_BUFFER_SIZE - available;
+                continue;
             }
-        }
-        else
-        {
-            if (pthread_mutex_unlock(&p_vector_mutex->mutex) != 0)
+
+            if (p_newline == NULL && available == 0) // end of file
+                break;
+
+            // the last line may have no newline
+            int line_len = p_newline != NULL ? (int) (p_newline - line) : available;
+            int parse_res = parse_text_elem(line, line_len, &values[len]);
+
+            if (parse_res < 0)
             {
-                res = 0;
-                p_vector_mutex->num_of_waiting_threads = initial_num_of_waiting_threads;
-                perror("UNLOCK VECTOR MUTEX could not unlock the requested mutex, no remove");
+                printf("READ TRANSFER CHUNK invalid element after %d elements\n", 
+                    p_stream->num_of_elems + len);
+                return -1;
             }
-        }
-        
 
-        if (pthread_mutex_unlock(&mutex_vec_mutex) != 0)
-        {
-            res = 0;
-            p_vector_mutex->num_of_waiting_threads = initial_num_of_waiting_threads;
-            perror("UNLOCK VECTOR MUTEX could not unlock mutex_vec_mutex");
+            len += parse_res;
+            p_stream->text_pos += p_newline != NULL ? line_len + 1 : line_len;
         }
     }
-    else // couldn't lock mutex_vec_mutex
-        perror("UNLOCK VECTOR MUTEX could not lock mutex_vec_mutex");
 
-    return res;
+    p_stream->num_of_elems += len;
+
+    return len;
 }
 
 
 
-int get_vector_mutex_idx(char* vector_name)
+int write_transfer_chunk(struct transfer_stream* p_stream, int32_t* values, int len)
 {
-    int size = vector_size(vector_mutexes);
-    for (int i = 0; i < size; i++)
+    int res = 1;
+
+    if (p_stream->format == TRANSFER_FORMAT_SHM)
+    {
+        memcpy(p_stream->p_shm + p_stream->num_of_elems, values, (size_t) len * sizeof(int32_t));
+    }
+    else if (p_stream->format == TRANSFER_FORMAT_BINARY)
     {
-        if (strcmp(vector_mutexes[i]->vector_name, vector_name) == 0)
+        for (int i = 0; i < len; i++)
+            values[i] = (int32_t) htole32((uint32_t) values[i]);
+
+        res = write_transfer_bytes(p_stream->fd, (char*) values, (size_t) len * sizeof(int32_t));
+    }
+    else // TRANSFER_FORMAT_TEXT
+    {
+        int text_len = 0;
+
+        for (int i = 0; i < len && res; i++)
         {
-            return i;
+            // room for the longest element, "-2147483648\n"
+            if (text_len > TRANSFER_TEXT_BUFFER_SIZE - 16)
+            {
+                res = write_transfer_bytes(p_stream->fd, p_stream->text, text_len);
+                text_len = 0;
+            }
+
+            text_len += sprintf(p_stream->text + text_len, "%d\n", values[i]);
         }
+
+        if (res)
+            res = write_transfer_bytes(p_stream->fd, p_stream->text, text_len);
     }
 
-    return -1;
+    p_stream->num_of_elems += len;
+
+    return res;
 }
 
 
 
-int mark_vector_mutex_to_remove(struct vector_mutex* p_vector_mutex)
+int stage_transfer_source(struct transfer_stream* p_stream, int32_t** p_elems)
 {
-    int res = 1;
-    
-    if (pthread_mutex_lock(&mutex_vec_mutex) == 0)
+    *p_elems = NULL;
+
+    if (p_stream->format == TRANSFER_FORMAT_SHM) // already in memory, reading it can't fail
+        return p_stream->shm_len;
+
+    // a binary file is read at once, unless it grows meanwhile
+    size_t capacity = TRANSFER_CHUNK_LEN;
+    struct stat file_stat;
+    if (p_stream->format == TRANSFER_FORMAT_BINARY && fstat(p_stream->fd, &file_stat) == 0)
     {
-        p_vector_mutex->to_remove = 1;
+        if (file_stat.st_size / sizeof(int32_t) > INT_MAX)
+            return -1;
+
+        capacity += file_stat.st_size / sizeof(int32_t);
+    }
+
+    int32_t* elems = NULL;
+    size_t num_of_elems = 0;
+    int len;
 
-        if (pthread_mutex_unlock(&mutex_vec_mutex) != 0)
+    do
+    {
+        if (elems == NULL || num_of_elems + TRANSFER_CHUNK_LEN > capacity)
         {
-            res = 0;
-            perror("MARK VECTOR MUTEX TO REMOVE could not unlock mutex");
+            size_t new_capacity = elems == NULL ? capacity : capacity * 2;
+            int32_t* new_elems = realloc(elems, new_capacity * sizeof(int32_t));
+
+            if (new_elems == NULL)
+            {
+                perror("STAGE TRANSFER SOURCE could not allocate the elements");
+                free(elems);
+                return -1;
+            }
+
+            elems = new_elems;
+            capacity = new_capacity;
         }
-    }
-    else
+
+        if ((len = read_transfer_chunk(p_stream, elems + num_of_elems, TRANSFER_CHUNK_LEN)) > 0)
+            num_of_elems += len;
+    } while (len > 0 && num_of_elems <= INT_MAX);
+
+    if (len < 0 || num_of_elems > INT_MAX)
     {
-        perror("MARK VECTOR MUTEX TO REMOVE could not lock mutex");
-        res = 0;
+        free(elems);
+        return -1;
     }
-    
-    return res;
+
+    *p_elems = elems;
+
+    return (int) num_of_elems;
 }
 
 
 
-int close_queues()
+int import_vector(struct transfer_msg* p_msg, struct transfer_stream* p_stream, int32_t* chunk)
 {
-    int res = 1;
+    // read whole, so a source of a wrong size or an invalid one doesn't change the vector
+    int32_t* elems;
+    int num_of_elems = stage_transfer_source(p_stream, &elems);
 
-    // close init vector queue
-    if (mq_close(q_init_vector) != 0)
-    {
-        perror("CLEAN UP could not close inint vector queue");
-        res = 0;
-    }
-    if (mq_unlink(INIT_VECTOR_QUEUE_NAME) != 0)
-    {
-        perror("CLEAN UP could not unlink init vector queue");
-        res = 0;
-    }
+    char* name = p_msg->name;
+    struct vector_mutex* p_vec_mutex;
+    struct vector_group group;
 
-    // close set queue
-    if (mq_close(q_set) != 0)
-    {
-        perror("CLEAN UP could not close set queue");
-        res = 0;
-    }
-    if (mq_unlink(SET_QUEUE_NAME) != 0)
+    // a missing vector is created with the size of the source, fails if it has another size
+    if (num_of_elems < 1 || 
+        create_vector(p_msg->name, num_of_elems, DURABILITY_DEFAULT) == VECTOR_CREATION_ERROR ||
+        !acquire_vector_group(&group, &name, 1, &p_vec_mutex))
     {
-        perror("CLEAN UP could not unlink set queue");
-        res = 0;
+        free(elems);
+        return TRANSFER_FAIL;
     }
 
-    // close get queue
-    if (mq_close(q_get) != 0)
+    int res = TRANSFER_SUCCESS;
+
+    if (p_vec_mutex->size != num_of_elems)
     {
-        perror("CLEAN UP could not close get queue");
-        res = 0;
+        res = TRANSFER_FAIL;
+        printf("IMPORT VECTOR %s has %d elements, the source has %d\n", p_msg->name, 
+            p_vec_mutex->size, num_of_elems);
     }
-    if (mq_unlink(GET_QUEUE_NAME) != 0)
+    // nobody sees the vector half imported
+    else if (lock_vector_group_elems(&group, p_vec_mutex))
     {
-        perror("CLEAN UP could not unlink get queue");
-        res = 0;
-    }
+        for (int pos = 0; pos < num_of_elems && res == TRANSFER_SUCCESS; 
+            pos += TRANSFER_CHUNK_LEN)
+        {
+            int len = num_of_elems - pos < TRANSFER_CHUNK_LEN ? 
+                num_of_elems - pos : TRANSFER_CHUNK_LEN;
 
-    // close destroy queue
-    if (mq_close(q_destroy) != 0)
-    {
-        perror("CLEAN UP could not close destroy queue");
-        res = 0;
+            // the staged elements may be changed by write_vector_range, they aren't used again
+            int32_t* values = elems != NULL ? elems + pos : chunk;
+            if (elems == NULL)
+                read_transfer_chunk(p_stream, chunk, len);
+
+            if (!write_vector_range(p_vec_mutex, pos, len, values))
+                res = TRANSFER_FAIL;
+        }
+
+        unlock_vector_group_elems(&group);
     }
-    if (mq_unlink(DESTROY_QUEUE_NAME) != 0)
+    else // couldn't lock stripes
     {
-        perror("CLEAN UP could not unlink destroy queue");
-        res = 0;
+        res = TRANSFER_FAIL;
     }
 
+    if (!release_vector_group(&group))
+        res = TRANSFER_FAIL;
+
+    free(elems);
+
     return res;
 }
 
 
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// request threads
-///////////////////////////////////////////////////////////////////////////////////////////////////
+int export_vector(struct transfer_msg* p_msg, struct transfer_stream* p_stream, int32_t* chunk)
+{
+    char* name = p_msg->name;
+    struct vector_mutex* p_vec_mutex;
+    struct vector_group group;
 
+    if (!acquire_vector_group(&group, &name, 1, &p_vec_mutex))
+        return TRANSFER_FAIL;
 
+    int res = TRANSFER_SUCCESS;
 
-int start_request_thread(void* (*thread_function)(void*), void* p_args)
-{
-    int res = REQUEST_THREAD_CREATE_SUCCESS;
-    pthread_t th_id;
-    if (pthread_create(&th_id, &request_thread_attr, thread_function, p_args) != 0)
+    if (p_msg->format == TRANSFER_FORMAT_SHM && p_msg->len < p_vec_mutex->size)
+        res = TRANSFER_FAIL; // the buffer is too small
+    // the whole vector is exported at one point in time
+    else if (lock_vector_group_elems(&group, NULL))
     {
-        perror("START REQUEST THREAD could not create the thread");
-        res = REQUEST_THREAD_CREATE_FAIL;
-    }
-    else // thread created
-    {
-        // wait until thread copies message
-        if (pthread_mutex_lock(&mutex_msg) == 0)
+        if (!open_transfer_stream(p_stream, p_msg))
+            res = TRANSFER_FAIL;
+
+        for (int pos = 0; pos < p_vec_mutex->size && res == TRANSFER_SUCCESS; 
+            pos += TRANSFER_CHUNK_LEN)
         {
-            while (msg_not_copied)
-            {
-                if (pthread_cond_wait(&cond_msg, &mutex_msg) != 0)
-                {
-                    perror("START REQUEST THREAD could not wait for the condition");
-                    res = REQUEST_THREAD_CREATE_FAIL;
-                    break;
-                }
-            }
-            msg_not_copied = 1; // thread changed it to 0 after copying message, change it to initial state
-            if (pthread_mutex_unlock(&mutex_msg) != 0)
+            int len = p_vec_mutex->size - pos < TRANSFER_CHUNK_LEN ? 
+                p_vec_mutex->size - pos : TRANSFER_CHUNK_LEN;
+
+            if (!read_vector_range(p_vec_mutex, pos, len, chunk) || 
+                !write_transfer_chunk(p_stream, chunk, len))
             {
-                perror("START REQUEST THREAD could not unlock the mutex_msg");
-                res = REQUEST_THREAD_CREATE_FAIL;
+                res = TRANSFER_FAIL;
             }
         }
-        else // couldn't lock mutex
-        {
-            perror("START REQUEST THREAD could not lock the mutex_msg");
-            res = REQUEST_THREAD_CREATE_FAIL;
-        }
+
+        unlock_vector_group_elems(&group);
+    }
+    else // couldn't lock stripes
+    {
+        res = TRANSFER_FAIL;
     }
 
+    if (!release_vector_group(&group))
+        res = TRANSFER_FAIL;
+
     return res;
 }
 
 
 
-int copy_message(char* p_source, char* p_destination, int size)
+int transfer_vector(struct transfer_msg* p_msg, int* p_num_of_elems)
 {
-    int res = 1;
-    if (pthread_mutex_lock(&mutex_msg) == 0)
+    if ((p_msg->op != TRANSFER_OP_IMPORT && p_msg->op != TRANSFER_OP_EXPORT) || 
+        p_msg->format < TRANSFER_FORMAT_BINARY || p_msg->format > TRANSFER_FORMAT_SHM)
     {
-        memcpy(p_destination, p_source, size);   // copy message to local variable
-        msg_not_copied = 0;                      // info for main thread to proceed
-        if (pthread_cond_signal(&cond_msg) == 0)
-        {
-            if (pthread_mutex_unlock(&mutex_msg) != 0)
-            {
-                perror("COPY MESSAGE could not unlock the mutex_msg");
-                res = 0;
-            }
-        }
-        else
-        {
-            perror("COPY MESSAGE could not signal");
-            res = 0;
-        }               
-    }     
-    else // couldn't lock mutex
-    {
-        perror("COPY MESSAGE could not lock the mutex_msg");
-        res = 0;
+        return TRANSFER_FAIL;
     }
 
-    return res;                         
-}
+    p_msg->path[MAX_TRANSFER_PATH_LEN - 1] = '\0';
 
+    if (p_msg->format != TRANSFER_FORMAT_SHM && !resolve_transfer_path(p_msg))
+        return TRANSFER_FAIL;
 
+    // the export opens the stream itself
+    struct transfer_stream stream;
+    memset(&stream, 0, sizeof(struct transfer_stream));
+    stream.fd = -1;
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// init vector functions
-///////////////////////////////////////////////////////////////////////////////////////////////////
+    if (p_msg->op == TRANSFER_OP_IMPORT && !open_transfer_stream(&stream, p_msg))
+        return TRANSFER_FAIL;
+
+    int res = TRANSFER_SUCCESS;
+    int32_t* chunk = malloc(TRANSFER_CHUNK_LEN * sizeof(int32_t));
 
+    if (chunk == NULL)
+    {
+        res = TRANSFER_FAIL;
+        perror("TRANSFER VECTOR could not allocate the chunk");
+    }
+    else if (p_msg->op == TRANSFER_OP_IMPORT)
+        res = import_vector(p_msg, &stream, chunk);
+    else
+        res = export_vector(p_msg, &stream, chunk);
 
+    *p_num_of_elems = stream.num_of_elems;
 
-int initialize_init_vector_queue()
-{
-    int res = QUEUE_INIT_SUCCESS;
+    free(chunk);
 
-    struct mq_attr q_init_vector_attr;
-    
-    q_init_vector_attr.mq_flags = 0;                                // ingnored for MQ_OPEN
-    q_init_vector_attr.mq_maxmsg = INIT_VECTOR_QUEUE_MAX_MESSAGES;
-    q_init_vector_attr.mq_msgsize = INIT_MSG_SIZE;        
-    q_init_vector_attr.mq_curmsgs = 0;                              // initially 0 messages
+    if (!close_transfer_stream(&stream))
+        res = TRANSFER_FAIL;
 
-    int open_flags = O_CREAT | O_RDONLY | O_NONBLOCK;
-    mode_t permissions = S_IRUSR | S_IWUSR;                         // allow reads and writes into queue
+    // after the locks are released, like sets
+    if (!commit_wal())
+        res = TRANSFER_FAIL;
 
-    if ((
-        q_init_vector = mq_open(INIT_VECTOR_QUEUE_NAME, open_flags, permissions, 
-        &q_init_vector_attr)) == -1)
-    {
-        perror("INITIALIZE INIT VECTOR QUEEU could not open the queue");
-        res = QUEUE_OPEN_ERROR;
-    }
-    
     return res;
 }
 
 
 
-void *init_vector(void* p_init_msg)
+void* transfer(void* p_transfer_msg)
 {
-    struct init_msg init_msg;
-    if (copy_message((char*) p_init_msg, (char*) &init_msg, INIT_MSG_SIZE) == 1)
-    {
-        // create vector
-        int response = create_vector(init_msg.name, init_msg.size);
-        
-        // send response
-        mqd_t q_resp;
-        if ((q_resp = mq_open(init_msg.resp_queue_name, O_WRONLY)) == -1)
-        {
-            perror("RESPONSE ERROR could not open queue for sending response");
-        }
-        else
-        {
-            if (mq_send(q_resp, (char*) &response, sizeof(int), 0) == -1)
-            {
-                perror("RESPONSE ERROR could not send response");
-            }
+    struct transfer_msg* p_msg = (struct transfer_msg*) p_transfer_msg;
 
-            if (mq_close(q_resp) == -1)
-            {
-                perror ("RESPONSE QUEUE could not close response queue");
-            }
-        }
-    }
-    else
-    {
-        printf("INIT VECTOR couldn't copy message\n");
-    }
-    
-    pthread_exit(0);
+    int num_of_elems = 0;
+    int response = transfer_vector(p_msg, &num_of_elems);
+
+    send_op_response(p_msg->resp_queue_name, response, num_of_elems, p_msg->request_id);
+
+    return NULL;
 }
 
 
 
-int create_vector(char* name, int size)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// vector handles
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+/*
+    allocates entries of one table. 1 -> success, 0 -> fail
+*/
+int initialize_handle_table(struct handle_table* p_table, int size)
 {
-    int res = NEW_VECTOR_CREATED;
+    if (pthread_mutex_init(&p_table->mutex, NULL) != 0)
+    {
+        perror("INITIALIZE HANDLE TABLE could not initialize the mutex");
+        return 0;
+    }
 
-    int old_vec_size = get_vector_size(name);
-    
-    if (old_vec_size < 0) // vector doesn't exist
+    p_table->entries = (struct handle_entry*) calloc(size, sizeof(struct handle_entry));
+    if (p_table->entries == NULL)
     {
-        if (create_array_file(name, size))
-            res = NEW_VECTOR_CREATED;
-        else
+        perror("INITIALIZE HANDLE TABLE could not allocate entries");
+        return 0;
+    }
+    p_table->size = size;
+
+    for (int i = 0; i < size; i++)
+    {
+        if (pthread_rwlock_init(&p_table->entries[i].lock, NULL) != 0)
         {
-            res = VECTOR_CREATION_ERROR;
-            printf("CREATE VECTOR could not create vector\n");
+            perror("INITIALIZE HANDLE TABLE could not initialize the entry lock");
+            p_table->size = i; // only these are destroyed
+            return 0;
         }
     }
-    else if (old_vec_size == size)
-        res = VECTOR_ALREADY_EXISTS;
-    else
-        res = VECTOR_CREATION_ERROR;
-    
-    return res;
+
+    return 1;
 }
 
 
 
-void get_full_vector_file_name(char* file_name, char* vector_name)
+int initialize_handle_tables()
 {
-    strcpy(file_name, VECTORS_FOLDER);
-    strcat(file_name, vector_name);
-    strcat(file_name, VECTOR_FILE_EXTENSION);
+    return initialize_handle_table(&vector_handles, MAX_VECTOR_HANDLES) && 
+        initialize_handle_table(&handle_clients, MAX_HANDLE_CLIENTS);
 }
 
 
 
-int get_full_vector_file_name_max_len()
+void destroy_handle_tables()
 {
-    return MAX_VECTOR_NAME_LEN + strlen(VECTOR_FILE_EXTENSION) + strlen(VECTORS_FOLDER) + 1;
+    for (int i = 0; i < vector_handles.size; i++)
+    {
+        struct handle_entry* p_entry = &vector_handles.entries[i];
+
+        if (p_entry->in_use)
+            release_vector_mutex(p_entry->p_vec_mutex);
+        pthread_rwlock_destroy(&p_entry->lock);
+    }
+
+    for (int i = 0; i < handle_clients.size; i++)
+    {
+        struct handle_entry* p_entry = &handle_clients.entries[i];
+
+        if (p_entry->in_use && mq_close(p_entry->q_resp) != 0)
+            perror("DESTROY HANDLE TABLES could not close client queue");
+        pthread_rwlock_destroy(&p_entry->lock);
+    }
+
+    free(vector_handles.entries);
+    free(handle_clients.entries);
+    vector_handles.size = 0;
+    handle_clients.size = 0;
 }
 
 
 
-int get_vector_size(char* name)
+int add_handle_entry(struct handle_table* p_table, struct vector_mutex* p_vec_mutex, 
+    mqd_t q_resp)
 {
-    int len = -1;
-
-    char file_name[get_full_vector_file_name_max_len()];
-    get_full_vector_file_name(file_name, name);
+    int id = HANDLE_FAIL;
 
-    FILE* fp;
-    fp = fopen(file_name, "r");
+    if (pthread_mutex_lock(&p_table->mutex) != 0)
+    {
+        perror("ADD HANDLE ENTRY could not lock the table");
+        return HANDLE_FAIL;
+    }
 
-    if (fp != NULL)
+    for (int i = 0; i < p_table->size && id == HANDLE_FAIL; i++)
     {
-        char len_str[20];
-        if (fgets(len_str, 20, fp) != NULL)
-        {
-            if (sscanf(len_str, "%d", &len) != 1)
-            {
-                printf("GET VECTOR SIZE vector file wrong format");
-                len = -1;
-            }
-        }
-        else
-        {
-            len = -1;
-        }
-        
-        if (fclose(fp) != 0)
+        struct handle_entry* p_entry = &p_table->entries[i];
+
+        // not in use --> nobody holds its lock except stale ids checking the generation
+        if (!p_entry->in_use && pthread_rwlock_wrlock(&p_entry->lock) == 0)
         {
-            len = -1;
+            p_entry->in_use = 1;
+            p_entry->p_vec_mutex = p_vec_mutex;
+            p_entry->q_resp = q_resp;
+            id = p_entry->generation * p_table->size + i;
+
+            pthread_rwlock_unlock(&p_entry->lock);
         }
     }
-    else
-    {
-        len = -1;
-    }
-    
-    return len;
+
+    pthread_mutex_unlock(&p_table->mutex);
+
+    return id;
 }
 
 
 
-int initialize_array_file(FILE* fp, int size)
+struct handle_entry* lock_handle_entry(struct handle_table* p_table, int id)
 {
-    int res = 1;
+    if (id < 0)
+        return NULL;
+
+    struct handle_entry* p_entry = &p_table->entries[id % p_table->size];
 
-    if (fprintf(fp, "%d\n", size) > 0)
+    if (pthread_rwlock_rdlock(&p_entry->lock) != 0)
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (fprintf(fp, "%d\n", 0) < 0)
-            {
-                res = 0;
-                break;
-            }
-        }
+        perror("LOCK HANDLE ENTRY could not lock the entry");
+        return NULL;
     }
-    else
+
+    if (!p_entry->in_use || p_entry->generation != id / p_table->size)
     {
-        res = 0;
+        pthread_rwlock_unlock(&p_entry->lock);
+        return NULL;
     }
 
-    return res;
+    return p_entry;
 }
 
 
 
-int create_array_file(char* name, int size)
+int remove_handle_entry(struct handle_table* p_table, int id, struct handle_entry* p_removed)
 {
-    int res = 1;
-    struct vector_mutex* p_vec_mutex = NULL;
-    pthread_mutex_t* p_vec_file_mutex = NULL;
-
-    if (add_vector_mutex(name)) // create mutex for new vector
-    {
-        p_vec_mutex = get_vector_mutex(name); // acquire newly created mutex
-        
-        if (p_vec_mutex != NULL)
-        {
-            p_vec_file_mutex = &p_vec_mutex->mutex;
-
-            if (pthread_mutex_lock(p_vec_file_mutex) == 0)  // lock access to vector file
-            {
-                char file_name[get_full_vector_file_name_max_len()];
-                get_full_vector_file_name(file_name, name);
-            
-                FILE* fp;
-                fp = fopen(file_name, "w");
+    if (id < 0)
+        return 0;
 
-                if (fp != NULL)
-                {
-                    if (!initialize_array_file(fp, size))
-                    {
-                        res = 0;
-                        printf("CREATE ARRAY FILE could not initialize file\n");
-                    }
-                    
-                    if (fclose(fp) != 0)
-                    {
-                        res = 0;
-                        perror("CREATE ARRAY FILE could not close file descriptor");
-                    }
+    int res = 0;
+    struct handle_entry* p_entry = &p_table->entries[id % p_table->size];
 
-                    if (!unlock_vector_mutex(p_vec_mutex))
-                    {
-                        res = 0;
-                        perror("CREATE ARRAY FILE could not unlock mutex");
-                    }
-                }
-                else // NULL vector file pointer
-                {
-                    res = 0;
-                    printf("CREATE ARRAY FILE null vector file pointer\n");
-                }
-            }
-            else // couldn't lock mutex
-            {
-                res = 0;
-                perror("CREATE ARRAY FILE could not lock mutex");
-            }
-        }
-        else // NULL vector mutex, no such vector
-        {
-            res = 0;
-        }
-    }
-    else // couldn't create vector mutex
+    if (pthread_mutex_lock(&p_table->mutex) != 0)
     {
-        res = 0;
-        printf("CREATE ARRAY FILE could not create vector mutex\n");
+        perror("REMOVE HANDLE ENTRY could not lock the table");
+        return 0;
     }
 
-    // in case mutex was created but some other errors occurred remove the mutex
-    if (res == 0 && p_vec_file_mutex != NULL)
+    // waits for requests which are using the entry
+    if (pthread_rwlock_wrlock(&p_entry->lock) == 0)
     {
-        vector_remove(vector_mutexes, vector_size(vector_mutexes) - 1);
-    }
-    
-    return res;
-}
+        if (p_entry->in_use && p_entry->generation == id / p_table->size)
+        {
+            *p_removed = *p_entry;
+            p_entry->in_use = 0;
+            p_entry->generation = (p_entry->generation + 1) % (INT_MAX / p_table->size);
+            res = 1;
+        }
 
+        pthread_rwlock_unlock(&p_entry->lock);
+    }
+    else
+        perror("REMOVE HANDLE ENTRY could not lock the entry");
 
+    pthread_mutex_unlock(&p_table->mutex);
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// set value in vector functions
-///////////////////////////////////////////////////////////////////////////////////////////////////
+    return res;
+}
 
 
 
-int initialize_set_queue()
+void send_client_response(int client_id, int result, int value, int request_id)
 {
-    int res = QUEUE_INIT_SUCCESS;
-
-    struct mq_attr q_set_attr;
-    
-    q_set_attr.mq_flags = 0;                                // ingnored for MQ_OPEN
-    q_set_attr.mq_maxmsg = SET_QUEUE_MAX_MESSAGES;
-    q_set_attr.mq_msgsize = SET_MSG_SIZE;        
-    q_set_attr.mq_curmsgs = 0;                              // initially 0 messages
-
-    int open_flags = O_CREAT | O_RDONLY | O_NONBLOCK;
-    mode_t permissions = S_IRUSR | S_IWUSR;                 // allow reads and writes into queue
+    struct handle_entry* p_client = lock_handle_entry(&handle_clients, client_id);
 
-    if ((
-        q_set = mq_open(SET_QUEUE_NAME, open_flags, permissions, 
-        &q_set_attr)) == -1)
+    if (p_client == NULL)
     {
-        perror("INITIALIZE SET QUEUE could not open the queue");
-        res = QUEUE_OPEN_ERROR;
+        printf("SEND CLIENT RESPONSE no client with id %d\n", client_id);
+        return;
     }
-    
-    return res;
-}
 
+    struct op_resp_msg response;
+    response.result = result;
+    response.value = value;
+    response.request_id = request_id;
 
+    if (mq_send(p_client->q_resp, (char*) &response, OP_RESP_MSG_SIZE, 0) == -1)
+        perror("RESPONSE ERROR could not send response");
 
-int set_value_in_vector_file(char* vec_name, int pos, int val)
-{
-    if (pos < 0)
-        return SET_FAIL;
+    pthread_rwlock_unlock(&p_client->lock);
+}
 
-    int res = SET_SUCCESS;
-    int value_changed = 0;  // 1 if vaule is changed at pos
 
-    int max_full_vector_file_name_len = get_full_vector_file_name_max_len();
-    char full_vector_file_name[max_full_vector_file_name_len];
-    get_full_vector_file_name(full_vector_file_name, vec_name);
-    
-    // name for temporal file with changed value, the same that original but *.tmp
-    char temp_file_name[max_full_vector_file_name_len];
-    strncpy(temp_file_name, 
-        full_vector_file_name, strlen(full_vector_file_name) - strlen(VECTOR_FILE_EXTENSION));
-    strcat(temp_file_name, TEMP_VECTOR_FILE_EXTENSION);
-    
-    struct vector_mutex* p_vec_mutex = NULL;
-    pthread_mutex_t* p_mutex_vec_file = NULL;
 
-    if ((p_vec_mutex = get_vector_mutex(vec_name)) != NULL) // obtain mutex for the vector file
+/*
+    opens the response queue of a client and adds it to the clients table. Returns the client id
+    or HANDLE_FAIL
+*/
+int register_handle_client(char* resp_queue_name)
+{
+    mqd_t q_resp;
+    if ((q_resp = mq_open(resp_queue_name, O_WRONLY)) == -1)
     {
-        p_mutex_vec_file = &p_vec_mutex->mutex;
-        if (pthread_mutex_lock(p_mutex_vec_file) == 0)    // lock mutex for the vector file
-        {
-            FILE* p_old, *p_new;
+        perror("REGISTER HANDLE CLIENT could not open the response queue");
+        return HANDLE_FAIL;
+    }
 
-            if ((p_old = fopen(full_vector_file_name, "r")) != NULL)    // open current vector file
-            {
-                if ((p_new = fopen(temp_file_name, "w")) != NULL)       // open temporal vector file
-                {
-                    char line[20];      // buffer for reading old file
-                    int line_idx = -1;  // -1 because first line is size of vector
-                    while(fgets(line, 20, p_old) != NULL)
-                    {
-                        if (line_idx != pos) // not specified position
-                        {
-                            if (fputs(line, p_new) < 0) // copy from old to new file
-                            {
-                                perror("SET VALUE IN VECTOR FILE could not wirte into temp file");
-                                res = SET_FAIL;
-                                break;
-                            }
-                        }
-                        else // reached required position
-                        {
-                            if (fprintf(p_new, "%d\n", val) < 0)    // print new value
-                            {
-                                perror("SET VALUE IN VECTOR FILE could not wirte wanted number into temp file");
-                                res = SET_FAIL;
-                                break;
-                            }
-                            else // value changed
-                                value_changed = 1;
-                        }
+    int client_id = add_handle_entry(&handle_clients, NULL, q_resp);
+    if (client_id == HANDLE_FAIL)
+    {
+        printf("REGISTER HANDLE CLIENT too many clients\n");
+        mq_close(q_resp);
+    }
 
-                        line_idx++;
-                    }
+    return client_id;
+}
 
-                    if (fclose(p_old) == 0)
-                    {
-                        if (fclose(p_new) == 0)
-                        {
-                            if (remove(full_vector_file_name) == 0)
-                            {
-                                if (rename(temp_file_name, full_vector_file_name) != 0)
-                                {
-                                    res = SET_FAIL;
-                                    perror("SET_VALUE_IN_VECTOR_FILE could not rename new file");
-                                }
-                            }
-                            else // couldn't remove old file
-                            {
-                                res = SET_FAIL;
-                                perror("SET_VALUE_IN_VECTOR_FILE could not remove old file");
-                            }
-                        }
-                        else // couldn't close tmp file
-                        {
-                            res = SET_FAIL;
-                            perror("SET_VALUE_IN_VECTOR_FILE could not close temp file");
-                        }
-                    }
-                    else // couldn't close old file
-                    {
-                        res = SET_FAIL;
-                        perror("SET_VALUE_IN_VECTOR_FILE could not close old file");
-                    }
-                }
-                else // can't create temporary vector file
-                {
-                    res = SET_FAIL;  
-                    perror("SET VALUE IN VECTOR FILE could not create temporal file");
-                    if (fclose(p_old) != 0)
-                        perror("SET VALUE IN VECTOR FILE could not close vector file after creating temporal file failed");
-                }  
-            }
-            else // can't open old vector file
-            {
-                res = SET_FAIL;   
-                perror("SET VALUE IN VECTOR FILE could not open the vector file");
-            }
 
-            if (!unlock_vector_mutex(p_vec_mutex))
-                res = SET_FAIL;      
-        }
-        else // can't lock mutex
-        {
-            res = SET_FAIL;
-            perror("SET VALUE IN VECTOR FILE could not lock the mutex");
-        }
-    }
-    else // can't obtain mutex, no such vector
+
+/*
+    pins the vector and adds it to the handles table. Returns the handle or HANDLE_FAIL
+*/
+int open_vector_handle(char* name)
+{
+    struct vector_mutex* p_vec_mutex;
+    if ((p_vec_mutex = get_vector_mutex(name)) == NULL) // no such vector
+        return HANDLE_FAIL;
+
+    int handle = add_handle_entry(&vector_handles, p_vec_mutex, (mqd_t) -1);
+    if (handle == HANDLE_FAIL)
     {
-        res = SET_FAIL;
+        printf("OPEN VECTOR HANDLE too many opened handles\n");
+        release_vector_mutex(p_vec_mutex);
     }
 
-    if (res == SET_SUCCESS && value_changed == 1)
-        return SET_SUCCESS;
-    else
-        return SET_FAIL;
+    return handle;
 }
 
 
 
-void *set(void* p_set_msg)
+void* handle_request(void* p_handle_msg)
 {
-    struct set_msg set_msg;
-    if (copy_message((char*) p_set_msg, (char*) &set_msg, SET_MSG_SIZE) == 1)
+    struct handle_msg* p_msg = (struct handle_msg*) p_handle_msg;
+    p_msg->name[MAX_VECTOR_NAME_LEN - 1] = '\0';
+    p_msg->resp_queue_name[MAX_RESP_QUEUE_NAME_LEN - 1] = '\0';
+
+    int result = HANDLE_FAIL;
+    int value = 0;
+    struct handle_entry removed;
+    struct handle_entry* p_entry;
+
+    switch (p_msg->op)
     {
-        // set value in file
-        int response = set_value_in_vector_file(set_msg.name, set_msg.pos, set_msg.value);
-        
-        // send response
-        mqd_t q_resp;
-        if ((q_resp = mq_open(set_msg.resp_queue_name, O_WRONLY)) == -1)
-        {
-            perror("RESPONSE ERROR could not open queue for sending response");
-        }
-        else
-        {
-            if (mq_send(q_resp, (char*) &response, sizeof(int), 0) == -1)
+        case HANDLE_OP_REGISTER:
+            // the client has no id yet, so the response goes straight to its queue
+            result = register_handle_client(p_msg->resp_queue_name);
+            send_op_response(p_msg->resp_queue_name, result, 0, p_msg->request_id);
+            return NULL;
+        case HANDLE_OP_UNREGISTER:
+            if (remove_handle_entry(&handle_clients, p_msg->client_id, &removed) && 
+                mq_close(removed.q_resp) != 0)
             {
-                perror("RESPONSE ERROR could not send response");
+                perror("HANDLE REQUEST could not close client queue");
             }
-
-            if (mq_close(q_resp) == -1)
+            return NULL;
+        case HANDLE_OP_OPEN:
+            result = open_vector_handle(p_msg->name);
+            break;
+        case HANDLE_OP_CLOSE:
+            if (remove_handle_entry(&vector_handles, p_msg->handle, &removed))
             {
-                perror ("RESPONSE QUEUE could not close response queue");
+                result = HANDLE_SUCCESS;
+                release_vector_mutex(removed.p_vec_mutex);
             }
-        }
-    }
-    else
-    {
-        printf("SET couldn't copy_message\n");
+            break;
+        case HANDLE_OP_SET:
+            result = SET_FAIL;
+            if ((p_entry = lock_handle_entry(&vector_handles, p_msg->handle)) != NULL)
+            {
+                result = set_value_in_vector(p_entry->p_vec_mutex, p_msg->pos, p_msg->value);
+                pthread_rwlock_unlock(&p_entry->lock);
+            }
+            break;
+        case HANDLE_OP_GET:
+            result = GET_FAIL;
+            if ((p_entry = lock_handle_entry(&vector_handles, p_msg->handle)) != NULL)
+            {
+                result = get_value_from_vector(p_entry->p_vec_mutex, p_msg->pos, &value) ? 
+                    GET_SUCCESS : GET_FAIL;
+                pthread_rwlock_unlock(&p_entry->lock);
+            }
+            break;
     }
-    
-    pthread_exit(0);
+
+    // client id -1 --> no response, used by clients closing handles on disconnect
+    if (p_msg->client_id != -1)
+        send_client_response(p_msg->client_id, result, value, p_msg->request_id);
+
+    return NULL;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-// get value from vector
+// shared memory transport
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 
-int initialize_get_queue()
+int wait_for_shm_ring(uint32_t* p_tail, uint32_t* p_sleeping, uint32_t head, int* p_stop)
 {
-    int res = QUEUE_INIT_SUCCESS;
-
-    struct mq_attr q_get_attr;
-    
-    q_get_attr.mq_flags = 0;                                // ingnored for MQ_OPEN
-    q_get_attr.mq_maxmsg = GET_QUEUE_MAX_MESSAGES;
-    q_get_attr.mq_msgsize = GET_MSG_SIZE;        
-    q_get_attr.mq_curmsgs = 0;                              // initially 0 messages
-
-    int open_flags = O_CREAT | O_RDONLY | O_NONBLOCK;
-    mode_t permissions = S_IRUSR | S_IWUSR;                 // allow reads and writes into queue
+    for (int i = 0; i < SHM_SPIN_ITERATIONS; i++)
+    {
+        if (__atomic_load_n(p_tail, __ATOMIC_ACQUIRE) != head)
+            return 1;
+    }
 
-    if ((
-        q_get = mq_open(GET_QUEUE_NAME, open_flags, permissions, 
-        &q_get_attr)) == -1)
+    while (__atomic_load_n(p_tail, __ATOMIC_ACQUIRE) == head)
     {
-        perror("INITIALIZE GET QUEUE could not open the queue");
-        res = QUEUE_OPEN_ERROR;
+        if (p_stop != NULL && __atomic_load_n(p_stop, __ATOMIC_ACQUIRE))
+            return 0;
+
+        // the producer checks the flag after bumping the tail, so either it sees the flag or 
+        // the tail is already changed and futex wait returns immediately
+        __atomic_store_n(p_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(p_tail, __ATOMIC_SEQ_CST) == head)
+        {
+            // stop is not a change of the tail, so a wake up on stop can be missed. Stoppable
+            // waits wake up periodically to check it
+            struct timespec timeout = { 0, SHM_STOP_CHECK_INTERVAL_MS * 1000000L };
+            syscall(SYS_futex, p_tail, FUTEX_WAIT, head, p_stop != NULL ? &timeout : NULL, 
+                NULL, 0);
+        }
+        __atomic_store_n(p_sleeping, 0, __ATOMIC_SEQ_CST);
     }
-    
-    return res;
+
+    return 1;
 }
 
 
 
-int get_value_from_vector_file(char* vec_name, int pos, int* p_value)
+/*
+    maps the channel and starts a thread serving it. Threads of channels which were detached
+    are joined here, so they don't pile up. 1 -> success, 0 -> fail
+*/
+int attach_shm_client(char* shm_name)
 {
-    if (pos < 0)
+    int fd;
+    if ((fd = shm_open(shm_name, O_RDWR, 0)) == -1)
+    {
+        perror("ATTACH SHM CLIENT could not open the shared memory");
         return 0;
+    }
 
-    int res = 1;
-    int found = 0;
-
-    struct vector_mutex* p_vec_mutex;
-    pthread_mutex_t* p_mutex_vec;
-    if ((p_vec_mutex = get_vector_mutex(vec_name)) != NULL) // obtain mutex for the vector file
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) != 0 || shm_stat.st_size < (off_t) sizeof(struct shm_channel))
     {
-        p_mutex_vec = &p_vec_mutex->mutex;
-        if (pthread_mutex_lock(p_mutex_vec) == 0) // lock vector file mutex
-        {
-            char full_vector_file_name[get_full_vector_file_name_max_len()];
-            get_full_vector_file_name(full_vector_file_name, vec_name);
+        printf("ATTACH SHM CLIENT shared memory is too small\n");
+        close(fd);
+        return 0;
+    }
 
-            FILE* fp;
+    void* p_map = mmap(NULL, sizeof(struct shm_channel), PROT_READ | PROT_WRITE, MAP_SHARED, 
+        fd, 0);
+    close(fd); // the mapping stays valid
+    if (p_map == MAP_FAILED)
+    {
+        perror("ATTACH SHM CLIENT could not map the shared memory");
+        return 0;
+    }
 
-            if ((fp = fopen(full_vector_file_name, "r")) != NULL) // open the vector file
-            {
-                char line[20];      // temp varible for reading lines from vector file
-                int line_idx = -1;  // -1 because line 0 is size of vector
-                while (fgets(line, 20, fp) != NULL)
-                {
-                    if (line_idx == pos)
-                    {
-                        found = 1;
-                        if (sscanf(line, "%d", p_value) != 1)
-                        {
-                            perror("GET VALUE FROM VECTOR FILE could not match value to integer");
-                            res = 0;
-                        }
+    struct shm_client* p_client = (struct shm_client*) calloc(1, sizeof(struct shm_client));
+    if (p_client == NULL)
+    {
+        perror("ATTACH SHM CLIENT could not allocate the client");
+        munmap(p_map, sizeof(struct shm_channel));
+        return 0;
+    }
+    p_client->p_channel = (struct shm_channel*) p_map;
 
-                        break;
-                    }
+    int res = 1;
 
-                    line_idx++;
-                } // end read file while
+    if (pthread_mutex_lock(&mutex_shm_clients) == 0)
+    {
+        // join threads of detached channels
+        struct shm_client** pp_client = &shm_clients;
+        while (*pp_client != NULL)
+        {
+            struct shm_client* p_old = *pp_client;
 
-                if (fclose(fp) != 0)
-                {
-                    res = 0;
-                    perror("GET VALUE FROM VECTOR FILE could not close file");
-                }
-            }
-            else // can't open file
+            if (__atomic_load_n(&p_old->finished, __ATOMIC_ACQUIRE))
             {
-                res = 0;
-                perror("GET VALUE FROM VECTOR FILE could not open file");
+                pthread_join(p_old->thread, NULL);
+                *pp_client = p_old->p_next;
+                free(p_old);
             }
+            else
+                pp_client = &p_old->p_next;
+        }
 
-            if (!unlock_vector_mutex(p_vec_mutex))
-            {
-                res = 0;
-                perror("GET VALUE FROM VECTOR FILE could not unlock mutex");
-            }
+        if (pthread_create(&p_client->thread, NULL, serve_shm_client, p_client) == 0)
+        {
+            p_client->p_next = shm_clients;
+            shm_clients = p_client;
         }
-        else // couldn't lock mutex
+        else
         {
             res = 0;
-            perror("GET VALUE FROM VECTOR FILE could not lock mutex");
-        }  
+            perror("ATTACH SHM CLIENT could not start the thread");
+        }
+
+        pthread_mutex_unlock(&mutex_shm_clients);
     }
-    else // vector doesn't exist
+    else
     {
         res = 0;
+        perror("ATTACH SHM CLIENT could not lock the mutex");
     }
 
-    return res && found;
+    if (!res)
+    {
+        munmap(p_map, sizeof(struct shm_channel));
+        free(p_client);
+    }
+
+    return res;
 }
 
 
 
-void* get(void* p_get_msg)
+void* attach(void* p_attach_msg)
 {
-    struct get_msg get_msg;
-    if (copy_message((char*) p_get_msg, (char*) &get_msg, GET_MSG_SIZE) == 1)
+    struct attach_msg* p_msg = (struct attach_msg*) p_attach_msg;
+    p_msg->shm_name[MAX_SHM_NAME_LEN - 1] = '\0';
+
+    int response = attach_shm_client(p_msg->shm_name) ? ATTACH_SUCCESS : ATTACH_FAIL;
+    
+    // send response
+    mqd_t q_resp;
+    if ((q_resp = mq_open(p_msg->resp_queue_name, O_WRONLY)) == -1)
     {
-        // get value from file
-        int value = 0;
-        int error = get_value_from_vector_file(get_msg.name, get_msg.pos, &value) ? 
-            GET_SUCCESS : GET_FAIL;
-        
-        // send response
-        mqd_t q_resp;
-        if ((q_resp = mq_open(get_msg.resp_queue_name, O_WRONLY)) == -1)
+        perror("RESPONSE ERROR could not open queue for sending response");
+    }
+    else
+    {
+        if (mq_send(q_resp, (char*) &response, sizeof(int), 0) == -1)
         {
-            perror("RESPONSE ERROR could not open queue for sending response");
+            perror("RESPONSE ERROR could not send response");
         }
-        else
-        {
-            struct get_resp_msg response;
-            response.error = error;
-            response.value = value;
-
-            if (mq_send(q_resp, (char*) &response, GET_RESP_MSG_SIZE, 0) == -1)
-            {
-                perror("RESPONSE ERROR could not send response");
-            }
 
-            if (mq_close(q_resp) == -1)
-            {
-                perror ("RESPONSE QUEUE could not close response queue");
-            }
+        if (mq_close(q_resp) == -1)
+        {
+            perror ("RESPONSE QUEUE could not close response queue");
         }
     }
-    else
-    {
-        printf("GET couldn't copy_message\n");
-    }
-    
-    pthread_exit(0);
-}
 
-
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// destroy
-///////////////////////////////////////////////////////////////////////////////////////////////////
+    return NULL;
+}
 
 
 
-int initialize_destroy_queue()
+int execute_shm_request(struct shm_request* p_request, struct shm_response* p_response)
 {
-    int res = QUEUE_INIT_SUCCESS;
-
-    struct mq_attr q_destroy_attr;
-    
-    q_destroy_attr.mq_flags = 0;                                // ingnored for MQ_OPEN
-    q_destroy_attr.mq_maxmsg = DESTROY_QUEUE_MAX_MESSAGES;
-    q_destroy_attr.mq_msgsize = DESTROY_MSG_SIZE;        
-    q_destroy_attr.mq_curmsgs = 0;                              // initially 0 messages
+    // the ring is written by the client, never trust the name to be terminated
+    char name[MAX_VECTOR_NAME_LEN];
+    memcpy(name, p_request->name, MAX_VECTOR_NAME_LEN);
+    name[MAX_VECTOR_NAME_LEN - 1] = '\0';
 
-    int open_flags = O_CREAT | O_RDONLY | O_NONBLOCK;
-    mode_t permissions = S_IRUSR | S_IWUSR;                 // allow reads and writes into queue
+    int res = 1;
+    p_response->value = 0;
 
-    if ((
-        q_destroy = mq_open(DESTROY_QUEUE_NAME, open_flags, permissions, 
-        &q_destroy_attr)) == -1)
+    switch (p_request->op)
     {
-        perror("INITIALIZE DESTROY QUEUE could not open the queue");
-        res = QUEUE_OPEN_ERROR;
+        case SHM_OP_INIT:
+            p_response->result = create_vector(name, p_request->pos, p_request->value);
+            break;
+        case SHM_OP_SET:
+            p_response->result = set_value_in_vector_file(name, p_request->pos, 
+                p_request->value);
+            break;
+        case SHM_OP_GET:
+            p_response->result = get_value_from_vector_file(name, p_request->pos, 
+                &p_response->value) ? GET_SUCCESS : GET_FAIL;
+            break;
+        case SHM_OP_DESTROY:
+            p_response->result = destroy_vector(name);
+            break;
+        case SHM_OP_DETACH:
+            p_response->result = 0;
+            res = 0;
+            break;
+        default:
+            p_response->result = -1;
+            break;
     }
-    
+
     return res;
 }
 
 
 
-void* destroy(void* p_destroy_msg)
+void* serve_shm_client(void* p_shm_client)
 {
-    struct destroy_msg destroy_msg;
-    if (copy_message((char*) p_destroy_msg, (char*) &destroy_msg, DESTROY_MSG_SIZE) == 1)
+    struct shm_client* p_client = (struct shm_client*) p_shm_client;
+    struct shm_channel* p_channel = p_client->p_channel;
+
+    uint32_t req_head = 0;
+    int attached = 1;
+
+    while (attached && wait_for_shm_ring(&p_channel->req_tail, &p_channel->server_sleeping, 
+        req_head, &p_client->stop))
     {
-        int result = DESTROY_SUCCESS;
-        
-        struct vector_mutex* p_vec_mutex;
-        pthread_mutex_t* p_mutex_vec;
-        
-        if ((p_vec_mutex = get_vector_mutex(destroy_msg.name)) != NULL)
-        {
-            p_mutex_vec = &p_vec_mutex->mutex;
-            char full_vector_file_name[get_full_vector_file_name_max_len()];
-            get_full_vector_file_name(full_vector_file_name, destroy_msg.name);
-            
-            if (pthread_mutex_lock(p_mutex_vec) == 0)
-            {
-                if (remove(full_vector_file_name) != 0) // if couldn't remove the file
-                {
-                    perror("DESTROY could not remove the vector file");
-                    result = DESTROY_FAIL;
-                }
+        uint32_t req_tail = __atomic_load_n(&p_channel->req_tail, __ATOMIC_ACQUIRE);
 
-                if (mark_vector_mutex_to_remove(p_vec_mutex))
-                {
-                    if (!unlock_vector_mutex(p_vec_mutex))
-                    {
-                        result = DESTROY_FAIL;
-                        printf("DESTROY could not unlock vector mutex");
-                    }
-                }
-                else
-                {
-                    printf("DESTROY could not set mutex to remove\n");
-                }
-                
-            }
-            else // couldn't lock mutex
-            {
-                result = DESTROY_FAIL;
-                perror("DESTROY could not lock the mutex");
-            }
-        }
-        else // vector doesn't exist
-        {
-            result = DESTROY_FAIL;
-        }
-        
-        // send response
-        mqd_t q_resp;
-        if ((q_resp = mq_open(destroy_msg.resp_queue_name, O_WRONLY)) == -1)
+        // serve everything what was written so far
+        while (attached && req_head != req_tail)
         {
-            perror("RESPONSE ERROR could not open queue for sending response");
+            int idx = req_head % SHM_RING_CAPACITY;
+            attached = execute_shm_request(&p_channel->requests[idx], 
+                &p_channel->responses[idx]);
+
+            req_head++;
+            __atomic_store_n(&p_channel->resp_tail, req_head, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&p_channel->client_sleeping, __ATOMIC_SEQ_CST))
+                syscall(SYS_futex, &p_channel->resp_tail, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
         }
-        else
-        {
-            if (mq_send(q_resp, (char*) &result, sizeof(int), 0) == -1)
-            {
-                perror("RESPONSE ERROR could not send response");
-            }
+    }
 
-            if (mq_close(q_resp) == -1)
-            {
-                perror ("RESPONSE QUEUE could not close response queue");
-            }
-        }
+    if (munmap(p_channel, sizeof(struct shm_channel)) != 0)
+        perror("SERVE SHM CLIENT could not unmap the channel");
+
+    __atomic_store_n(&p_client->finished, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+
+
+void stop_shm_clients()
+{
+    if (pthread_mutex_lock(&mutex_shm_clients) != 0)
+    {
+        perror("STOP SHM CLIENTS could not lock the mutex");
+        return;
     }
-    else
+
+    // a sleeping thread notices stop within SHM_STOP_CHECK_INTERVAL_MS, so all are told first
+    for (struct shm_client* p_client = shm_clients; p_client != NULL; p_client = p_client->p_next)
+        __atomic_store_n(&p_client->stop, 1, __ATOMIC_RELEASE);
+
+    while (shm_clients != NULL)
     {
-        printf("DESTROY couldn't copy_message\n");
+        struct shm_client* p_client = shm_clients;
+        shm_clients = p_client->p_next;
+
+        pthread_join(p_client->thread, NULL);
+        free(p_client);
     }
-    
-    pthread_exit(0);
+
+    pthread_mutex_unlock(&mutex_shm_clients);
 }
 
 
@@ -1590,11 +8442,17 @@ void *update_user_input(void* arg)
         res = fgets(user_input, 2, stdin);
         if (res == NULL)
         {
-            perror("USER INPUT error during reading user input");
+            // no more input (i.e. stdin is /dev/null), the server can still be stopped by a signal
+            if (ferror(stdin))
+                perror("USER INPUT error during reading user input");
+
+            return NULL;
         }
     }
 
-    pthread_exit(0);
+    request_shutdown();
+
+    return NULL;
 }
 
 